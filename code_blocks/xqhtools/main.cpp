@@ -9,7 +9,8 @@
 #include <ctime>
 #include <stdio.h>
 
-#define ZQHTOOLS_VERSION "1.8"
+#define ZQHTOOLS_VERSION "1.9"
+#define ZQHTOOLS_BATCH_SIZE (64 * 1024 * 1024) // размер пакета подфайлов, после которого пакет записывается на диск
 
 enum {
     XQHTOOLS_CSV_TO_HEX = 0,
@@ -20,6 +21,7 @@ enum {
     XQHTOOLS_ZSTD_TRAIN,
     XQHTOOLS_VERSION,
     XQHTOOLS_SUBFILE_CRC64,
+    XQHTOOLS_QHS_TO_V5,
 };
 
 // получаем команду из командной строки
@@ -40,6 +42,8 @@ int zstd_train(const int argc, char *argv[]);
 int merge_date(const int argc, char *argv[]);
 // рассчет crc64
 int calc_subfile_crc64(const int argc, char *argv[]);
+// конвертировать хранилище котировок в формат 5
+int qhs_to_v5(const int argc, char *argv[]);
 //
 void parse(std::string value, std::vector<std::string> &elemet_list);
 
@@ -68,6 +72,9 @@ int main(int argc, char *argv[]) {
     } else
     if(cmd == XQHTOOLS_SUBFILE_CRC64) {
         return calc_subfile_crc64(argc, argv);
+    } else
+    if(cmd == XQHTOOLS_QHS_TO_V5) {
+        return qhs_to_v5(argc, argv);
     }
     return 0;
 }
@@ -87,6 +94,8 @@ int get_cmd(int &cmd, const int argc, char *argv[]) {
     bool is_paths_raw_storages = false;
     bool is_path_out_raw_storage = false;
     bool is_crc64 = false;
+    bool is_convert_v5 = false;
+    bool is_path_out_storage = false;
     for(int i = 1; i < argc; ++i) {
         std::string value = std::string(argv[i]);
         if(value == "train") is_train = true;
@@ -101,6 +110,10 @@ int get_cmd(int &cmd, const int argc, char *argv[]) {
         else
         if(value == "subfile_crc64") is_crc64 = true;
         else
+        if(value == "convert_v5") is_convert_v5 = true;
+        else
+        if(value == "path_out_storage") is_path_out_storage = true;
+        else
         if(value == "path_hex") is_hex = true;
         else
         if(value == "path_csv") is_csv = true;
@@ -140,6 +153,17 @@ int get_cmd(int &cmd, const int argc, char *argv[]) {
         std::cout << "error! hex file merging is not supported" << std::endl;
         return -1;
     } else
+    if(is_convert_v5 && (is_merge || is_convert_csv || is_convert_storage)) {
+        std::cout << "error! you have specified two conversion options" << std::endl;
+        return -1;
+    } else
+    if(is_convert_v5 && (!is_storage || !is_path_out_storage)) {
+        std::cout << "error! no file specified" << std::endl;
+        return -1;
+    } else
+    if(is_convert_v5) {
+        cmd = XQHTOOLS_QHS_TO_V5;
+    } else
     if(is_crc64 && is_date && (is_raw_storage || is_storage)) {
         cmd = XQHTOOLS_SUBFILE_CRC64;
     } else
@@ -471,6 +495,7 @@ int csv_to_qhs(const int argc, char *argv[]) {
 #   else
     xquotes_history::QuotesHistory<> iQuotesHistory(path_storage, type_price, option);
 #   endif
+    iQuotesHistory.begin_batch(ZQHTOOLS_BATCH_SIZE);
     int err_csv = xquotes_csv::read_file(
             path_csv,
             is_read_header,
@@ -514,10 +539,15 @@ int csv_to_qhs(const int argc, char *argv[]) {
         }
     });
 
+    int err_commit = iQuotesHistory.commit();
     if(err_csv != xquotes_common::OK) {
         std::cout << std::endl << "error! error! csv file, code: " << err_csv << std::endl;
         return -1;
     }
+    if(err_commit != xquotes_common::OK) {
+        std::cout << std::endl << "error! storage write, code: " << err_commit << std::endl;
+        return -1;
+    }
     std::cout << std::endl << "conversion completed" << std::endl;
     return 0;
 }
@@ -845,6 +875,7 @@ int merge_date(const int argc, char *argv[]) {
         list_storage.push_back(new xquotes_storage::Storage(paths_raw_storages[i]));
     }
     xquotes_storage::Storage OutStorage(path_out_raw_storage);
+    OutStorage.begin_batch(ZQHTOOLS_BATCH_SIZE);
     std::cout << "start merge" << std::endl;
     int num_subfiles = 0;
     for(size_t i = 0; i < paths_raw_storages.size(); ++i) {
@@ -869,6 +900,14 @@ int merge_date(const int argc, char *argv[]) {
         }
     }
     std::cout << std::endl;
+    int err_commit = OutStorage.commit();
+    for(size_t i = 0; i < list_storage.size(); ++i) {
+        delete list_storage[i];
+    }
+    if(err_commit != xquotes_storage::OK) {
+        std::cout << "storage error, code " << err_commit << std::endl;
+        return -1;
+    }
     return 0;
 }
 
@@ -902,6 +941,88 @@ int calc_subfile_crc64(const int argc, char *argv[]) {
     return 0;
 }
 
+int qhs_to_v5(const int argc, char *argv[]) {
+    std::string path_storage;
+    std::string path_out_storage;
+    for(int i = 1; i < argc; ++i) {
+        std::string value = std::string(argv[i]);
+        if((value == "path_storage") && (i + 1) < argc) {
+            path_storage = std::string(argv[i + 1]);
+        } else
+        if((value == "path_out_storage") && (i + 1) < argc) {
+            path_out_storage = std::string(argv[i + 1]);
+        }
+    }
+    if(path_storage.size() == 0 || path_out_storage.size() == 0) {
+        std::cout << "error! no path or directory specified" << std::endl;
+        return -1;
+    }
+    if(bf::check_file(path_out_storage)) {
+        std::cout << "error! file " << path_out_storage << " already exists" << std::endl;
+        return -1;
+    }
+
+    // тип цены и сжатие у непустого хранилища берутся из заметки файла, а не из параметров конструктора
+    xquotes_history::QuotesHistory<> iQuotesHistory(path_storage, xquotes_history::PRICE_OHLCV, xquotes_history::USE_COMPRESSION);
+    const int num_subfiles = iQuotesHistory.get_num_subfiles();
+    if(num_subfiles == 0) {
+        std::cout << "error! error storage quotes, no data available" << std::endl;
+        return -1;
+    }
+    if(iQuotesHistory.get_file_version() == xquotes_storage::FILE_VERSION_5) {
+        std::cout << "error! storage " << path_storage << " already has format 5" << std::endl;
+        return -1;
+    }
+    iQuotesHistory.enable_concurrent_read();
+
+    const int option = iQuotesHistory.is_compression() ? xquotes_history::USE_COMPRESSION : xquotes_history::DO_NOT_USE_COMPRESSION;
+#   ifdef XQUOTES_USE_DICTIONARY_CURRENCY_PAIR
+    xquotes_history::QuotesHistory<> iOutQuotesHistory(
+        path_out_storage,
+        xquotes_history::get_price_type_with_specific(iQuotesHistory.get_price_layout(), iQuotesHistory.get_currency_pair()),
+        option);
+#   else
+    xquotes_history::QuotesHistory<> iOutQuotesHistory(path_out_storage, iQuotesHistory.get_price_layout(), option);
+#   endif
+    int err = iOutQuotesHistory.set_file_version(xquotes_storage::FILE_VERSION_5);
+    if(err != xquotes_history::OK) {
+        std::cout << "error! storage " << path_out_storage << " code: " << err << std::endl;
+        return -1;
+    }
+    // кодек цен и кадры подфайлов как у исходного файла, знаки после запятой новый файл отслеживает сам
+    if(iOutQuotesHistory.set_price_codec(iQuotesHistory.get_price_codec()) != xquotes_history::OK ||
+        iOutQuotesHistory.set_column_frames(iQuotesHistory.is_column_frames()) != xquotes_history::OK ||
+        iOutQuotesHistory.set_hour_frames(iQuotesHistory.is_hour_frames()) != xquotes_history::OK) {
+        std::cout << "error! storage " << path_out_storage << " subfile format is not supported" << std::endl;
+        return -1;
+    }
+    iOutQuotesHistory.begin_batch(ZQHTOOLS_BATCH_SIZE);
+    std::cout << "start converting " << path_storage << " to format 5" << std::endl;
+    std::array<xquotes_history::Candle, xquotes_history::MINUTES_IN_DAY> candles;
+    for(int s = 0; s < num_subfiles; ++s) {
+        const xquotes_common::key_t key = iQuotesHistory.get_key_subfiles(s);
+        const ztime::timestamp_t timestamp = key * ztime::SECONDS_IN_DAY;
+        err = iQuotesHistory.read_day_candles_concurrent(candles, timestamp);
+        if(err != xquotes_history::OK) {
+            std::cout << "error! subfile " << key << " read error, code: " << err << std::endl;
+            return -1;
+        }
+        err = iOutQuotesHistory.write_candles(candles, timestamp);
+        if(err != xquotes_history::OK) {
+            std::cout << "error! subfile " << key << " write error, code: " << err << std::endl;
+            return -1;
+        }
+        std::cout << "subfiles: " << (s + 1) << "/" << num_subfiles << "\r";
+    }
+    std::cout << std::endl;
+    err = iOutQuotesHistory.commit();
+    if(err != xquotes_history::OK) {
+        std::cout << "storage error, code " << err << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
 void parse(std::string value, std::vector<std::string> &elemet_list) {
     if(value.back() != ',')
         value += ",";
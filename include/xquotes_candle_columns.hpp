@@ -0,0 +1,414 @@
+/*
+* xquotes_history - C++ header-only library for working with historical quotes data
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+/** \file Файл с классами для хранения свечей по столбцам
+ * \brief Данный файл содержит классы Span, CandlesView, CandleColumns, SymbolsMatrix и BlockExtremumIndex
+ *
+ * Свечи хранятся не массивом структур Candle, а отдельными выровненными массивами
+ * цен open, high, low, close и объема. Метка времени свечи не хранится, она вычисляется
+ * по метке времени первой свечи (свечи идут подряд с шагом в одну минуту).
+ * Такое представление удобно для индикаторов и векторизованных стратегий,
+ * которым нужен только один столбец цен
+ */
+#ifndef XQUOTES_CANDLE_COLUMNS_HPP_INCLUDED
+#define XQUOTES_CANDLE_COLUMNS_HPP_INCLUDED
+
+#include "xquotes_common.hpp"
+#include <memory>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+namespace xquotes_candle_columns {
+
+    /** \brief Непрерывный участок массива (указатель и длина)
+     * Класс не владеет данными
+     */
+    template <class T>
+    class Span {
+    private:
+        T *data_ = NULL;
+        size_t size_ = 0;
+    public:
+
+        Span() {};
+
+        Span(T *data, const size_t size) : data_(data), size_(size) {};
+
+        inline T *data() const {return data_;}
+        inline size_t size() const {return size_;}
+        inline bool empty() const {return size_ == 0;}
+        inline T *begin() const {return data_;}
+        inline T *end() const {return data_ + size_;}
+        inline T &operator[](const size_t ind) const {return data_[ind];}
+    };
+
+    /** \brief Представление свечей в виде столбцов
+     * Класс не владеет данными. Метки времени свечей идут подряд с шагом в одну минуту
+     */
+    class CandlesView {
+    public:
+        Span<const double> open;
+        Span<const double> high;
+        Span<const double> low;
+        Span<const double> close;
+        Span<const double> volume;
+        ztime::timestamp_t timestamp = 0;   /**< Метка времени первой свечи */
+
+        CandlesView() {};
+
+        /** \brief Получить количество свечей
+         * \return количество свечей
+         */
+        inline size_t size() const {
+            return close.size();
+        }
+
+        /** \brief Получить метку времени свечи
+         * \param ind индекс свечи
+         * \return метка времени начала свечи
+         */
+        inline ztime::timestamp_t get_timestamp(const size_t ind) const {
+            return timestamp + ind * ztime::SECONDS_IN_MINUTE;
+        }
+    };
+
+    /** \brief Свечи, хранящиеся по столбцам
+     * Каждый столбец (open, high, low, close, volume) лежит в отдельном выровненном массиве
+     */
+    class CandleColumns {
+    public:
+        enum {
+            COLUMN_OPEN = 0,
+            COLUMN_HIGH = 1,
+            COLUMN_LOW = 2,
+            COLUMN_CLOSE = 3,
+            COLUMN_VOLUME = 4,
+            NUM_COLUMNS = 5,
+        };
+
+        static const size_t ALIGNMENT = 64; /**< Выравнивание начала каждого столбца в байтах */
+
+    private:
+        std::unique_ptr<char[]> memory;
+        double *columns[NUM_COLUMNS] = {NULL, NULL, NULL, NULL, NULL};
+        size_t num_candles = 0;
+        size_t capacity = 0;
+        ztime::timestamp_t timestamp = 0;
+
+    public:
+
+        CandleColumns() {};
+
+        CandleColumns(const size_t size) {
+            resize(size);
+        }
+
+        CandleColumns(const CandleColumns&) = delete;
+        CandleColumns& operator=(const CandleColumns&) = delete;
+
+        CandleColumns(CandleColumns&&) = default;
+        CandleColumns& operator=(CandleColumns&&) = default;
+
+        /** \brief Изменить количество свечей
+         * Память выделяется заново только при увеличении количества свечей.
+         * Содержимое столбцов после изменения размера не определено
+         * \param size количество свечей
+         */
+        void resize(const size_t size) {
+            if(size > capacity) {
+                const size_t doubles_in_alignment = ALIGNMENT / sizeof(double);
+                const size_t new_capacity = (size + doubles_in_alignment - 1) / doubles_in_alignment * doubles_in_alignment;
+                memory = std::unique_ptr<char[]>(new char[new_capacity * sizeof(double) * NUM_COLUMNS + ALIGNMENT]);
+                const uintptr_t address = (uintptr_t)memory.get();
+                double *aligned = (double*)((address + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+                for(int i = 0; i < NUM_COLUMNS; ++i) {
+                    columns[i] = aligned + i * new_capacity;
+                }
+                capacity = new_capacity;
+            }
+            num_candles = size;
+        }
+
+        /** \brief Обнулить все столбцы
+         */
+        void clear() {
+            for(int i = 0; i < NUM_COLUMNS; ++i) {
+                if(num_candles > 0) std::memset(columns[i], 0, num_candles * sizeof(double));
+            }
+        }
+
+        inline size_t size() const {return num_candles;}
+
+        /** \brief Установить метку времени первой свечи
+         * \param timestamp метка времени начала первой свечи
+         */
+        inline void set_timestamp(const ztime::timestamp_t &timestamp) {
+            CandleColumns::timestamp = timestamp;
+        }
+
+        /** \brief Получить метку времени свечи
+         * \param ind индекс свечи
+         * \return метка времени начала свечи
+         */
+        inline ztime::timestamp_t get_timestamp(const size_t ind = 0) const {
+            return timestamp + ind * ztime::SECONDS_IN_MINUTE;
+        }
+
+        /** \brief Получить столбец для записи
+         * \param column столбец (COLUMN_OPEN, COLUMN_HIGH, COLUMN_LOW, COLUMN_CLOSE, COLUMN_VOLUME)
+         * \return указатель на выровненный массив
+         */
+        inline double *data(const int column) {
+            return columns[column];
+        }
+
+        inline const double *data(const int column) const {
+            return columns[column];
+        }
+
+        inline Span<const double> open() const {return Span<const double>(columns[COLUMN_OPEN], num_candles);}
+        inline Span<const double> high() const {return Span<const double>(columns[COLUMN_HIGH], num_candles);}
+        inline Span<const double> low() const {return Span<const double>(columns[COLUMN_LOW], num_candles);}
+        inline Span<const double> close() const {return Span<const double>(columns[COLUMN_CLOSE], num_candles);}
+        inline Span<const double> volume() const {return Span<const double>(columns[COLUMN_VOLUME], num_candles);}
+
+        /** \brief Получить представление свечей
+         * \param offset индекс первой свечи
+         * \param length количество свечей
+         * \return представление, действительное пока объект не изменен
+         */
+        CandlesView get_view(size_t offset = 0, size_t length = (size_t)-1) const {
+            CandlesView view;
+            if(offset > num_candles) offset = num_candles;
+            if(length > num_candles - offset) length = num_candles - offset;
+            view.open = Span<const double>(columns[COLUMN_OPEN] + offset, length);
+            view.high = Span<const double>(columns[COLUMN_HIGH] + offset, length);
+            view.low = Span<const double>(columns[COLUMN_LOW] + offset, length);
+            view.close = Span<const double>(columns[COLUMN_CLOSE] + offset, length);
+            view.volume = Span<const double>(columns[COLUMN_VOLUME] + offset, length);
+            view.timestamp = get_timestamp(offset);
+            return view;
+        }
+    };
+
+    /** \brief Матрица цен нескольких символов [минуты x символы]
+     * Для каждого поля (open, high, low, close, volume) хранится отдельная матрица, строка матрицы - минута,
+     * столбец - символ. Длина строки дополняется до ALIGNMENT байт, поэтому каждая строка выровнена
+     * и цены всех символов одной минуты можно обрабатывать векторными инструкциями.
+     * Нулевая цена означает, что данных символа за минуту нет
+     */
+    class SymbolsMatrix {
+    public:
+        static const size_t ALIGNMENT = CandleColumns::ALIGNMENT; /**< Выравнивание начала каждой строки в байтах */
+
+    private:
+        std::unique_ptr<char[]> memory;
+        double *fields[CandleColumns::NUM_COLUMNS] = {NULL, NULL, NULL, NULL, NULL};
+        size_t num_minutes = 0;
+        size_t num_symbols = 0;
+        size_t stride = 0;
+        size_t capacity = 0;
+        ztime::timestamp_t timestamp = 0;
+
+    public:
+
+        SymbolsMatrix() {};
+
+        SymbolsMatrix(const size_t minutes, const size_t symbols) {
+            resize(minutes, symbols);
+        }
+
+        SymbolsMatrix(const SymbolsMatrix&) = delete;
+        SymbolsMatrix& operator=(const SymbolsMatrix&) = delete;
+
+        SymbolsMatrix(SymbolsMatrix&&) = default;
+        SymbolsMatrix& operator=(SymbolsMatrix&&) = default;
+
+        /** \brief Изменить размер матрицы
+         * Память выделяется заново только при увеличении размера матриц.
+         * Содержимое матриц после изменения размера не определено
+         * \param minutes количество минут (строк)
+         * \param symbols количество символов (столбцов)
+         */
+        void resize(const size_t minutes, const size_t symbols) {
+            const size_t doubles_in_alignment = ALIGNMENT / sizeof(double);
+            stride = (symbols + doubles_in_alignment - 1) / doubles_in_alignment * doubles_in_alignment;
+            const size_t size = minutes * stride;
+            if(size > capacity) {
+                memory = std::unique_ptr<char[]>(new char[size * sizeof(double) * CandleColumns::NUM_COLUMNS + ALIGNMENT]);
+                capacity = size;
+            }
+            const uintptr_t address = (uintptr_t)memory.get();
+            double *aligned = (double*)((address + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+            for(int i = 0; i < CandleColumns::NUM_COLUMNS; ++i) {
+                fields[i] = aligned + i * capacity;
+            }
+            num_minutes = minutes;
+            num_symbols = symbols;
+        }
+
+        /** \brief Обнулить все матрицы
+         */
+        void clear() {
+            for(int i = 0; i < CandleColumns::NUM_COLUMNS; ++i) {
+                if(num_minutes > 0) std::memset(fields[i], 0, num_minutes * stride * sizeof(double));
+            }
+        }
+
+        inline size_t get_num_minutes() const {return num_minutes;}
+        inline size_t get_num_symbols() const {return num_symbols;}
+
+        /** \brief Получить длину строки матрицы
+         * \return количество элементов строки с учетом выравнивания (не меньше количества символов)
+         */
+        inline size_t get_stride() const {return stride;}
+
+        /** \brief Установить метку времени первой минуты
+         * \param timestamp метка времени начала первой минуты
+         */
+        inline void set_timestamp(const ztime::timestamp_t &timestamp) {
+            SymbolsMatrix::timestamp = timestamp;
+        }
+
+        /** \brief Получить метку времени минуты
+         * \param ind индекс минуты (строки)
+         * \return метка времени начала минуты
+         */
+        inline ztime::timestamp_t get_timestamp(const size_t ind = 0) const {
+            return timestamp + ind * ztime::SECONDS_IN_MINUTE;
+        }
+
+        /** \brief Получить матрицу поля для записи
+         * \param field поле (CandleColumns::COLUMN_OPEN ... CandleColumns::COLUMN_VOLUME)
+         * \return указатель на выровненную матрицу, элемент [минута, символ] лежит по индексу минута * get_stride() + символ
+         */
+        inline double *data(const int field) {
+            return fields[field];
+        }
+
+        inline const double *data(const int field) const {
+            return fields[field];
+        }
+
+        /** \brief Получить цены всех символов за минуту
+         * \param field поле (CandleColumns::COLUMN_OPEN ... CandleColumns::COLUMN_VOLUME)
+         * \param minute индекс минуты (строки)
+         * \return выровненная строка матрицы из get_num_symbols() цен
+         */
+        inline Span<const double> row(const int field, const size_t minute) const {
+            return Span<const double>(fields[field] + minute * stride, num_symbols);
+        }
+
+        inline double at(const int field, const size_t minute, const size_t symbol) const {
+            return fields[field][minute * stride + symbol];
+        }
+    };
+
+    /** \brief Индекс максимумов high и минимумов low по блокам свечей
+     * Свечи делятся на блоки по BLOCK_SIZE минут, для каждого блока хранится максимум high,
+     * минимум low и признак пропуска. Пропуском считается свеча, у которой high, low или close равны нулю.
+     * Индекс позволяет найти первое касание уровней, не проверяя свечи блоков, цены которых лежат между уровнями
+     */
+    class BlockExtremumIndex {
+    public:
+        enum {
+            BLOCK_SIZE = 32,    ///< Количество свечей в блоке
+        };
+
+    private:
+        std::vector<double> max_high;
+        std::vector<double> min_low;
+        std::vector<uint8_t> is_gap;
+        size_t num_candles = 0;
+
+        static inline bool check_gap(const CandlesView &view, const size_t ind) {
+            return view.high[ind] == 0.0 || view.low[ind] == 0.0 || view.close[ind] == 0.0;
+        }
+
+    public:
+
+        BlockExtremumIndex() {};
+
+        /** \brief Построить индекс
+         * \param view свечи в виде столбцов
+         */
+        void build(const CandlesView &view) {
+            num_candles = view.size();
+            const size_t num_blocks = (num_candles + BLOCK_SIZE - 1) / BLOCK_SIZE;
+            max_high.assign(num_blocks, std::numeric_limits<double>::lowest());
+            min_low.assign(num_blocks, std::numeric_limits<double>::max());
+            is_gap.assign(num_blocks, 0);
+            for(size_t i = 0; i < num_candles; ++i) {
+                const size_t block = i / BLOCK_SIZE;
+                if(check_gap(view, i)) {
+                    is_gap[block] = 1;
+                    continue;
+                }
+                max_high[block] = std::max(max_high[block], view.high[i]);
+                min_low[block] = std::min(min_low[block], view.low[i]);
+            }
+        }
+
+        inline size_t size() const {return num_candles;}
+
+        /** \brief Найти первую свечу, которая коснулась уровней
+         * Свеча касается уровней, если ее low <= low_level или high >= high_level.
+         * Если пропуски не игнорируются, первый пропуск тоже останавливает поиск
+         * \param view свечи, по которым построен индекс
+         * \param start индекс свечи, с которой начинается поиск
+         * \param low_level нижний уровень
+         * \param high_level верхний уровень
+         * \param is_ignore_gaps если true, пропуски не останавливают поиск
+         * \return индекс найденной свечи или size(), если касаний нет
+         */
+        size_t find_first_touch(
+                const CandlesView &view,
+                size_t start,
+                const double low_level,
+                const double high_level,
+                const bool is_ignore_gaps) const {
+            while(start < num_candles) {
+                const size_t block = start / BLOCK_SIZE;
+                const size_t block_end = std::min(num_candles, (block + 1) * BLOCK_SIZE);
+                if(max_high[block] < high_level && min_low[block] > low_level && (is_ignore_gaps || !is_gap[block])) {
+                    start = block_end;
+                    continue;
+                }
+                for(; start < block_end; ++start) {
+                    if(check_gap(view, start)) {
+                        if(is_ignore_gaps) continue;
+                        return start;
+                    }
+                    if(view.low[start] <= low_level || view.high[start] >= high_level) return start;
+                }
+            }
+            return num_candles;
+        }
+    };
+}
+
+#endif // XQUOTES_CANDLE_COLUMNS_HPP_INCLUDED
@@ -0,0 +1,374 @@
+/*
+* xquotes_history - C++ header-only library for working with historical quotes data
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/** \file Файл с кодеком цен подфайла
+ * \brief Данный файл содержит функции предварительного преобразования цен дня перед сжатием
+ *
+ * Кодек раскладывает цены по столбцам (open, high, low, close, volume), заменяет каждую цену
+ * разностью с ценой закрытия предыдущей минуты (объем - разностью с предыдущим объемом),
+ * переводит разности в беззнаковые числа (zigzag) и упаковывает их блоками по 32 числа
+ * минимально необходимым количеством бит. Цены кодируются как 32-битные числа.
+ * Упаковка блока выполняется в 4 потока по 8 чисел, что позволяет использовать SSE4.1.
+ * Результат скалярной и векторной упаковки совпадает побитово
+ */
+#ifndef XQUOTES_CODEC_HPP_INCLUDED
+#define XQUOTES_CODEC_HPP_INCLUDED
+
+#include "xquotes_simd.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace xquotes_codec {
+    using namespace xquotes_common;
+
+    /// Кодеки цен подфайла
+    enum {
+        CODEC_NONE = 0,                     ///< Цены хранятся без преобразования
+        CODEC_DELTA_ZIGZAG_BITPACK = 1,     ///< Разности цен, zigzag и упаковка бит
+        CODEC_BLOCK_SIZE = 32,              ///< Количество чисел в блоке упаковки
+        CODEC_NUM_LANES = 4,                ///< Количество потоков упаковки в блоке
+        CODEC_HEADER_SIZE = 4,              ///< Размер заголовка: кодек, количество цен в записи, количество записей
+    };
+
+    /** \brief Получить количество блоков упаковки в столбце
+     * \param num_records количество записей
+     * \return количество блоков
+     */
+    inline size_t get_num_blocks(const size_t num_records) {
+        return (num_records + CODEC_BLOCK_SIZE - 1) / CODEC_BLOCK_SIZE;
+    }
+
+    /** \brief Получить максимальный размер закодированных цен
+     * \param num_records количество записей
+     * \param record_size количество цен в записи
+     * \return размер буфера для encode_prices в байтах
+     */
+    inline size_t get_max_encoded_size(const size_t num_records, const size_t record_size) {
+        const size_t num_blocks = get_num_blocks(num_records);
+        return CODEC_HEADER_SIZE + record_size * num_blocks * (1 + CODEC_BLOCK_SIZE * sizeof(uint32_t));
+    }
+
+    /** \brief Получить размер упакованного блока
+     * \param width количество бит на число
+     * \return размер в байтах
+     */
+    inline size_t get_packed_block_size(const int width) {
+        const size_t lane_words = (width * (CODEC_BLOCK_SIZE / CODEC_NUM_LANES) + 31) / 32;
+        return lane_words * CODEC_NUM_LANES * sizeof(uint32_t);
+    }
+
+    /** \brief Перевести разность в беззнаковое число
+     */
+    inline uint32_t encode_zigzag(const uint32_t delta) {
+        return (delta << 1) ^ (uint32_t)((int32_t)delta >> 31);
+    }
+
+    /** \brief Перевести беззнаковое число обратно в разность
+     */
+    inline uint32_t decode_zigzag(const uint32_t value) {
+        return (value >> 1) ^ (0 - (value & 1));
+    }
+
+    /** \brief Получить количество бит, необходимое для хранения чисел блока
+     * \param block блок из CODEC_BLOCK_SIZE чисел
+     * \return количество бит (от 0 до 32)
+     */
+    inline int get_bit_width(const uint32_t *block) {
+        uint32_t mask = 0;
+        for(int i = 0; i < CODEC_BLOCK_SIZE; ++i) mask |= block[i];
+        int width = 0;
+        while(mask != 0) {
+            mask >>= 1;
+            ++width;
+        }
+        return width;
+    }
+
+    /** \brief Упаковать блок чисел (скалярный код)
+     * Число i блока попадает в поток i % CODEC_NUM_LANES, слово j потока l записывается в out[j * CODEC_NUM_LANES + l]
+     * \param block блок из CODEC_BLOCK_SIZE чисел
+     * \param width количество бит на число
+     * \param out упакованные данные (см. get_packed_block_size)
+     */
+    inline void pack_block_scalar(const uint32_t *block, const int width, uint32_t *out) {
+        for(int lane = 0; lane < CODEC_NUM_LANES; ++lane) {
+            uint64_t acc = 0;
+            int bits = 0;
+            int word = 0;
+            for(int i = lane; i < CODEC_BLOCK_SIZE; i += CODEC_NUM_LANES) {
+                acc |= (uint64_t)block[i] << bits;
+                bits += width;
+                if(bits >= 32) {
+                    out[word * CODEC_NUM_LANES + lane] = (uint32_t)acc;
+                    ++word;
+                    acc >>= 32;
+                    bits -= 32;
+                }
+            }
+            if(bits > 0) out[word * CODEC_NUM_LANES + lane] = (uint32_t)acc;
+        }
+    }
+
+    /** \brief Распаковать блок чисел (скалярный код)
+     * \param in упакованные данные
+     * \param width количество бит на число
+     * \param block блок из CODEC_BLOCK_SIZE чисел
+     */
+    inline void unpack_block_scalar(const uint32_t *in, const int width, uint32_t *block) {
+        const uint64_t mask = ((uint64_t)1 << width) - 1;
+        for(int lane = 0; lane < CODEC_NUM_LANES; ++lane) {
+            uint64_t acc = 0;
+            int bits = 0;
+            int word = 0;
+            for(int i = lane; i < CODEC_BLOCK_SIZE; i += CODEC_NUM_LANES) {
+                if(bits < width) {
+                    acc |= (uint64_t)in[word * CODEC_NUM_LANES + lane] << bits;
+                    ++word;
+                    bits += 32;
+                }
+                block[i] = (uint32_t)(acc & mask);
+                acc >>= width;
+                bits -= width;
+            }
+        }
+    }
+
+#   ifdef XQUOTES_SIMD_X86
+    /** \brief Упаковать блок чисел (SSE4.1)
+     */
+    XQUOTES_SIMD_TARGET_SSE41
+    inline void pack_block_sse41(const uint32_t *block, const int width, uint32_t *out) {
+        __m128i acc = _mm_setzero_si128();
+        int bits = 0;
+        for(int i = 0; i < CODEC_BLOCK_SIZE; i += CODEC_NUM_LANES) {
+            const __m128i value = _mm_loadu_si128((const __m128i*)(block + i));
+            acc = _mm_or_si128(acc, _mm_sll_epi32(value, _mm_cvtsi32_si128(bits)));
+            bits += width;
+            if(bits >= 32) {
+                _mm_storeu_si128((__m128i*)out, acc);
+                out += CODEC_NUM_LANES;
+                bits -= 32;
+                // при сдвиге на 32 бита SSE возвращает 0
+                acc = _mm_srl_epi32(value, _mm_cvtsi32_si128(width - bits));
+            }
+        }
+        if(bits > 0) _mm_storeu_si128((__m128i*)out, acc);
+    }
+
+    /** \brief Распаковать блок чисел (SSE4.1)
+     */
+    XQUOTES_SIMD_TARGET_SSE41
+    inline void unpack_block_sse41(const uint32_t *in, const int width, uint32_t *block) {
+        const __m128i mask = width == 32 ? _mm_set1_epi32(-1) : _mm_set1_epi32((int)((1u << width) - 1));
+        __m128i word = _mm_loadu_si128((const __m128i*)in);
+        int bits = 0;
+        for(int i = 0; i < CODEC_BLOCK_SIZE; i += CODEC_NUM_LANES) {
+            __m128i value = _mm_srl_epi32(word, _mm_cvtsi32_si128(bits));
+            bits += width;
+            if(bits > 32 || (bits == 32 && i + CODEC_NUM_LANES < CODEC_BLOCK_SIZE)) {
+                // число продолжается в следующем слове потока или следующее число начинается с нового слова
+                in += CODEC_NUM_LANES;
+                bits -= 32;
+                word = _mm_loadu_si128((const __m128i*)in);
+                if(bits > 0) value = _mm_or_si128(value, _mm_sll_epi32(word, _mm_cvtsi32_si128(width - bits)));
+            }
+            _mm_storeu_si128((__m128i*)(block + i), _mm_and_si128(value, mask));
+        }
+    }
+#   endif
+
+    /** \brief Упаковать блок чисел
+     * \param block блок из CODEC_BLOCK_SIZE чисел
+     * \param width количество бит на число
+     * \param out упакованные данные
+     */
+    inline void pack_block(const uint32_t *block, const int width, uint32_t *out) {
+#       ifdef XQUOTES_SIMD_X86
+        if(xquotes_simd::get_simd_level() >= xquotes_simd::SIMD_SSE41) {
+            pack_block_sse41(block, width, out);
+            return;
+        }
+#       endif
+        pack_block_scalar(block, width, out);
+    }
+
+    /** \brief Распаковать блок чисел
+     * \param in упакованные данные
+     * \param width количество бит на число
+     * \param block блок из CODEC_BLOCK_SIZE чисел
+     */
+    inline void unpack_block(const uint32_t *in, const int width, uint32_t *block) {
+#       ifdef XQUOTES_SIMD_X86
+        if(xquotes_simd::get_simd_level() >= xquotes_simd::SIMD_SSE41) {
+            unpack_block_sse41(in, width, block);
+            return;
+        }
+#       endif
+        unpack_block_scalar(in, width, block);
+    }
+
+    /** \brief Закодировать цены
+     * Буфер цен состоит из num_records записей по record_size цен подряд (1 - одна цена, 4 - OHLC, 5 - OHLCV).
+     * Закодированные данные: заголовок, затем для каждого столбца ширины блоков и упакованные блоки
+     * \param prices буфер цен
+     * \param num_records количество записей (не больше 65535)
+     * \param record_size количество цен в записи
+     * \param out буфер размером не меньше get_max_encoded_size(num_records, record_size)
+     * \return размер закодированных данных, или 0, если цены нельзя закодировать (цена не помещается в 32 бита)
+     */
+    template<class PRICE_T>
+    size_t encode_prices(
+            const PRICE_T *prices,
+            const size_t num_records,
+            const size_t record_size,
+            char *out) {
+        if(num_records == 0 || num_records > 0xFFFF) return 0;
+        if(record_size != 1 && record_size != 4 && record_size != 5) return 0;
+        if(sizeof(PRICE_T) > sizeof(uint32_t)) {
+            for(size_t i = 0; i < num_records * record_size; ++i) {
+                if(prices[i] > (PRICE_T)0xFFFFFFFF) return 0;
+            }
+        }
+        /* цены open, high, low и close отсчитываются от цены закрытия предыдущей минуты,
+         * поэтому ссылкой для них служит столбец close, а для объема - сам столбец объема
+         */
+        const size_t close_column = record_size == 1 ? 0 : 3;
+        unsigned char *header = (unsigned char*)out;
+        header[0] = CODEC_DELTA_ZIGZAG_BITPACK;
+        header[1] = (unsigned char)record_size;
+        header[2] = (unsigned char)(num_records & 0xFF);
+        header[3] = (unsigned char)(num_records >> 8);
+        char *data = out + CODEC_HEADER_SIZE;
+        const size_t num_blocks = get_num_blocks(num_records);
+        uint32_t block[CODEC_BLOCK_SIZE];
+        uint32_t packed[CODEC_BLOCK_SIZE];
+        for(size_t column = 0; column < record_size; ++column) {
+            const size_t ref_column = column == 4 ? 4 : close_column;
+            unsigned char *widths = (unsigned char*)data;
+            data += num_blocks;
+            for(size_t b = 0; b < num_blocks; ++b) {
+                for(size_t k = 0; k < CODEC_BLOCK_SIZE; ++k) {
+                    const size_t i = b * CODEC_BLOCK_SIZE + k;
+                    if(i >= num_records) {
+                        block[k] = 0;
+                        continue;
+                    }
+                    const uint32_t ref = i == 0 ? 0 : (uint32_t)prices[(i - 1) * record_size + ref_column];
+                    block[k] = encode_zigzag((uint32_t)prices[i * record_size + column] - ref);
+                }
+                const int width = get_bit_width(block);
+                widths[b] = (unsigned char)width;
+                if(width == 0) continue;
+                pack_block(block, width, packed);
+                const size_t packed_size = get_packed_block_size(width);
+                std::memcpy(data, packed, packed_size);
+                data += packed_size;
+            }
+        }
+        return (size_t)(data - out);
+    }
+
+    /** \brief Прочитать заголовок закодированных цен
+     * \param in закодированные данные
+     * \param in_size размер закодированных данных
+     * \param num_records количество записей
+     * \param record_size количество цен в записи
+     * \return вернет true, если заголовок корректен
+     */
+    inline bool get_encoded_info(
+            const char *in,
+            const size_t in_size,
+            size_t &num_records,
+            size_t &record_size) {
+        if(in_size < CODEC_HEADER_SIZE) return false;
+        const unsigned char *header = (const unsigned char*)in;
+        if(header[0] != CODEC_DELTA_ZIGZAG_BITPACK) return false;
+        record_size = header[1];
+        num_records = (size_t)header[2] | ((size_t)header[3] << 8);
+        if(record_size != 1 && record_size != 4 && record_size != 5) return false;
+        return num_records != 0;
+    }
+
+    /** \brief Декодировать цены
+     * \param in закодированные данные
+     * \param in_size размер закодированных данных
+     * \param prices буфер цен размером num_records * record_size из заголовка (см. get_encoded_info)
+     * \return вернет true в случае успеха
+     */
+    template<class PRICE_T>
+    bool decode_prices(
+            const char *in,
+            const size_t in_size,
+            PRICE_T *prices) {
+        size_t num_records = 0, record_size = 0;
+        if(!get_encoded_info(in, in_size, num_records, record_size)) return false;
+        const char *data = in + CODEC_HEADER_SIZE;
+        const char *data_end = in + in_size;
+        const size_t num_blocks = get_num_blocks(num_records);
+        uint32_t packed[CODEC_BLOCK_SIZE];
+        uint32_t block[CODEC_BLOCK_SIZE];
+        // сначала распакуем разности во все столбцы
+        for(size_t column = 0; column < record_size; ++column) {
+            if((size_t)(data_end - data) < num_blocks) return false;
+            const unsigned char *widths = (const unsigned char*)data;
+            data += num_blocks;
+            for(size_t b = 0; b < num_blocks; ++b) {
+                const int width = widths[b];
+                if(width > 32) return false;
+                if(width == 0) {
+                    std::memset(block, 0, sizeof(block));
+                } else {
+                    const size_t packed_size = get_packed_block_size(width);
+                    if((size_t)(data_end - data) < packed_size) return false;
+                    std::memcpy(packed, data, packed_size);
+                    data += packed_size;
+                    unpack_block(packed, width, block);
+                }
+                const size_t block_records = std::min((size_t)CODEC_BLOCK_SIZE, num_records - b * CODEC_BLOCK_SIZE);
+                for(size_t k = 0; k < block_records; ++k) {
+                    prices[(b * CODEC_BLOCK_SIZE + k) * record_size + column] = decode_zigzag(block[k]);
+                }
+            }
+        }
+        if(data != data_end) return false;
+        // затем восстановим цены по порядку записей
+        const size_t close_column = record_size == 1 ? 0 : 3;
+        uint32_t prev_close = 0, prev_volume = 0;
+        for(size_t i = 0; i < num_records; ++i) {
+            PRICE_T *record = prices + i * record_size;
+            for(size_t column = 0; column < record_size; ++column) {
+                const uint32_t ref = column == 4 ? prev_volume : prev_close;
+                record[column] = (uint32_t)record[column] + ref;
+            }
+            prev_close = (uint32_t)record[close_column];
+            if(record_size == 5) prev_volume = (uint32_t)record[4];
+        }
+        return true;
+    }
+}
+
+#endif // XQUOTES_CODEC_HPP_INCLUDED
@@ -33,12 +33,14 @@
 #include <iostream>
 #include <cstdlib>
 #include <cmath>
+#include <cstdint>
 #include "ztime.hpp"
 
 namespace xquotes_common {
     typedef unsigned short key_t;
-    typedef unsigned long link_t;
+    typedef uint64_t link_t;
     typedef unsigned long price_t;
+    typedef uint32_t fixed_price_t;     ///< Цена в файле формата 5 (ширина не зависит от платформы)
     typedef unsigned long note_t;
 
     const double PRICE_MULTIPLER = 100000.0d;   ///< множитель для 5-ти значных котировок
@@ -136,6 +138,7 @@ namespace xquotes_common {
         SKIPPING_BAD_CANDLES = 0,   ///< Пропускать бары или свечи с отсутствующими данными
         FILLING_BAD_CANDLES = 1,    ///< Заполнять бары или свечи с отсутствующими данными предыдущим значением
         WRITE_BAD_CANDLES = 2,      ///< Записывать как есть бары или свечи с отсутствующими данными
+        PRICE_RUNTIME = -1,         ///< Тип цены хранилища определяется во время работы программы (см. QuotesHistory)
     };
 
     /// Набор возможных состояний ошибки
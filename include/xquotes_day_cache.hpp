@@ -0,0 +1,250 @@
+/*
+* xquotes_history - C++ header-only library for working with historical quotes data
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/** \file Файл с классом общего кэша дней котировок
+ * \brief Данный файл содержит класс DayCache
+ *
+ * Класс DayCache хранит распакованные дни котировок (массивы минутных свечей) общие для всех
+ * экземпляров QuotesHistory в процессе. Если несколько стратегий читают один и тот же символ,
+ * каждый день распаковывается только один раз. Кэш ограничен по памяти и вытесняет дни,
+ * которые дольше всего не использовались. По умолчанию кэш выключен (бюджет памяти равен нулю)
+ */
+#ifndef XQUOTES_DAY_CACHE_HPP_INCLUDED
+#define XQUOTES_DAY_CACHE_HPP_INCLUDED
+
+#include "xquotes_common.hpp"
+#include <array>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <iterator>
+
+namespace xquotes_day_cache {
+    using namespace xquotes_common;
+
+    /** \brief Класс общего кэша распакованных дней котировок
+     * \details Кэш потокобезопасный. Ключом является пара (путь к файлу, день)
+     */
+    template <class CANDLE_TYPE = Candle>
+    class DayCache {
+    public:
+        typedef std::array<CANDLE_TYPE, MINUTES_IN_DAY> candles_array_t;
+
+    private:
+        typedef std::pair<std::string, key_t> cache_key_t;
+
+        class CacheEntry {
+        public:
+            cache_key_t key;
+            candles_array_t candles;
+        };
+
+        std::list<CacheEntry> entries;      /**< Дни в порядке использования, в начале списка последний использованный день */
+        std::map<cache_key_t, typename std::list<CacheEntry>::iterator> entries_map;
+        size_t memory_budget = 0;           /**< Бюджет памяти в байтах */
+        size_t memory_used = 0;             /**< Используемая память в байтах */
+        unsigned long long hits = 0;        /**< Количество попаданий в кэш */
+        unsigned long long misses = 0;      /**< Количество промахов кэша */
+        mutable std::mutex cache_mutex;
+
+        DayCache() {};
+
+        inline size_t get_entry_size(const cache_key_t &key) const {
+            return sizeof(CacheEntry) + key.first.size();
+        }
+
+        void remove_entry(const typename std::list<CacheEntry>::iterator &it) {
+            memory_used -= get_entry_size(it->key);
+            entries_map.erase(it->key);
+            entries.erase(it);
+        }
+
+        void shrink_to_budget() {
+            while(entries.size() > 0 && memory_used > memory_budget) {
+                remove_entry(std::prev(entries.end()));
+            }
+        }
+
+    public:
+
+        DayCache(const DayCache&) = delete;
+        DayCache& operator=(const DayCache&) = delete;
+
+        /** \brief Получить общий кэш процесса
+         * \return ссылка на кэш
+         */
+        static DayCache &get_instance() {
+            static DayCache instance;
+            return instance;
+        }
+
+        /** \brief Установить бюджет памяти кэша
+         * \details Если бюджет меньше используемой памяти, лишние дни будут вытеснены.
+         * Нулевой бюджет выключает кэш
+         * \param budget бюджет памяти в байтах
+         */
+        void set_memory_budget(const size_t budget) {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            memory_budget = budget;
+            shrink_to_budget();
+        }
+
+        /** \brief Получить бюджет памяти кэша
+         * \return бюджет памяти в байтах
+         */
+        size_t get_memory_budget() const {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            return memory_budget;
+        }
+
+        /** \brief Получить используемую кэшем память
+         * \return используемая память в байтах
+         */
+        size_t get_memory_used() const {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            return memory_used;
+        }
+
+        /** \brief Получить количество дней в кэше
+         * \return количество дней
+         */
+        size_t get_num_days() const {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            return entries.size();
+        }
+
+        /** \brief Проверить, включен ли кэш
+         * \return вернет true, если бюджет памяти больше нуля
+         */
+        bool is_enabled() const {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            return memory_budget > 0;
+        }
+
+        /** \brief Получить день из кэша
+         * \param path путь к файлу котировок
+         * \param day день (ключ подфайла)
+         * \param candles массив свечей за день
+         * \return вернет true, если день найден в кэше
+         */
+        bool get(const std::string &path, const key_t day, candles_array_t &candles) {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            if(memory_budget == 0) return false;
+            auto it = entries_map.find(cache_key_t(path, day));
+            if(it == entries_map.end()) {
+                ++misses;
+                return false;
+            }
+            ++hits;
+            entries.splice(entries.begin(), entries, it->second);
+            candles = it->second->candles;
+            return true;
+        }
+
+        /** \brief Добавить день в кэш
+         * \param path путь к файлу котировок
+         * \param day день (ключ подфайла)
+         * \param candles массив свечей за день
+         */
+        void put(const std::string &path, const key_t day, const candles_array_t &candles) {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            const cache_key_t key(path, day);
+            if(memory_budget < get_entry_size(key)) return;
+            auto it = entries_map.find(key);
+            if(it != entries_map.end()) {
+                it->second->candles = candles;
+                entries.splice(entries.begin(), entries, it->second);
+                return;
+            }
+            entries.push_front(CacheEntry());
+            entries.front().key = key;
+            entries.front().candles = candles;
+            entries_map[key] = entries.begin();
+            memory_used += get_entry_size(key);
+            shrink_to_budget();
+        }
+
+        /** \brief Удалить день из кэша
+         * \details Метод нужно вызывать при изменении дня в файле котировок
+         * \param path путь к файлу котировок
+         * \param day день (ключ подфайла)
+         */
+        void erase(const std::string &path, const key_t day) {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            auto it = entries_map.find(cache_key_t(path, day));
+            if(it != entries_map.end()) remove_entry(it->second);
+        }
+
+        /** \brief Удалить все дни файла из кэша
+         * \param path путь к файлу котировок
+         */
+        void erase(const std::string &path) {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            auto it = entries_map.lower_bound(cache_key_t(path, 0));
+            while(it != entries_map.end() && it->first.first == path) {
+                auto it_next = std::next(it);
+                remove_entry(it->second);
+                it = it_next;
+            }
+        }
+
+        /** \brief Очистить кэш
+         */
+        void clear() {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            entries_map.clear();
+            entries.clear();
+            memory_used = 0;
+        }
+
+        /** \brief Получить количество попаданий в кэш
+         * \return количество попаданий
+         */
+        unsigned long long get_hits() const {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            return hits;
+        }
+
+        /** \brief Получить количество промахов кэша
+         * \return количество промахов
+         */
+        unsigned long long get_misses() const {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            return misses;
+        }
+
+        /** \brief Сбросить счетчики попаданий и промахов
+         */
+        void reset_statistics() {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            hits = 0;
+            misses = 0;
+        }
+    };
+}
+
+#endif // XQUOTES_DAY_CACHE_HPP_INCLUDED
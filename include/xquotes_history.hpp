@@ -31,11 +31,20 @@
 #define XQUOTES_HISTORY_HPP_INCLUDED
 
 #include "xquotes_storage.hpp"
+#include "xquotes_day_cache.hpp"
+#include "xquotes_candle_columns.hpp"
+#include "xquotes_simd.hpp"
+#include "xquotes_codec.hpp"
 #include <array>
+#include <type_traits>
+#include <utility>
 #include <functional>
+#include <algorithm>
 #ifndef XQUOTES_DO_NOT_USE_THREAD
 #include <thread>
 #include <mutex>
+#include "xquotes_prefetch.hpp"
+#include "xquotes_thread_pool.hpp"
 #endif
 
 // подключаем словари для сжатия файлов
@@ -82,16 +91,44 @@ namespace xquotes_history {
     using namespace xquotes_common;
     using namespace xquotes_storage;
     using namespace xquotes_dictionary;
+    using namespace xquotes_candle_columns;
+
+    /** \brief Итоги дня котировок
+     * Итоги записываются в заголовок хранилища при записи дня (см. QuotesHistory::get_day_summary),
+     * поэтому для их чтения не нужно распаковывать подфайл дня.
+     * Минута считается валидной, если цена закрытия ее свечи не равна нулю
+     */
+    class DaySummary {
+    public:
+        double open = 0;                ///< Цена открытия первой валидной минуты
+        double high = 0;                ///< Максимальная цена дня
+        double low = 0;                 ///< Минимальная цена дня
+        double close = 0;               ///< Цена закрытия последней валидной минуты
+        double volume = 0;              ///< Суммарный объем за день
+        int num_minutes = 0;            ///< Количество валидных минут
+        int first_minute = -1;          ///< Первая валидная минута дня, -1 если данных нет
+        int last_minute = -1;           ///< Последняя валидная минута дня, -1 если данных нет
+        ztime::timestamp_t timestamp = 0;   ///< Метка времени начала дня
+
+        DaySummary() {};
+    };
 
     /** \brief Класс для удобного использования исторических данных
      * Данный класс имеет оптимизированный для поминутного чтения данных метод - get_candle
      * Оптимизация метода get_candle заключается в том, что поиск следующей цены начинается только в случае,
      * если метка времени следующей цены не совпала с запрашиваемой меткой времени
      * Метод find_candle является по сути аналогом get_candle, но он всегда ищет цену
+     *
+     * Параметр шаблона PRICE_LAYOUT задает тип цены хранилища (PRICE_CLOSE, PRICE_OPEN, PRICE_OHLC или PRICE_OHLCV)
+     * на этапе компиляции. Тогда конвертация дней котировок компилируется без ветвлений по типу цены.
+     * По умолчанию (PRICE_RUNTIME) тип цены берется из заметки файла или из настроек пользователя
      */
-    template <class CANDLE_TYPE = Candle>
+    template <class CANDLE_TYPE = Candle, int PRICE_LAYOUT = PRICE_RUNTIME>
     class QuotesHistory : public Storage {
     private:
+        static_assert(PRICE_LAYOUT == PRICE_RUNTIME || PRICE_LAYOUT == PRICE_CLOSE || PRICE_LAYOUT == PRICE_OPEN ||
+            PRICE_LAYOUT == PRICE_OHLC || PRICE_LAYOUT == PRICE_OHLCV, "PRICE_LAYOUT must be PRICE_RUNTIME, PRICE_CLOSE, PRICE_OPEN, PRICE_OHLC or PRICE_OHLCV");
+
         typedef std::array<CANDLE_TYPE, MINUTES_IN_DAY> candles_array_t;    /**< Массив свечей */
         bool is_use_dictionary = false; /**< Флаг использования словаря */
         int price_type = PRICE_CLOSE;   /**< Тип используемой в хранилище цены */
@@ -102,6 +139,59 @@ namespace xquotes_history {
         std::string path_;
         std::string name_;
 
+        /** \brief Выбрать тип цены для нового хранилища
+         * Тип цены, заданный параметром шаблона, имеет приоритет над настройкой пользователя
+         * \param user_price_type тип цены из настроек пользователя
+         * \return тип цены
+         */
+        static inline int select_price_layout(const int &user_price_type) {
+            return PRICE_LAYOUT == PRICE_RUNTIME ? user_price_type : PRICE_LAYOUT;
+        }
+
+        /** \brief Получить количество цен в минуте для типа цены
+         * \param layout тип цены
+         * \return количество цен (1, 4 или 5)
+         */
+        static inline size_t get_layout_record_size(const int &layout) {
+            return layout == PRICE_OHLCV ? 5 : layout == PRICE_OHLC ? 4 : 1;
+        }
+
+        /** \brief Получить размер цены в буфере дня
+         * В формате файла 5 цены всегда занимают 4 байта, в формате 4 - sizeof(price_t)
+         * \return размер цены в байтах
+         */
+        inline size_t get_price_size() const {
+            return get_file_version() == FILE_VERSION_5 ? sizeof(fixed_price_t) : sizeof(price_t);
+        }
+
+        /// Биты заметки файла с настройками формата подфайлов
+        enum {
+            CODEC_NOTES_SHIFT = 16,                 ///< Сдвиг бит кодека цен
+            CODEC_NOTES_MASK = 0xF0000,             ///< Биты кодека цен
+            COLUMN_FRAMES_NOTES_BIT = 0x100000,     ///< Бит хранения столбцов цен в отдельных кадрах подфайла
+            HOUR_FRAMES_NOTES_BIT = 0x200000,       ///< Бит хранения часов дня в отдельных кадрах подфайла
+            DECIMAL_PLACES_NOTES_SHIFT = 22,        ///< Сдвиг бит количества знаков после запятой
+            DECIMAL_PLACES_NOTES_MASK = 0x1C00000,  ///< Биты количества знаков после запятой плюс один, 0 - неизвестно (старые файлы)
+            MAX_DECIMAL_PLACES = 5,                 ///< Количество знаков после запятой у цен в единицах 1 / PRICE_MULTIPLER
+        };
+
+        /// Разбиение дня на часовые кадры
+        enum {
+            MINUTES_IN_HOUR_FRAME = 60,                                     ///< Количество минут в часовом кадре
+            NUM_HOUR_FRAMES = MINUTES_IN_DAY / MINUTES_IN_HOUR_FRAME,       ///< Количество часовых кадров в дне
+        };
+
+        typedef std::array<CANDLE_TYPE, MINUTES_IN_HOUR_FRAME> hour_candles_array_t;
+
+        /* Кэш часовых кадров для find_candle устроен так же, как окно котировок:
+         * кадр с ключом день * NUM_HOUR_FRAMES + час всегда лежит в ячейке ключ % размер кэша
+         */
+        std::vector<hour_candles_array_t> hour_frames;  /**< Свечи часовых кадров */
+        std::vector<int> hour_frames_key;               /**< Ключ кадра в каждой ячейке кэша, -1 если ячейка пуста */
+        size_t hour_frames_cache_size = NUM_HOUR_FRAMES;/**< Размер кэша часовых кадров */
+
+        int read_columns_mask = (1 << CandleColumns::NUM_COLUMNS) - 1;  /**< Столбцы, читаемые из подфайлов с кадрами */
+
         std::unique_ptr<char[]> write_buffer;   /**< Буфер для записи */
         size_t write_buffer_size = 0;           /**< Размер буфера для записи */
 
@@ -119,6 +209,16 @@ namespace xquotes_history {
         std::unique_ptr<char[]> read_candles_buffer;    /**< Буфер для чтения свечей */
         size_t read_candles_buffer_size = 0;            /**< Размер буфера для чтения свечей */
 
+        /* Буферы пакетной проверки бинарных опционов (check_binary_options) хранятся в классе,
+         * чтобы повторные вызовы не выделяли память заново
+         */
+        enum {
+            BATCH_BLOCK_SIZE = 256,             ///< Количество опционов, цены которых выбираются из буфера дней за один раз
+        };
+        std::vector<int32_t> batch_days_slot;   /**< Ячейка буфера для каждого дня хранилища, -1 если день не нужен */
+        std::vector<double> batch_days_close;   /**< Цены закрытия нужных дней */
+        std::vector<double> batch_days_open;    /**< Цены открытия нужных дней (только для PRICE_OPEN) */
+
         /** \brief Изменить размер буффера для чтения свечей
          * Данная функция работает только на увеличение размера буффера
          * \param new_size новый размер
@@ -130,61 +230,62 @@ namespace xquotes_history {
             }
         }
 
-        std::vector<candles_array_t> candles_array_days; /**< Котировки в виде минутных свечей, отсортирован по дням */
-
-        /** \brief Получить метку времени начала дня массива цен по индексу элемента
+        /* Окно котировок хранится в кольцевом буфере дней.
+         * Размер буфера равен indent_day_dn + indent_day_up + 1, память под него выделяется один раз
+         * (и заново только при изменении отступов). День day всегда лежит в ячейке day % размер буфера,
+         * поэтому при сдвиге окна загружаются только новые дни, без сортировки и перемещения данных
+         */
+        std::vector<candles_array_t> candles_array_days;    /**< Кольцевой буфер дней с минутными свечами */
+        std::vector<int> candles_array_days_key;            /**< Ключ (день) в каждой ячейке кольцевого буфера, -1 если ячейка пуста */
+        int window_start_day = 0;                           /**< Первый день окна котировок */
+        std::vector<CandleColumns> columns_days;            /**< Дни окна котировок в виде столбцов, ячейки совпадают с candles_array_days */
+        std::vector<int> columns_days_key;                  /**< Ключ (день) в каждой ячейке columns_days, -1 если столбцы не заполнены */
+        std::vector<BlockExtremumIndex> extremum_days;      /**< Индексы экстремумов дней окна, ячейки совпадают с columns_days */
+        std::vector<int> extremum_days_key;                 /**< Ключ (день) в каждой ячейке extremum_days, -1 если индекс не построен */
+
+        /** \brief Получить индекс ячейки кольцевого буфера для дня
          * Данный метод нужен для внутреннего использования
-         * \param ind индекс элемента массива цен
-         * \return метка времени начала дня
+         * \param day день с начала unix времени
+         * \return индекс ячейки в массиве candles_array_days
          */
-        inline ztime::timestamp_t get_prices_timestamp(const int &ind) {
-            return candles_array_days[ind][0].timestamp;
+        inline size_t get_window_slot(const int &day) const {
+            const int num_days = candles_array_days.size();
+            const int slot = day % num_days;
+            return slot < 0 ? slot + num_days : slot;
         }
 
-        /** \brief Сортировка массивов минутных свечей
+        /** \brief Получить массив свечей дня окна по его индексу в окне
          * Данный метод нужен для внутреннего использования
+         * \param ind индекс дня в окне котировок (0 - первый день окна)
+         * \return массив свечей за день
          */
-        void sort_candles_array_days() {
-            if(!std::is_sorted(candles_array_days.begin(), candles_array_days.end(), [](const candles_array_t &a, const candles_array_t &b) {
-                        return a[0].timestamp < b[0].timestamp;
-                    })) {
-                std::sort(candles_array_days.begin(), candles_array_days.end(), [](const candles_array_t &a, const candles_array_t &b) {
-                    return a[0].timestamp < b[0].timestamp;
-                });;
-            }
+        inline candles_array_t &window_day(const int &ind) {
+            return candles_array_days[get_window_slot(window_start_day + ind)];
         }
 
         /** \brief Найти массив свечей за конкретный день
          * Метод ищет массив свечей конкретного дня по метке времени
          * Данный метод нужен для внутреннего использования
          * \param timestamp метка времени (должна быть всегда в начале дня!)
-         * \return указатель на массив свечей или NULL, если даных нет в списке
+         * \return указатель на массив свечей или NULL, если даных нет в окне
          */
-        typename std::vector<candles_array_t>::iterator find_candles_array(
-                const ztime::timestamp_t &timestamp) {
-            if(candles_array_days.size() == 0) return candles_array_days.end();
-            auto prices_it = std::lower_bound(
-                candles_array_days.begin(),
-                candles_array_days.end(),
-                timestamp,
-                [](const candles_array_t &lhs, const ztime::timestamp_t &timestamp) {
-                return lhs[0].timestamp < timestamp;
-            });
-            if(prices_it == candles_array_days.end()) {
-                return candles_array_days.end();
-            } else
-            if(prices_it->at(0).timestamp == timestamp) {
-                //return &(*prices_it);
-                return prices_it;
-            }
-            return candles_array_days.end();
+        inline candles_array_t *find_candles_array(const ztime::timestamp_t &timestamp) {
+            if(candles_array_days.size() == 0) return NULL;
+            const int day = ztime::get_day(timestamp);
+            const size_t slot = get_window_slot(day);
+            if(candles_array_days_key[slot] != day) return NULL;
+            return &candles_array_days[slot];
         }
 
         int indent_day_up = 1;          /**< Отступ в будущее в днях от текущей метки времени */
         int indent_day_dn = 1;          /**< Отступ в прошлое в днях от текущей метки времени */
 
-        int ind_forecast_day = 0;      /**< Прогноз индекса (дня) в массиве candles_array_days */
-        int ind_forecast_minute = 0;   /**< Прогноз индекса в массиве свечей candles_array_days[ind_forecast_day] */
+        int ind_forecast_day = 0;      /**< Прогноз индекса дня в окне котировок, см. window_day */
+        int ind_forecast_minute = 0;   /**< Прогноз индекса в массиве свечей window_day(ind_forecast_day) */
+
+#       ifndef XQUOTES_DO_NOT_USE_THREAD
+        std::unique_ptr<xquotes_prefetch::DayPrefetcher<CANDLE_TYPE>> prefetcher; /**< Фоновая предзагрузка дней */
+#       endif
 
         /** \brief Сделать следующий прогноз для идексов массива свечей
          * Данный метод нужен для внутреннего использования
@@ -207,9 +308,8 @@ namespace xquotes_history {
         inline bool set_start_candles_forecast(
                 const ztime::timestamp_t &timestamp,
                 const int &minute_day) {
-            auto found_candles_array = find_candles_array(timestamp);
-            if(found_candles_array == candles_array_days.end()) return false;
-            ind_forecast_day = found_candles_array - candles_array_days.begin();
+            if(find_candles_array(timestamp) == NULL) return false;
+            ind_forecast_day = ztime::get_day(timestamp) - window_start_day;
             ind_forecast_minute = minute_day;
             return true;
         }
@@ -219,97 +319,748 @@ namespace xquotes_history {
          */
         void fill_timestamp(
                 std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles,
-                const ztime::timestamp_t &timestamp) {
+                const ztime::timestamp_t &timestamp) const {
             candles[0].timestamp = timestamp;
             for(int i = 1; i < MINUTES_IN_DAY; ++i) {
                 candles[i].timestamp = candles[i - 1].timestamp + ztime::SECONDS_IN_MINUTE;
             }
         }
 
-        /** \brief Конвертировать массив свечей в буфер
+        /** \brief Проверить, лежат ли цены свечи в памяти подряд
+         * Если поля open, high, low, close и volume имеют тип double и идут подряд,
+         * то для конвертации свечей используются векторизованные функции из xquotes_simd.hpp
          * Данный метод нужен для внутреннего использования
          */
-        int convert_candles_to_buffer(
+        inline bool is_candles_packed(const CANDLE_TYPE &candle) const {
+            if(!std::is_same<decltype(CANDLE_TYPE::open), double>::value ||
+                !std::is_same<decltype(CANDLE_TYPE::high), double>::value ||
+                !std::is_same<decltype(CANDLE_TYPE::low), double>::value ||
+                !std::is_same<decltype(CANDLE_TYPE::close), double>::value ||
+                !std::is_same<decltype(CANDLE_TYPE::volume), double>::value ||
+                sizeof(CANDLE_TYPE) % sizeof(double) != 0) return false;
+            const char *open = (const char*)&candle.open;
+            return (const char*)&candle.high == open + sizeof(double) &&
+                (const char*)&candle.low == open + 2 * sizeof(double) &&
+                (const char*)&candle.close == open + 3 * sizeof(double) &&
+                (const char*)&candle.volume == open + 4 * sizeof(double);
+        }
+
+        /** \brief Конвертировать массив свечей в цены
+         * Данный метод нужен для внутреннего использования
+         * \param candles массив свечей
+         * \param prices буфер цен
+         * \param layout тип цены
+         */
+        template<class PRICE_T>
+        void convert_candles_to_prices(
                 const std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles,
-                char* buffer,
-                const unsigned long &buffer_size) {
-            if(buffer_size == ONLY_ONE_PRICE_BUFFER_SIZE) {
-                if(price_type == PRICE_CLOSE) {
+                PRICE_T* prices,
+                const int layout) {
+            const size_t record_size = get_layout_record_size(layout);
+            if(is_candles_packed(candles[0])) {
+                const size_t candle_stride = sizeof(CANDLE_TYPE) / sizeof(double);
+                const double *first_price = (const double*)(layout == PRICE_CLOSE ? &candles[0].close : &candles[0].open);
+                xquotes_simd::convert_doubles_to_prices(first_price, candle_stride, prices, MINUTES_IN_DAY, record_size);
+                return;
+            }
+            if(record_size == 1) {
+                if(layout == PRICE_CLOSE) {
                     for(int i = 0; i < MINUTES_IN_DAY; ++i) {
-                        ((price_t*)buffer)[i] = convert_to_uint(candles[i].close);
+                        prices[i] = convert_to_uint(candles[i].close);
                     }
                 } else
-                if(price_type == PRICE_OPEN) {
+                if(layout == PRICE_OPEN) {
                     for(int i = 0; i < MINUTES_IN_DAY; ++i) {
-                        ((price_t*)buffer)[i] = convert_to_uint(candles[i].open);
+                        prices[i] = convert_to_uint(candles[i].open);
                     }
                 }
-            } else
-            if(buffer_size == CANDLE_WITHOUT_VOLUME_BUFFER_SIZE) {
-                const int BUFFER_SAMPLE_SIZE = 4;
+            } else {
                 for(int i = 0; i < MINUTES_IN_DAY; ++i) {
-                    int ind = i * BUFFER_SAMPLE_SIZE;
-                    ((price_t*)buffer)[ind + 0] = convert_to_uint(candles[i].open);
-                    ((price_t*)buffer)[ind + 1] = convert_to_uint(candles[i].high);
-                    ((price_t*)buffer)[ind + 2] = convert_to_uint(candles[i].low);
-                    ((price_t*)buffer)[ind + 3] = convert_to_uint(candles[i].close);
+                    const size_t ind = i * record_size;
+                    prices[ind + 0] = convert_to_uint(candles[i].open);
+                    prices[ind + 1] = convert_to_uint(candles[i].high);
+                    prices[ind + 2] = convert_to_uint(candles[i].low);
+                    prices[ind + 3] = convert_to_uint(candles[i].close);
+                    if(record_size == 5) prices[ind + 4] = convert_to_uint(candles[i].volume);
                 }
-            } else
-            if(buffer_size == CANDLE_WITH_VOLUME_BUFFER_SIZE) {
-                const int BUFFER_SAMPLE_SIZE = 5;
-                for(int i = 0; i < MINUTES_IN_DAY; ++i) {
-                    int ind = i * BUFFER_SAMPLE_SIZE;
-                    ((price_t*)buffer)[ind + 0] = convert_to_uint(candles[i].open);
-                    ((price_t*)buffer)[ind + 1] = convert_to_uint(candles[i].high);
-                    ((price_t*)buffer)[ind + 2] = convert_to_uint(candles[i].low);
-                    ((price_t*)buffer)[ind + 3] = convert_to_uint(candles[i].close);
-                    ((price_t*)buffer)[ind + 4] = convert_to_uint(candles[i].volume);
+            }
+        }
+
+        /** \brief Конвертировать массив свечей в буфер
+         * Данный метод нужен для внутреннего использования
+         */
+        int convert_candles_to_buffer(
+                const std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles,
+                char* buffer,
+                const unsigned long &buffer_size) {
+            /* если тип цены задан параметром шаблона, layout - константа,
+             * и проверки типа цены убираются компилятором
+             */
+            const int layout = get_price_layout();
+            if(layout != PRICE_CLOSE && layout != PRICE_OPEN && layout != PRICE_OHLC && layout != PRICE_OHLCV) return INVALID_PARAMETER;
+            if(buffer_size != get_layout_record_size(layout) * get_price_size() * MINUTES_IN_DAY) return INVALID_ARRAY_LENGH;
+            if(get_price_size() == sizeof(fixed_price_t)) convert_candles_to_prices(candles, (fixed_price_t*)buffer, layout);
+            else convert_candles_to_prices(candles, (price_t*)buffer, layout);
+            return OK;
+        }
+
+        /** \brief Конвертировать цены в свечи
+         * Данный метод нужен для внутреннего использования
+         * \param candles указатель на первую свечу
+         * \param prices буфер цен
+         * \param record_size количество цен в минуте (1, 4 или 5)
+         * \param num_candles количество свечей
+         */
+        template<class PRICE_T>
+        void convert_prices_to_candles(
+                CANDLE_TYPE *candles,
+                const PRICE_T *prices,
+                const size_t record_size,
+                const size_t num_candles) const {
+            if(is_candles_packed(candles[0])) {
+                const size_t candle_stride = sizeof(CANDLE_TYPE) / sizeof(double);
+                double *first_price = (double*)(record_size == 1 ? &candles[0].close : &candles[0].open);
+                xquotes_simd::convert_prices_to_doubles(prices, first_price, num_candles, record_size, candle_stride);
+                return;
+            }
+            if(record_size == 1) {
+                for(size_t i = 0; i < num_candles; ++i) {
+                    candles[i].close = convert_to_double(prices[i]);
                 }
             } else {
-                //std::cout << "buffer_size " << buffer_size << std::endl;
-                return INVALID_ARRAY_LENGH;
+                for(size_t i = 0; i < num_candles; ++i) {
+                    const size_t ind = i * record_size;
+                    candles[i].open = convert_to_double(prices[ind + 0]);
+                    candles[i].high = convert_to_double(prices[ind + 1]);
+                    candles[i].low = convert_to_double(prices[ind + 2]);
+                    candles[i].close = convert_to_double(prices[ind + 3]);
+                    if(record_size == 5) candles[i].volume = convert_to_double(prices[ind + 4]);
+                }
             }
-            return OK;
+        }
+
+        /** \brief Конвертировать цены в массив свечей
+         * Данный метод нужен для внутреннего использования
+         * \param candles массив свечей
+         * \param prices буфер цен
+         * \param record_size количество цен в минуте (1, 4 или 5)
+         */
+        template<class PRICE_T>
+        inline void convert_prices_to_candles(
+                std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles,
+                const PRICE_T *prices,
+                const size_t record_size) const {
+            convert_prices_to_candles(candles.data(), prices, record_size, MINUTES_IN_DAY);
         }
 
         /** \brief Конвертировать буфер в массив свечей
+         * Формат буфера (одна цена, OHLC или OHLCV) определяется по его размеру,
+         * если тип цены не задан параметром шаблона PRICE_LAYOUT
          * Данный метод нужен для внутреннего использования
          */
         int convert_buffer_to_candles(
                 std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles,
                 const char *buffer,
-                const unsigned long &buffer_size) {
-            if(buffer_size == ONLY_ONE_PRICE_BUFFER_SIZE) {
-                for(int i = 0; i < MINUTES_IN_DAY; ++i) {
-                    candles[i].close = convert_to_double(((price_t*)buffer)[i]);
+                const unsigned long &buffer_size) const {
+            const size_t price_size = get_price_size();
+            if(get_price_codec() != xquotes_codec::CODEC_NONE) {
+                size_t num_records = 0, record_size = 0;
+                if(!xquotes_codec::get_encoded_info(buffer, buffer_size, num_records, record_size)) return INVALID_ARRAY_LENGH;
+                if(num_records != MINUTES_IN_DAY) return INVALID_ARRAY_LENGH;
+                if(PRICE_LAYOUT != PRICE_RUNTIME && record_size != get_layout_record_size(PRICE_LAYOUT)) return INVALID_ARRAY_LENGH;
+                // метод может вызываться из нескольких потоков (см. read_day_candles_concurrent)
+                static thread_local std::unique_ptr<char[]> decode_buffer;
+                static thread_local size_t decode_buffer_size = 0;
+                const size_t decoded_size = record_size * price_size * MINUTES_IN_DAY;
+                if(decoded_size > decode_buffer_size) {
+                    decode_buffer = std::unique_ptr<char[]>(new char[decoded_size]);
+                    decode_buffer_size = decoded_size;
                 }
-            } else
-            if(buffer_size == CANDLE_WITHOUT_VOLUME_BUFFER_SIZE) {
-                const int BUFFER_SAMPLE_SIZE = 4;
+                if(price_size == sizeof(fixed_price_t)) {
+                    if(!xquotes_codec::decode_prices(buffer, buffer_size, (fixed_price_t*)decode_buffer.get())) return INVALID_ARRAY_LENGH;
+                    convert_prices_to_candles(candles, (const fixed_price_t*)decode_buffer.get(), record_size);
+                } else {
+                    if(!xquotes_codec::decode_prices(buffer, buffer_size, (price_t*)decode_buffer.get())) return INVALID_ARRAY_LENGH;
+                    convert_prices_to_candles(candles, (const price_t*)decode_buffer.get(), record_size);
+                }
+                return OK;
+            }
+            const size_t record_size = PRICE_LAYOUT == PRICE_RUNTIME ?
+                buffer_size / (price_size * MINUTES_IN_DAY) : get_layout_record_size(PRICE_LAYOUT);
+            if(record_size != 1 && record_size != 4 && record_size != 5) return INVALID_ARRAY_LENGH;
+            if(buffer_size != record_size * price_size * MINUTES_IN_DAY) return INVALID_ARRAY_LENGH;
+            if(price_size == sizeof(fixed_price_t)) convert_prices_to_candles(candles, (const fixed_price_t*)buffer, record_size);
+            else convert_prices_to_candles(candles, (const price_t*)buffer, record_size);
+            return OK;
+        }
+
+        /** \brief Конвертировать массив свечей в столбцы
+         * Данный метод нужен для внутреннего использования
+         * \param candles массив свечей за день
+         * \param columns столбцы свечей (должны иметь размер не меньше MINUTES_IN_DAY)
+         */
+        void convert_candles_to_columns(
+                const std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles,
+                CandleColumns &columns) const {
+            double *open = columns.data(CandleColumns::COLUMN_OPEN);
+            double *high = columns.data(CandleColumns::COLUMN_HIGH);
+            double *low = columns.data(CandleColumns::COLUMN_LOW);
+            double *close = columns.data(CandleColumns::COLUMN_CLOSE);
+            double *volume = columns.data(CandleColumns::COLUMN_VOLUME);
+            for(int i = 0; i < MINUTES_IN_DAY; ++i) {
+                open[i] = candles[i].open;
+                high[i] = candles[i].high;
+                low[i] = candles[i].low;
+                close[i] = candles[i].close;
+                volume[i] = candles[i].volume;
+            }
+        }
+
+        /** \brief Получить ссылку на цену свечи по номеру столбца
+         * \param candle свеча
+         * \param column номер столбца (CandleColumns::COLUMN_OPEN ... CandleColumns::COLUMN_VOLUME)
+         * \return ссылка на цену
+         */
+        static inline double &get_candle_column(CANDLE_TYPE &candle, const size_t column) {
+            switch(column) {
+            case CandleColumns::COLUMN_OPEN: return candle.open;
+            case CandleColumns::COLUMN_HIGH: return candle.high;
+            case CandleColumns::COLUMN_LOW: return candle.low;
+            case CandleColumns::COLUMN_VOLUME: return candle.volume;
+            default: return candle.close;
+            }
+        }
+
+        /** \brief Разложить цены по столбцам
+         * \param prices буфер цен (записи по record_size цен подряд)
+         * \param columns буфер столбцов (record_size столбцов по MINUTES_IN_DAY цен)
+         * \param record_size количество цен в минуте (1, 4 или 5)
+         */
+        template<class PRICE_T>
+        static void split_prices_to_columns(const PRICE_T *prices, PRICE_T *columns, const size_t record_size) {
+            for(size_t column = 0; column < record_size; ++column) {
+                PRICE_T *dst = columns + column * MINUTES_IN_DAY;
                 for(int i = 0; i < MINUTES_IN_DAY; ++i) {
-                    int ind = i * BUFFER_SAMPLE_SIZE;
-                    candles[i].open = convert_to_double(((price_t*)buffer)[ind + 0]);
-                    candles[i].high = convert_to_double(((price_t*)buffer)[ind + 1]);
-                    candles[i].low = convert_to_double(((price_t*)buffer)[ind + 2]);
-                    candles[i].close = convert_to_double(((price_t*)buffer)[ind + 3]);
+                    dst[i] = prices[i * record_size + column];
                 }
+            }
+        }
+
+        /** \brief Конвертировать столбец цен в цены свечей
+         * \param candles массив свечей
+         * \param prices столбец из MINUTES_IN_DAY цен
+         * \param column номер столбца свечи
+         */
+        template<class PRICE_T>
+        void convert_column_to_candles(
+                std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles,
+                const PRICE_T *prices,
+                const size_t column) const {
+            if(is_candles_packed(candles[0])) {
+                const size_t candle_stride = sizeof(CANDLE_TYPE) / sizeof(double);
+                xquotes_simd::convert_prices_to_doubles(prices, &get_candle_column(candles[0], column), MINUTES_IN_DAY, 1, candle_stride);
+                return;
+            }
+            for(int i = 0; i < MINUTES_IN_DAY; ++i) {
+                get_candle_column(candles[i], column) = convert_to_double(prices[i]);
+            }
+        }
+
+        /** \brief Конвертировать кадр подфайла (один столбец цен) в цены свечей
+         * Данный метод нужен для внутреннего использования
+         * \param candles массив свечей
+         * \param frame данные кадра
+         * \param frame_size размер кадра
+         * \param column номер столбца свечи
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int convert_frame_to_candles(
+                std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles,
+                const char *frame,
+                const unsigned long frame_size,
+                const size_t column) const {
+            const size_t price_size = get_price_size();
+            const char *prices = frame;
+            if(get_price_codec() != xquotes_codec::CODEC_NONE) {
+                size_t num_records = 0, record_size = 0;
+                if(!xquotes_codec::get_encoded_info(frame, frame_size, num_records, record_size)) return INVALID_ARRAY_LENGH;
+                if(num_records != MINUTES_IN_DAY || record_size != 1) return INVALID_ARRAY_LENGH;
+                static thread_local std::unique_ptr<char[]> decode_buffer;
+                if(!decode_buffer) decode_buffer = std::unique_ptr<char[]>(new char[MINUTES_IN_DAY * sizeof(uint64_t)]);
+                const bool is_decoded = price_size == sizeof(fixed_price_t) ?
+                    xquotes_codec::decode_prices(frame, frame_size, (fixed_price_t*)decode_buffer.get()) :
+                    xquotes_codec::decode_prices(frame, frame_size, (price_t*)decode_buffer.get());
+                if(!is_decoded) return INVALID_ARRAY_LENGH;
+                prices = decode_buffer.get();
             } else
-            if(buffer_size == CANDLE_WITH_VOLUME_BUFFER_SIZE) {
-                const int BUFFER_SAMPLE_SIZE = 5;
-                for(int i = 0; i < MINUTES_IN_DAY; ++i) {
-                    int ind = i * BUFFER_SAMPLE_SIZE;
-                    candles[i].open = convert_to_double(((price_t*)buffer)[ind + 0]);
-                    candles[i].high = convert_to_double(((price_t*)buffer)[ind + 1]);
-                    candles[i].low = convert_to_double(((price_t*)buffer)[ind + 2]);
-                    candles[i].close = convert_to_double(((price_t*)buffer)[ind + 3]);
-                    candles[i].volume = convert_to_double(((price_t*)buffer)[ind + 4]);
+            if(frame_size != price_size * MINUTES_IN_DAY) return INVALID_ARRAY_LENGH;
+            if(price_size == sizeof(fixed_price_t)) convert_column_to_candles(candles, (const fixed_price_t*)prices, column);
+            else convert_column_to_candles(candles, (const price_t*)prices, column);
+            return OK;
+        }
+
+        /** \brief Получить количество кадров в подфайле с кадрами
+         * \return количество столбцов цен (1, 4 или 5)
+         */
+        inline size_t get_num_frames() const {
+            return get_layout_record_size(get_price_layout());
+        }
+
+        /** \brief Проверить, читаются ли из подфайлов с кадрами не все столбцы цен
+         * Неполные дни не попадают в общий кэш дней
+         * \return вернет true, если часть столбцов не читается
+         */
+        inline bool is_partial_read() const {
+            if(!is_column_frames()) return false;
+            const int frames_mask = (1 << get_num_frames()) - 1;
+            return get_num_frames() > 1 && (read_columns_mask & frames_mask) != frames_mask;
+        }
+
+        /** \brief Прочитать свечи из подфайла с кадрами по столбцам
+         * Читаются только столбцы из read_columns_mask, остальные цены обнуляются
+         * \param candles массив свечей за день
+         * \param read_frame функция чтения кадра int(size_t frame, const char *&data, unsigned long &size)
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        template<class READ_FRAME>
+        int read_frames_to_candles(std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles, READ_FRAME read_frame) const {
+            const size_t num_frames = get_num_frames();
+            for(size_t frame = 0; frame < num_frames; ++frame) {
+                // одна цена всегда хранится в close, см. convert_prices_to_candles
+                const size_t column = num_frames == 1 ? (size_t)CandleColumns::COLUMN_CLOSE : frame;
+                if(num_frames > 1 && !(read_columns_mask & (1 << column))) {
+                    for(int i = 0; i < MINUTES_IN_DAY; ++i) get_candle_column(candles[i], column) = 0.0;
+                    continue;
                 }
-            } else {
-                return INVALID_ARRAY_LENGH;
+                const char *data = NULL;
+                unsigned long data_size = 0;
+                int err = read_frame(frame, data, data_size);
+                if(err != OK) return err;
+                err = convert_frame_to_candles(candles, data, data_size, column);
+                if(err != OK) return err;
+            }
+            return OK;
+        }
+
+        /** \brief Записать свечи в подфайл с кадрами по столбцам
+         * Каждый столбец цен (и кодируется, и сжимается) отдельно
+         * \param candles массив свечей
+         * \param key ключ, это день с начала unix времени
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int write_column_frames(const std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles, const key_t key) {
+            const size_t num_frames = get_num_frames();
+            const size_t price_size = get_price_size();
+            const size_t column_size = price_size * MINUTES_IN_DAY;
+            const size_t buffer_size = num_frames * column_size;
+            const bool is_use_codec = get_price_codec() != xquotes_codec::CODEC_NONE;
+            const size_t frame_capacity = is_use_codec ? xquotes_codec::get_max_encoded_size(MINUTES_IN_DAY, 1) : 0;
+
+            // буфер цен, затем буфер столбцов, затем закодированные столбцы
+            increase_write_buffer_size(2 * buffer_size + num_frames * frame_capacity);
+            char *buffer = write_buffer.get();
+            char *columns = buffer + buffer_size;
+            int err = convert_candles_to_buffer(candles, buffer, buffer_size);
+            if(err != OK) return err;
+            if(price_size == sizeof(fixed_price_t)) split_prices_to_columns((const fixed_price_t*)buffer, (fixed_price_t*)columns, num_frames);
+            else split_prices_to_columns((const price_t*)buffer, (price_t*)columns, num_frames);
+
+            const char *frames[CandleColumns::NUM_COLUMNS];
+            unsigned long frames_size[CandleColumns::NUM_COLUMNS];
+            for(size_t frame = 0; frame < num_frames; ++frame) {
+                frames[frame] = columns + frame * column_size;
+                frames_size[frame] = column_size;
+                if(!is_use_codec) continue;
+                char *encoded = columns + buffer_size + frame * frame_capacity;
+                const size_t encoded_size = price_size == sizeof(fixed_price_t) ?
+                    xquotes_codec::encode_prices((const fixed_price_t*)frames[frame], MINUTES_IN_DAY, 1, encoded) :
+                    xquotes_codec::encode_prices((const price_t*)frames[frame], MINUTES_IN_DAY, 1, encoded);
+                if(encoded_size == 0) return INVALID_PARAMETER;
+                frames[frame] = encoded;
+                frames_size[frame] = encoded_size;
+            }
+            if(is_use_dictionary) return write_compressed_subfile_frames(key, frames, frames_size, num_frames);
+            return write_subfile_frames(key, frames, frames_size, num_frames);
+        }
+
+        /** \brief Записать свечи в обычный подфайл дня
+         * \param candles массив свечей
+         * \param key ключ, это день с начала unix времени
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int write_day_subfile(const std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles, const key_t key) {
+            const size_t record_size = get_layout_record_size(get_price_layout());
+            const size_t buffer_size = record_size * get_price_size() * MINUTES_IN_DAY;
+            const bool is_use_codec = get_price_codec() != xquotes_codec::CODEC_NONE;
+            const size_t codec_buffer_size = is_use_codec ? xquotes_codec::get_max_encoded_size(MINUTES_IN_DAY, record_size) : 0;
+
+            increase_write_buffer_size(buffer_size + codec_buffer_size);
+            char *buffer = write_buffer.get();
+            int err_convert = convert_candles_to_buffer(candles, buffer, buffer_size);
+            if(err_convert != OK) return err_convert;
+            const char *subfile = buffer;
+            size_t subfile_size = buffer_size;
+            if(is_use_codec) {
+                // кодек пишет результат сразу за буфером цен
+                char *codec_buffer = buffer + buffer_size;
+                if(get_price_size() == sizeof(fixed_price_t)) subfile_size = xquotes_codec::encode_prices((const fixed_price_t*)buffer, MINUTES_IN_DAY, record_size, codec_buffer);
+                else subfile_size = xquotes_codec::encode_prices((const price_t*)buffer, MINUTES_IN_DAY, record_size, codec_buffer);
+                if(subfile_size == 0) return INVALID_PARAMETER;
+                subfile = codec_buffer;
             }
+            if(is_use_dictionary) return write_compressed_subfile(key, subfile, subfile_size);
+            return write_subfile(key, subfile, subfile_size);
+        }
+
+        /** \brief Конвертировать часовой кадр подфайла в свечи
+         * Данный метод нужен для внутреннего использования
+         * \param candles указатель на первую свечу часа
+         * \param frame данные кадра (MINUTES_IN_HOUR_FRAME записей цен)
+         * \param frame_size размер кадра
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int convert_hour_frame_to_candles(
+                CANDLE_TYPE *candles,
+                const char *frame,
+                const unsigned long frame_size) const {
+            const size_t price_size = get_price_size();
+            const size_t record_size = get_layout_record_size(get_price_layout());
+            const char *prices = frame;
+            if(get_price_codec() != xquotes_codec::CODEC_NONE) {
+                size_t num_records = 0, frame_record_size = 0;
+                if(!xquotes_codec::get_encoded_info(frame, frame_size, num_records, frame_record_size)) return INVALID_ARRAY_LENGH;
+                if(num_records != MINUTES_IN_HOUR_FRAME || frame_record_size != record_size) return INVALID_ARRAY_LENGH;
+                static thread_local std::unique_ptr<char[]> decode_buffer;
+                if(!decode_buffer) decode_buffer = std::unique_ptr<char[]>(new char[MINUTES_IN_HOUR_FRAME * CandleColumns::NUM_COLUMNS * sizeof(uint64_t)]);
+                const bool is_decoded = price_size == sizeof(fixed_price_t) ?
+                    xquotes_codec::decode_prices(frame, frame_size, (fixed_price_t*)decode_buffer.get()) :
+                    xquotes_codec::decode_prices(frame, frame_size, (price_t*)decode_buffer.get());
+                if(!is_decoded) return INVALID_ARRAY_LENGH;
+                prices = decode_buffer.get();
+            } else
+            if(frame_size != record_size * price_size * MINUTES_IN_HOUR_FRAME) return INVALID_ARRAY_LENGH;
+            if(price_size == sizeof(fixed_price_t)) convert_prices_to_candles(candles, (const fixed_price_t*)prices, record_size, MINUTES_IN_HOUR_FRAME);
+            else convert_prices_to_candles(candles, (const price_t*)prices, record_size, MINUTES_IN_HOUR_FRAME);
             return OK;
         }
 
+        /** \brief Прочитать свечи из подфайла с часовыми кадрами
+         * \param candles массив свечей за день
+         * \param read_frame функция чтения кадра int(size_t frame, const char *&data, unsigned long &size)
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        template<class READ_FRAME>
+        int read_hour_frames_to_candles(std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles, READ_FRAME read_frame) const {
+            for(size_t hour = 0; hour < NUM_HOUR_FRAMES; ++hour) {
+                const char *data = NULL;
+                unsigned long data_size = 0;
+                int err = read_frame(hour, data, data_size);
+                if(err != OK) return err;
+                err = convert_hour_frame_to_candles(&candles[hour * MINUTES_IN_HOUR_FRAME], data, data_size);
+                if(err != OK) return err;
+            }
+            return OK;
+        }
+
+        /** \brief Записать свечи в подфайл с часовыми кадрами
+         * Каждый час дня (и кодируется, и сжимается) отдельно
+         * \param candles массив свечей
+         * \param key ключ, это день с начала unix времени
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int write_hour_frames(const std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles, const key_t key) {
+            const size_t record_size = get_layout_record_size(get_price_layout());
+            const size_t price_size = get_price_size();
+            const size_t buffer_size = record_size * price_size * MINUTES_IN_DAY;
+            const size_t frame_size = buffer_size / NUM_HOUR_FRAMES;
+            const bool is_use_codec = get_price_codec() != xquotes_codec::CODEC_NONE;
+            const size_t frame_capacity = is_use_codec ? xquotes_codec::get_max_encoded_size(MINUTES_IN_HOUR_FRAME, record_size) : 0;
+
+            // буфер цен, затем закодированные кадры
+            increase_write_buffer_size(buffer_size + NUM_HOUR_FRAMES * frame_capacity);
+            char *buffer = write_buffer.get();
+            int err = convert_candles_to_buffer(candles, buffer, buffer_size);
+            if(err != OK) return err;
+
+            const char *frames[NUM_HOUR_FRAMES];
+            unsigned long frames_size[NUM_HOUR_FRAMES];
+            for(size_t hour = 0; hour < NUM_HOUR_FRAMES; ++hour) {
+                frames[hour] = buffer + hour * frame_size;
+                frames_size[hour] = frame_size;
+                if(!is_use_codec) continue;
+                char *encoded = buffer + buffer_size + hour * frame_capacity;
+                const size_t encoded_size = price_size == sizeof(fixed_price_t) ?
+                    xquotes_codec::encode_prices((const fixed_price_t*)frames[hour], MINUTES_IN_HOUR_FRAME, record_size, encoded) :
+                    xquotes_codec::encode_prices((const price_t*)frames[hour], MINUTES_IN_HOUR_FRAME, record_size, encoded);
+                if(encoded_size == 0) return INVALID_PARAMETER;
+                frames[hour] = encoded;
+                frames_size[hour] = encoded_size;
+            }
+            if(is_use_dictionary) return write_compressed_subfile_frames(key, frames, frames_size, NUM_HOUR_FRAMES);
+            return write_subfile_frames(key, frames, frames_size, NUM_HOUR_FRAMES);
+        }
+
+        /** \brief Найти свечу в часовом кадре
+         * Распаковывается только кадр, содержащий нужную минуту. Кадр сохраняется в кэше часовых кадров
+         * \param candle свеча
+         * \param timestamp метка времени свечи
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        template <typename T>
+        int find_candle_in_hour_frame(T &candle, const ztime::timestamp_t &timestamp) {
+            const int day = ztime::get_day(timestamp);
+            const int minute_day = ztime::get_minute_day(timestamp);
+            const int hour = minute_day / MINUTES_IN_HOUR_FRAME;
+            const int frame_key = day * NUM_HOUR_FRAMES + hour;
+            if(hour_frames.size() != hour_frames_cache_size) {
+                hour_frames.assign(hour_frames_cache_size, hour_candles_array_t());
+                hour_frames_key.assign(hour_frames_cache_size, -1);
+            }
+            const size_t slot = (size_t)frame_key % hour_frames_cache_size;
+            hour_candles_array_t &frame_candles = hour_frames[slot];
+            if(hour_frames_key[slot] != frame_key) {
+                hour_frames_key[slot] = frame_key;
+                const char *data = NULL;
+                unsigned long data_size = 0;
+                int err = read_subfile_frame_view(day, hour, data, data_size);
+                if(err == OK && is_use_dictionary) {
+                    err = decompress_subfile_frame(data, data_size, read_candles_buffer, read_candles_buffer_size, data_size);
+                    data = read_candles_buffer.get();
+                }
+                if(err == OK) err = convert_hour_frame_to_candles(frame_candles.data(), data, data_size);
+                // как и в окне котировок, отсутствие данных запоминается нулевыми ценами
+                if(err != OK) frame_candles.fill(CANDLE_TYPE());
+                const ztime::timestamp_t first_timestamp = ztime::get_first_timestamp_day(timestamp) + hour * ztime::SECONDS_IN_HOUR;
+                for(int i = 0; i < MINUTES_IN_HOUR_FRAME; ++i) {
+                    frame_candles[i].timestamp = first_timestamp + i * ztime::SECONDS_IN_MINUTE;
+                }
+            }
+            candle = frame_candles[minute_day % MINUTES_IN_HOUR_FRAME];
+            return candle.close != 0.0 ? OK : DATA_NOT_AVAILABLE;
+        }
+
+        /** \brief Удалить часовые кадры дня из кэша часовых кадров
+         * \param day день с начала unix времени
+         */
+        void erase_hour_frames(const int day) {
+            for(size_t i = 0; i < hour_frames_key.size(); ++i) {
+                if(hour_frames_key[i] >= 0 && hour_frames_key[i] / NUM_HOUR_FRAMES == day) hour_frames_key[i] = -1;
+            }
+        }
+
+        /// Запись итогов дня в секции заголовка HEADER_SECTION_DAY_SUMMARIES
+        enum {
+            DAY_SUMMARY_RECORD_SIZE = 36,   ///< день (uint32_t), число минут, первая и последняя минута, резерв (uint16_t),
+                                            ///< open, high, low, close (uint32_t, как цены формата 5), объем (uint64_t)
+        };
+
+        /** \brief Записать итоги дня в запись секции заголовка
+         * Итоги считаются по ценам, которые вернет чтение дня
+         * \param candles массив свечей
+         * \param key ключ, это день с начала unix времени
+         * \param one_price_type цена свечи, в которой лежит единственная цена дня (PRICE_OPEN или PRICE_CLOSE).
+         * При записи это тип цены хранилища, прочитанные свечи всегда хранят одну цену в close
+         * \param record запись итогов дня (DAY_SUMMARY_RECORD_SIZE байт)
+         */
+        void make_day_summary_record(
+                const std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles,
+                const key_t key,
+                const int one_price_type,
+                char *record) const {
+            const int layout = get_price_layout();
+            const bool is_one_price = get_layout_record_size(layout) == 1;
+            const bool is_volume = layout == PRICE_OHLCV;
+            uint32_t day = key, open = 0, high = 0, low = 0, close = 0;
+            uint16_t num_minutes = 0, first_minute = 0xFFFF, last_minute = 0xFFFF, reserved = 0;
+            uint64_t volume = 0;
+            for(int i = 0; i < MINUTES_IN_DAY; ++i) {
+                const uint32_t candle_close = convert_to_uint(is_one_price && one_price_type == PRICE_OPEN ? candles[i].open : candles[i].close);
+                if(candle_close == 0) continue;
+                const uint32_t candle_open = is_one_price ? candle_close : convert_to_uint(candles[i].open);
+                const uint32_t candle_high = is_one_price ? candle_close : convert_to_uint(candles[i].high);
+                const uint32_t candle_low = is_one_price ? candle_close : convert_to_uint(candles[i].low);
+                if(num_minutes == 0) {
+                    first_minute = i;
+                    open = candle_open;
+                    high = candle_high;
+                    low = candle_low;
+                } else {
+                    high = std::max(high, candle_high);
+                    low = std::min(low, candle_low);
+                }
+                close = candle_close;
+                last_minute = i;
+                if(is_volume) volume += convert_to_uint(candles[i].volume);
+                ++num_minutes;
+            }
+            const void *fields[] = {&day, &num_minutes, &first_minute, &last_minute, &reserved, &open, &high, &low, &close, &volume};
+            const size_t fields_size[] = {4, 2, 2, 2, 2, 4, 4, 4, 4, 8};
+            for(size_t i = 0; i < 10; ++i) {
+                std::memcpy(record, fields[i], fields_size[i]);
+                record += fields_size[i];
+            }
+        }
+
+        /** \brief Прочитать итоги дня из записи секции заголовка
+         * \param summary итоги дня
+         * \param record запись итогов дня
+         */
+        static void read_day_summary_record(DaySummary &summary, const char *record) {
+            uint32_t day = 0, open = 0, high = 0, low = 0, close = 0;
+            uint16_t num_minutes = 0, first_minute = 0, last_minute = 0, reserved = 0;
+            uint64_t volume = 0;
+            void *fields[] = {&day, &num_minutes, &first_minute, &last_minute, &reserved, &open, &high, &low, &close, &volume};
+            const size_t fields_size[] = {4, 2, 2, 2, 2, 4, 4, 4, 4, 8};
+            for(size_t i = 0; i < 10; ++i) {
+                std::memcpy(fields[i], record, fields_size[i]);
+                record += fields_size[i];
+            }
+            summary.timestamp = (ztime::timestamp_t)day * ztime::SECONDS_IN_DAY;
+            summary.num_minutes = num_minutes;
+            summary.first_minute = num_minutes == 0 ? -1 : first_minute;
+            summary.last_minute = num_minutes == 0 ? -1 : last_minute;
+            summary.open = convert_to_double(open);
+            summary.high = convert_to_double(high);
+            summary.low = convert_to_double(low);
+            summary.close = convert_to_double(close);
+            summary.volume = (double)volume / PRICE_MULTIPLER;
+        }
+
+        /** \brief Найти запись итогов дня в секции заголовка
+         * Записи отсортированы по дням, поиск бинарный
+         * \param section данные секции
+         * \param key ключ, это день с начала unix времени
+         * \return номер записи дня или первой записи с большим днем
+         */
+        static size_t find_day_summary_record(const std::vector<char> &section, const key_t key) {
+            size_t first = 0, last = section.size() / DAY_SUMMARY_RECORD_SIZE;
+            while(first < last) {
+                const size_t middle = (first + last) / 2;
+                uint32_t day = 0;
+                std::memcpy(&day, section.data() + middle * DAY_SUMMARY_RECORD_SIZE, sizeof(day));
+                if(day < key) first = middle + 1;
+                else last = middle;
+            }
+            return first;
+        }
+
+        /** \brief Проверить, что запись секции заголовка относится к дню
+         */
+        static inline bool check_day_summary_record(const std::vector<char> &section, const size_t ind, const key_t key) {
+            if((ind + 1) * DAY_SUMMARY_RECORD_SIZE > section.size()) return false;
+            uint32_t day = 0;
+            std::memcpy(&day, section.data() + ind * DAY_SUMMARY_RECORD_SIZE, sizeof(day));
+            return day == key;
+        }
+
+        /** \brief Обновить итоги дня в секции заголовка
+         * \param candles массив свечей
+         * \param key ключ, это день с начала unix времени
+         * \param one_price_type цена свечи, в которой лежит единственная цена дня, см. make_day_summary_record
+         */
+        void update_day_summary(const std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles, const key_t key, const int one_price_type) {
+            char record[DAY_SUMMARY_RECORD_SIZE];
+            make_day_summary_record(candles, key, one_price_type, record);
+            std::vector<char> &section = get_header_section(HEADER_SECTION_DAY_SUMMARIES);
+            const size_t ind = find_day_summary_record(section, key);
+            const size_t offset = ind * DAY_SUMMARY_RECORD_SIZE;
+            if(!check_day_summary_record(section, ind, key)) {
+                // дни обычно пишутся по порядку, тогда вставка идет в конец секции
+                section.insert(section.begin() + offset, DAY_SUMMARY_RECORD_SIZE, 0);
+            }
+            std::copy(record, record + DAY_SUMMARY_RECORD_SIZE, section.begin() + offset);
+        }
+
+        /** \brief Удалить итоги дня из секции заголовка
+         * \param key ключ, это день с начала unix времени
+         */
+        void erase_day_summary(const key_t key) {
+            const std::vector<char> *found_section = find_header_section(HEADER_SECTION_DAY_SUMMARIES);
+            if(found_section == NULL) return;
+            const size_t ind = find_day_summary_record(*found_section, key);
+            if(!check_day_summary_record(*found_section, ind, key)) return;
+            std::vector<char> &section = get_header_section(HEADER_SECTION_DAY_SUMMARIES);
+            const size_t offset = ind * DAY_SUMMARY_RECORD_SIZE;
+            section.erase(section.begin() + offset, section.begin() + offset + DAY_SUMMARY_RECORD_SIZE);
+        }
+
+        /** \brief Получить количество знаков после запятой цены
+         * \param price цена в единицах 1 / PRICE_MULTIPLER
+         * \return количество значащих знаков после запятой (от 0 до MAX_DECIMAL_PLACES)
+         */
+        static inline int get_price_decimal_places(price_t price) {
+            int decimal_places = MAX_DECIMAL_PLACES;
+            while(decimal_places > 0 && price % 10 == 0) {
+                price /= 10;
+                --decimal_places;
+            }
+            return decimal_places;
+        }
+
+        /** \brief Найти количество знаков после запятой у цен дня
+         * Цены проверяются в целых единицах 1 / PRICE_MULTIPLER, без std::pow и сравнения double с допуском
+         * \param candles массив свечей
+         * \param one_price_type цена свечи, в которой лежит единственная цена дня, см. make_day_summary_record
+         * \return количество знаков после запятой, 0 если цен нет
+         */
+        int find_decimal_places(const std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles, const int one_price_type) const {
+            const bool is_one_price = get_layout_record_size(get_price_layout()) == 1;
+            int decimal_places = 0;
+            for(int i = 0; i < MINUTES_IN_DAY && decimal_places < MAX_DECIMAL_PLACES; ++i) {
+                if(is_one_price) {
+                    const double price = one_price_type == PRICE_OPEN ? candles[i].open : candles[i].close;
+                    decimal_places = std::max(decimal_places, get_price_decimal_places(convert_to_uint(price)));
+                    continue;
+                }
+                decimal_places = std::max(decimal_places, get_price_decimal_places(convert_to_uint(candles[i].open)));
+                decimal_places = std::max(decimal_places, get_price_decimal_places(convert_to_uint(candles[i].high)));
+                decimal_places = std::max(decimal_places, get_price_decimal_places(convert_to_uint(candles[i].low)));
+                decimal_places = std::max(decimal_places, get_price_decimal_places(convert_to_uint(candles[i].close)));
+            }
+            return decimal_places;
+        }
+
+        /** \brief Получить количество знаков после запятой из заметки файла
+         * \return количество знаков после запятой или -1, если оно не записано (файл старой версии)
+         */
+        inline int get_note_decimal_places() const {
+            return (int)((get_file_note() & DECIMAL_PLACES_NOTES_MASK) >> DECIMAL_PLACES_NOTES_SHIFT) - 1;
+        }
+
+        /** \brief Записать количество знаков после запятой в заметку файла
+         * \param decimal_places количество знаков после запятой
+         */
+        inline void set_note_decimal_places(const int decimal_places) {
+            set_file_note((get_file_note() & ~(note_t)DECIMAL_PLACES_NOTES_MASK) | ((note_t)(decimal_places + 1) << DECIMAL_PLACES_NOTES_SHIFT));
+            decimal_places_ = 0;
+        }
+
+        /** \brief Обновить количество знаков после запятой в заметке файла после записи дня
+         * Хранится максимум по всем записанным дням. У файлов старой версии заметка не меняется
+         * \param candles массив свечей
+         * \param one_price_type цена свечи, в которой лежит единственная цена дня, см. make_day_summary_record
+         */
+        void update_decimal_places(const std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles, const int one_price_type) {
+            const int note_decimal_places = get_note_decimal_places();
+            if(note_decimal_places < 0 || note_decimal_places == MAX_DECIMAL_PLACES) return;
+            const int decimal_places = find_decimal_places(candles, one_price_type);
+            if(decimal_places > note_decimal_places) set_note_decimal_places(decimal_places);
+        }
+
+        /** \brief Обновить данные записанного дня в памяти
+         * Удаляет день из общего кэша и перечитывает его, если он есть в окне котировок
+         * \param timestamp метка времени дня
+         */
+        void update_written_day(const ztime::timestamp_t &timestamp) {
+            xquotes_day_cache::DayCache<CANDLE_TYPE>::get_instance().erase(file_name, ztime::get_day(timestamp));
+            erase_hour_frames(ztime::get_day(timestamp));
+            candles_array_t *found_candles_array = find_candles_array(ztime::get_first_timestamp_day(timestamp));
+            if(found_candles_array != NULL) {
+                columns_days_key[get_window_slot(ztime::get_day(timestamp))] = -1;
+                read_window_candles(*found_candles_array, ztime::get_day(timestamp), ztime::get_first_timestamp_day(timestamp));
+            }
+        }
+
         /** \brief Прочитать свечи
          * \warning Данный метод нужен для внутреннего использования
          * \param candles массив свечей за день
@@ -318,15 +1069,77 @@ namespace xquotes_history {
          * \return состояние ошибки
          */
         int read_candles(std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles, const key_t &key, const ztime::timestamp_t &timestamp) {
+#           ifndef XQUOTES_DO_NOT_USE_THREAD
+            // день мог быть загружен заранее в фоновом потоке
+            if(prefetcher && prefetcher->take(key, candles)) return OK;
+#           endif
+            // сначала ищем день в общем кэше
+            xquotes_day_cache::DayCache<CANDLE_TYPE> &day_cache = xquotes_day_cache::DayCache<CANDLE_TYPE>::get_instance();
+            if(day_cache.get(file_name, key, candles)) return OK;
+            int err = read_candles_from_storage(candles, key, timestamp);
+            if(err == OK && !is_partial_read()) day_cache.put(file_name, key, candles);
+            return err;
+        }
+
+        /** \brief Прочитать свечи из хранилища без использования кэша
+         * \warning Данный метод нужен для внутреннего использования
+         * \param candles массив свечей за день
+         * \param key ключ, это день с начала unix времени
+         * \param timestamp метка времени (должна быть всегда в начале дня!)
+         * \return состояние ошибки
+         */
+        int read_candles_from_storage(std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles, const key_t &key, const ztime::timestamp_t &timestamp) {
             int err = 0;
             unsigned long buffer_size = 0;
             fill_timestamp(candles, timestamp);
-            if(is_use_dictionary) err = read_compressed_subfile(key, read_candles_buffer, read_candles_buffer_size, buffer_size);
-            else err = read_subfile(key, read_candles_buffer, read_candles_buffer_size, buffer_size);
+            if(is_hour_frames()) {
+                // подфайл читается один раз, затем кадры находятся в нем по таблице смещений
+                const char *subfile = NULL;
+                unsigned long subfile_size = 0;
+                err = read_subfile_view(key, subfile, subfile_size);
+                if(err != OK) return err;
+                return read_hour_frames_to_candles(candles, [&](const size_t frame, const char *&data, unsigned long &data_size) {
+                    int err_frame = find_subfile_frame(subfile, subfile_size, frame, data, data_size);
+                    if(err_frame != OK || !is_use_dictionary) return err_frame;
+                    err_frame = decompress_subfile_frame(data, data_size, read_candles_buffer, read_candles_buffer_size, data_size);
+                    data = read_candles_buffer.get();
+                    return err_frame;
+                });
+            }
+            if(is_column_frames()) {
+                return read_frames_to_candles(candles, [&](const size_t frame, const char *&data, unsigned long &data_size) {
+                    if(!is_use_dictionary) return read_subfile_frame_view(key, frame, data, data_size);
+                    int err_frame = read_compressed_subfile_frame(key, frame, read_candles_buffer, read_candles_buffer_size, data_size);
+                    data = read_candles_buffer.get();
+                    return err_frame;
+                });
+            }
+            if(is_use_dictionary) {
+                err = read_compressed_subfile(key, read_candles_buffer, read_candles_buffer_size, buffer_size);
+                if(err != OK) return err;
+                return convert_buffer_to_candles(candles, read_candles_buffer.get(), buffer_size);
+            }
+            // несжатые данные конвертируем прямо из подфайла (в режиме mmap - без копирования)
+            const char *buffer = NULL;
+            err = read_subfile_view(key, buffer, buffer_size);
+            if(err != OK) return err;
+            return convert_buffer_to_candles(candles, buffer, buffer_size);
+        }
+
+        /** \brief Прочитать свечи в ячейку окна котировок
+         * Ячейка используется повторно, поэтому при отсутствии данных цены дня обнуляются
+         * \warning Данный метод нужен для внутреннего использования
+         * \param candles массив свечей за день
+         * \param key ключ, это день с начала unix времени
+         * \param timestamp метка времени (должна быть всегда в начале дня!)
+         * \return состояние ошибки
+         */
+        int read_window_candles(candles_array_t& candles, const key_t &key, const ztime::timestamp_t &timestamp) {
+            int err = read_candles(candles, key, timestamp);
             if(err != OK) {
-                return err;
+                candles.fill(CANDLE_TYPE());
+                fill_timestamp(candles, timestamp);
             }
-            err = convert_buffer_to_candles(candles, read_candles_buffer.get(), buffer_size);
             return err;
         }
 
@@ -338,75 +1151,281 @@ namespace xquotes_history {
          * \param indent_up отступ от временная метки в днях на увеличение времени
          */
         void read_candles_data(const ztime::timestamp_t &timestamp, const int &indent_dn, const int &indent_up) {
-            int num_days = indent_dn + indent_up + 1;
-            ztime::timestamp_t start_ind_timestamp = timestamp - indent_dn * ztime::SECONDS_IN_DAY;
-            int start_ind_day = ztime::get_day(start_ind_timestamp);
-            if(candles_array_days.size() == 0) {
-                // в данном случае просто загружаем данные
-                candles_array_days.resize(num_days);
-                int ind_day = start_ind_day;
-                ztime::timestamp_t ind_timestamp = start_ind_timestamp;
-                for(int i = 0; i < num_days; ++i, ++ind_day, ind_timestamp += ztime::SECONDS_IN_DAY) {
-                    read_candles(candles_array_days[i], ind_day, ind_timestamp);
+#           ifndef XQUOTES_DO_NOT_USE_THREAD
+            if(prefetcher) prefetcher->request(ztime::get_day(timestamp));
+#           endif
+            const int num_days = indent_dn + indent_up + 1;
+            if((int)candles_array_days.size() != num_days) {
+                // размер окна изменился, буфер выделяется заново
+                candles_array_days.assign(num_days, candles_array_t());
+                candles_array_days_key.assign(num_days, -1);
+                columns_days.clear();
+                columns_days.resize(num_days);
+                columns_days_key.assign(num_days, -1);
+                extremum_days.assign(num_days, BlockExtremumIndex());
+                extremum_days_key.assign(num_days, -1);
+            }
+            const int start_ind_day = ztime::get_day(timestamp) - indent_dn;
+            ztime::timestamp_t ind_timestamp = timestamp - indent_dn * ztime::SECONDS_IN_DAY;
+            for(int i = 0; i < num_days; ++i, ind_timestamp += ztime::SECONDS_IN_DAY) {
+                const int ind_day = start_ind_day + i;
+                const size_t slot = get_window_slot(ind_day);
+                // день уже есть в окне, загружать не нужно
+                if(candles_array_days_key[slot] == ind_day) continue;
+                candles_array_days_key[slot] = ind_day;
+                columns_days_key[slot] = -1;
+                read_window_candles(candles_array_days[slot], ind_day, ind_timestamp);
+            }
+            window_start_day = start_ind_day;
+        }
+
+        /** \brief Найти свечу по временной метке
+         * \warning Данный метод нужен для внутреннего использования
+         * \param candle Свеча/бар
+         * \param timestamp временная метка начала свечи
+         * \param optimization оптимизация.
+         * Для отключения указать WITHOUT_OPTIMIZATION.
+         * По умолчанию включена оптимизация последовательного считывания минут OPTIMIZATION_SEQUENTIAL_READING
+         * \return вернет 0 в случае успеха
+         */
+        template <typename T>
+        int find_candle(T &candle, const ztime::timestamp_t &timestamp) {
+            int minute_day = ztime::get_minute_day(timestamp);
+            const ztime::timestamp_t timestamp_start_day = ztime::get_first_timestamp_day(timestamp);
+            candles_array_t *found_candles_array = find_candles_array(timestamp_start_day);
+            if(found_candles_array == NULL) {
+                // для подфайлов с часовыми кадрами не грузим окно, а распаковываем один час
+                if(is_hour_frames()) return find_candle_in_hour_frame(candle, timestamp);
+                read_candles_data(timestamp_start_day, indent_day_dn, indent_day_up);
+                found_candles_array = find_candles_array(timestamp_start_day);
+                if(found_candles_array == NULL) return STRANGE_PROGRAM_BEHAVIOR;
+            }
+            candle = (*found_candles_array)[minute_day];
+            return candle.close != 0.0 ? OK : DATA_NOT_AVAILABLE;
+        }
+
+        /** \brief Проверить по итогам дня, что цена не коснется уровней до конца дня
+         * Итоги используются, только если свечи дня читаются с ценами high, low и close,
+         * иначе чтение дня даст пропуски, которых нет в итогах
+         * \warning Данный метод нужен для внутреннего использования
+         * \param timestamp метка времени внутри дня
+         * \param low_level нижний уровень
+         * \param high_level верхний уровень
+         * \param is_ignore_skipping если true, пропуски цен игнорируются
+         * \return вернет true, если день можно пропустить, не читая его
+         */
+        bool check_day_summary_without_touch(
+                const ztime::timestamp_t &timestamp,
+                const double low_level,
+                const double high_level,
+                const bool is_ignore_skipping) const {
+            if(get_layout_record_size(get_price_layout()) == 1) return false;
+            const int price_columns = (1 << CandleColumns::COLUMN_HIGH) | (1 << CandleColumns::COLUMN_LOW) | (1 << CandleColumns::COLUMN_CLOSE);
+            if(is_column_frames() && (read_columns_mask & price_columns) != price_columns) return false;
+            DaySummary summary;
+            if(get_day_summary(summary, timestamp) != OK) return false;
+            if(!is_ignore_skipping && summary.num_minutes != MINUTES_IN_DAY) return false;
+            return summary.num_minutes == 0 || (summary.high < high_level && summary.low > low_level);
+        }
+
+        /** \brief Найти первую минуту, в которой цена коснулась уровней
+         * Дни, цена которых по итогам не касается уровней, пропускаются без чтения.
+         * Внутри дня поиск идет по индексу экстремумов блоков BlockExtremumIndex
+         * \warning Данный метод нужен для внутреннего использования
+         * \param candle свеча, которая коснулась уровней (low <= low_level или high >= high_level)
+         * \param timestamp метка времени начала поиска, в нее запишется метка времени найденной свечи
+         * \param low_level нижний уровень
+         * \param high_level верхний уровень
+         * \param is_ignore_skipping если true, пропуски цен игнорируются, иначе пропуск завершает поиск с ошибкой
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int find_first_touch(
+                CANDLE_TYPE &candle,
+                ztime::timestamp_t &timestamp,
+                const double low_level,
+                const double high_level,
+                const bool is_ignore_skipping) {
+            key_t min_key = 0, max_key = 0;
+            if(get_min_max_key(min_key, max_key) != OK) return DATA_NOT_AVAILABLE;
+            ztime::timestamp_t t = timestamp - timestamp % ztime::SECONDS_IN_MINUTE;
+            while(true) {
+                const key_t day = ztime::get_day(t);
+                if(day > max_key) return DATA_NOT_AVAILABLE;
+                const ztime::timestamp_t timestamp_start_day = ztime::get_first_timestamp_day(t);
+                const ztime::timestamp_t timestamp_next_day = timestamp_start_day + ztime::SECONDS_IN_DAY;
+                if(check_day_summary_without_touch(t, low_level, high_level, is_ignore_skipping)) {
+                    t = timestamp_next_day;
+                    continue;
+                }
+                CandlesView view;
+                int err = get_day_view(view, t);
+                if(err != OK) return err;
+                const size_t slot = get_window_slot(day);
+                BlockExtremumIndex &index = extremum_days[slot];
+                if(extremum_days_key[slot] != (int)day) {
+                    index.build(view);
+                    extremum_days_key[slot] = day;
+                }
+                const size_t minute_day = ztime::get_minute_day(t);
+                const size_t ind = index.find_first_touch(view, minute_day, low_level, high_level, is_ignore_skipping);
+                if(ind >= index.size()) {
+                    t = timestamp_next_day;
+                    continue;
+                }
+                candle = (*find_candles_array(timestamp_start_day))[ind];
+                timestamp = view.get_timestamp(ind);
+                if(candle.high == 0.0 || candle.low == 0.0 || candle.close == 0.0) return DATA_NOT_AVAILABLE;
+                return OK;
+            }
+        }
+
+        /** \brief Проверить пакет бинарных опционов
+         * Сначала отмечаются дни, цены которых нужны опционам. Каждый такой день читается один раз,
+         * его цены копируются в общий буфер дней. Затем цены начала и конца опционов выбираются
+         * из буфера по индексам блоками по BATCH_BLOCK_SIZE опционов (xquotes_simd::gather_doubles)
+         * \warning Данный метод нужен для внутреннего использования, см. check_binary_options и check_protected_binary_options
+         * \param is_protected если true, опционы, которые заканчиваются не раньше last_timestamp, не проверяются
+         * \param last_timestamp последняя допустимая метка времени
+         * Остальные параметры см. check_binary_options
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int check_binary_options_batch(
+                std::vector<int> &states,
+                std::vector<int> &errors,
+                const std::vector<ztime::timestamp_t> &timestamps,
+                const std::vector<int> &durations_sec,
+                const std::vector<int> &contract_types,
+                const int price_type,
+                const bool is_protected,
+                const ztime::timestamp_t last_timestamp,
+                const int num_threads) {
+            const size_t num_options = timestamps.size();
+            if(durations_sec.size() != num_options || contract_types.size() != num_options) return INVALID_PARAMETER;
+            if(price_type != PRICE_CLOSE && price_type != PRICE_OPEN) return INVALID_PARAMETER;
+            states.assign(num_options, NEUTRAL);
+            errors.assign(num_options, OK);
+
+            /* в буфер попадают только дни от первого до последнего дня хранилища,
+             * для остальных дней данных нет (как и в find_candle)
+             */
+            key_t min_key = 0, max_key = 0;
+            const bool is_data = get_min_max_key(min_key, max_key) == OK;
+            const size_t num_key_days = is_data ? max_key - min_key + 1 : 0;
+            std::vector<int32_t> &days_slot = batch_days_slot;
+            days_slot.assign(num_key_days, -1);
+            std::vector<key_t> list_day;
+            uint64_t last_day = (uint64_t)-1;
+            auto add_day = [&](const ztime::timestamp_t timestamp) {
+                const uint64_t day = timestamp / ztime::SECONDS_IN_DAY;
+                if(day == last_day) return;
+                last_day = day;
+                if(!is_data || day < min_key || day > max_key || days_slot[day - min_key] >= 0) return;
+                days_slot[day - min_key] = list_day.size();
+                list_day.push_back(day);
+            };
+            for(size_t i = 0; i < num_options; ++i) {
+                const ztime::timestamp_t timestamp_stop = timestamps[i] + durations_sec[i];
+                if(is_protected && timestamp_stop >= last_timestamp) {
+                    errors[i] = DATA_NOT_AVAILABLE;
+                    continue;
+                }
+                if(contract_types[i] != BUY && contract_types[i] != SELL) {
+                    errors[i] = INVALID_PARAMETER;
+                    continue;
                 }
-            } else {
-                // сначала составим список уже загруженных данных
-                std::vector<ztime::timestamp_t> check_timestamp;
-                for(size_t j = 0; j < candles_array_days.size(); ++j) {
-                    //int ind_day = start_ind_day;
-                    ztime::timestamp_t ind_timestamp = start_ind_timestamp;
-                    for(int i = 0; i < num_days; ++i, ind_timestamp += ztime::SECONDS_IN_DAY) {
-                    //for(int i = 0; i < num_days; ++i, ++ind_day, ind_timestamp += ztime::SECONDS_IN_DAY) {
-                        if(std::binary_search(check_timestamp.begin(), check_timestamp.end(), ind_timestamp)) continue;
-                        if(get_prices_timestamp(j) == ind_timestamp) {
-                            auto check_timestamp_it = std::upper_bound(check_timestamp.begin(),check_timestamp.end(), ind_timestamp);
-                            check_timestamp.insert(check_timestamp_it, ind_timestamp);
+                add_day(timestamps[i]);
+                add_day(timestamp_stop);
+            }
+
+            /* цены дня лежат в буфере по индексу ячейки дня * MINUTES_IN_DAY,
+             * последняя ячейка всегда нулевая, в нее указывают цены без данных.
+             * Цена минуты доступна, только если цена закрытия не равна нулю (как в find_candle)
+             */
+            const size_t num_days = list_day.size();
+            const int32_t empty_slot = num_days;
+            std::vector<double> &days_close = batch_days_close;
+            std::vector<double> &days_open = batch_days_open;
+            days_close.assign((num_days + 1) * MINUTES_IN_DAY, 0.0);
+            if(price_type == PRICE_OPEN) days_open.assign((num_days + 1) * MINUTES_IN_DAY, 0.0);
+            auto copy_day = [&](const size_t slot, const CandlesView &view) {
+                std::memcpy(days_close.data() + slot * MINUTES_IN_DAY, view.close.data(), MINUTES_IN_DAY * sizeof(double));
+                if(price_type == PRICE_OPEN) {
+                    std::memcpy(days_open.data() + slot * MINUTES_IN_DAY, view.open.data(), MINUTES_IN_DAY * sizeof(double));
+                }
+            };
+
+            bool is_done = false;
+#           ifndef XQUOTES_DO_NOT_USE_THREAD
+            const int num_thread = std::min((size_t)std::max(num_threads, 1), num_days);
+            if(num_thread > 1 && is_concurrent_read()) {
+                std::vector<std::thread> list_thread(num_thread);
+                for(int thread_ind = 0; thread_ind < num_thread; ++thread_ind) {
+                    list_thread[thread_ind] = std::thread([&, thread_ind]() {
+                        std::unique_ptr<candles_array_t> candles(new candles_array_t());
+                        CandleColumns columns(MINUTES_IN_DAY);
+                        for(size_t slot = thread_ind; slot < num_days; slot += num_thread) {
+                            if(read_day_candles_concurrent(*candles, (ztime::timestamp_t)list_day[slot] * ztime::SECONDS_IN_DAY) != OK) continue;
+                            convert_candles_to_columns(*candles, columns);
+                            copy_day(slot, columns.get_view());
                         }
-                    }
+                    }); // std::thread
                 }
-                // удаляем лишние данные
-                size_t ind_prices = 0;
-                while(ind_prices < candles_array_days.size()) {
-                    if(!std::binary_search(check_timestamp.begin(), check_timestamp.end(), candles_array_days[ind_prices][0].timestamp)) {
-                        candles_array_days.erase(candles_array_days.begin() + ind_prices);
-                        continue;
-                    }
-                    ind_prices++;
+                for(size_t i = 0; i < list_thread.size(); ++i) {
+                    list_thread[i].join();
                 }
-                // далее загрузим недостающие данные
-                int ind_day = start_ind_day;
-                ztime::timestamp_t ind_timestamp = start_ind_timestamp;
-                for(int i = 0; i < num_days; ++i, ++ind_day, ind_timestamp += ztime::SECONDS_IN_DAY) {
-                    if(std::binary_search(check_timestamp.begin(), check_timestamp.end(), ind_timestamp)) continue;
-                    candles_array_days.resize(candles_array_days.size() + 1);
-                    read_candles(candles_array_days[candles_array_days.size() - 1], ind_day, ind_timestamp);
+                is_done = true;
+            }
+#           endif
+            if(!is_done) {
+                for(size_t slot = 0; slot < num_days; ++slot) {
+                    CandlesView view;
+                    if(get_day_view(view, (ztime::timestamp_t)list_day[slot] * ztime::SECONDS_IN_DAY) != OK) continue;
+                    copy_day(slot, view);
                 }
             }
-            sort_candles_array_days();
-        }
 
-        /** \brief Найти свечу по временной метке
-         * \warning Данный метод нужен для внутреннего использования
-         * \param candle Свеча/бар
-         * \param timestamp временная метка начала свечи
-         * \param optimization оптимизация.
-         * Для отключения указать WITHOUT_OPTIMIZATION.
-         * По умолчанию включена оптимизация последовательного считывания минут OPTIMIZATION_SEQUENTIAL_READING
-         * \return вернет 0 в случае успеха
-         */
-        template <typename T>
-        int find_candle(T &candle, const ztime::timestamp_t &timestamp) {
-            int minute_day = ztime::get_minute_day(timestamp);
-            const ztime::timestamp_t timestamp_start_day = ztime::get_first_timestamp_day(timestamp);
-            auto found_candles_array = find_candles_array(timestamp_start_day);
-            if(found_candles_array == candles_array_days.end()) {
-                read_candles_data(timestamp_start_day, indent_day_dn, indent_day_up);
-                found_candles_array = find_candles_array(timestamp_start_day);
-                if(found_candles_array == candles_array_days.end()) return STRANGE_PROGRAM_BEHAVIOR;
+            // цены начала и конца опционов выбираются из буфера дней блоками
+            auto get_price_index = [&](const ztime::timestamp_t timestamp) {
+                const uint64_t minute = timestamp / ztime::SECONDS_IN_MINUTE;
+                const uint64_t day = minute / MINUTES_IN_DAY;
+                const int32_t slot = is_data && day >= min_key && day <= max_key ? days_slot[day - min_key] : empty_slot;
+                return slot * MINUTES_IN_DAY + (int32_t)(minute - day * MINUTES_IN_DAY);
+            };
+            int32_t index_start[BATCH_BLOCK_SIZE], index_stop[BATCH_BLOCK_SIZE];
+            double close_start[BATCH_BLOCK_SIZE], close_stop[BATCH_BLOCK_SIZE];
+            double open_start[BATCH_BLOCK_SIZE], open_stop[BATCH_BLOCK_SIZE];
+            for(size_t block = 0; block < num_options; block += BATCH_BLOCK_SIZE) {
+                const size_t length = std::min((size_t)BATCH_BLOCK_SIZE, num_options - block);
+                for(size_t j = 0; j < length; ++j) {
+                    const size_t i = block + j;
+                    if(errors[i] != OK) {
+                        index_start[j] = index_stop[j] = empty_slot * MINUTES_IN_DAY;
+                        continue;
+                    }
+                    index_start[j] = get_price_index(timestamps[i]);
+                    index_stop[j] = get_price_index(timestamps[i] + durations_sec[i]);
+                }
+                xquotes_simd::gather_doubles(days_close.data(), index_start, close_start, length);
+                xquotes_simd::gather_doubles(days_close.data(), index_stop, close_stop, length);
+                if(price_type == PRICE_OPEN) {
+                    xquotes_simd::gather_doubles(days_open.data(), index_start, open_start, length);
+                    xquotes_simd::gather_doubles(days_open.data(), index_stop, open_stop, length);
+                }
+                const double *price_start = price_type == PRICE_OPEN ? open_start : close_start;
+                const double *price_stop = price_type == PRICE_OPEN ? open_stop : close_stop;
+                for(size_t j = 0; j < length; ++j) {
+                    const size_t i = block + j;
+                    if(errors[i] != OK) continue;
+                    if(close_start[j] == 0.0 || close_stop[j] == 0.0 || price_start[j] == 0.0 || price_stop[j] == 0.0) {
+                        errors[i] = DATA_NOT_AVAILABLE;
+                        continue;
+                    }
+                    states[i] = price_start[j] != price_stop[j] ?
+                        (contract_types[i] == BUY ? (price_start[j] < price_stop[j] ? WIN : LOSS) : (price_start[j] > price_stop[j] ? WIN : LOSS)) :
+                        NEUTRAL;
+                }
             }
-            int ind_day = found_candles_array - candles_array_days.begin();
-            candle = candles_array_days[ind_day][minute_day];
-            return candle.close != 0.0 ? OK : DATA_NOT_AVAILABLE;
+            return OK;
         }
 
         /** \brief Обновить заметку файла
@@ -423,10 +1442,12 @@ namespace xquotes_history {
             const unsigned int PRICE_TYPE_PAIR_MASK = 0xFF00;
             if(get_num_subfiles() == 0) {
                 note_t notes = is_use_dictionary ? COMPRESSION_BIT : 0x00;
-                notes |= user_price_type & PRICE_TYPE_NOTES_MASK;
+                notes |= select_price_layout(user_price_type & PRICE_TYPE_NOTES_MASK);
                 notes |= (user_price_type & PRICE_TYPE_PAIR_MASK);
+                // у нового хранилища знаки после запятой отслеживаются с первого дня
+                notes |= (note_t)1 << DECIMAL_PLACES_NOTES_SHIFT;
                 set_file_note(notes);
-                QuotesHistory::price_type = user_price_type & PRICE_TYPE_NOTES_MASK;
+                QuotesHistory::price_type = select_price_layout(user_price_type & PRICE_TYPE_NOTES_MASK);
                 QuotesHistory::currency_pair = (user_price_type & PRICE_TYPE_PAIR_MASK) >> 8;
             } else {
                 note_t notes = get_file_note();
@@ -440,9 +1461,10 @@ namespace xquotes_history {
             const unsigned int COMPRESSION_BIT = 0x10;
             if(get_num_subfiles() == 0) {
                 note_t notes = is_use_dictionary ? COMPRESSION_BIT : 0x00;
-                notes |= user_price_type & PRICE_TYPE_NOTES_MASK;
+                notes |= select_price_layout(user_price_type & PRICE_TYPE_NOTES_MASK);
+                notes |= (note_t)1 << DECIMAL_PLACES_NOTES_SHIFT;
                 set_file_note(notes);
-                QuotesHistory::price_type = user_price_type & PRICE_TYPE_NOTES_MASK;
+                QuotesHistory::price_type = select_price_layout(user_price_type & PRICE_TYPE_NOTES_MASK);
             } else {
                 note_t notes = get_file_note();
                 QuotesHistory::price_type = notes & PRICE_TYPE_NOTES_MASK;
@@ -643,7 +1665,51 @@ namespace xquotes_history {
             QuotesHistory::indent_day_dn = indent_day_dn;
         }
 
-        ~QuotesHistory() {}
+#       ifndef XQUOTES_DO_NOT_USE_THREAD
+        /** \brief Включить фоновую предзагрузку дней
+         * \details Фоновый поток загружает следующие дни по направлению чтения
+         * (в будущее или вглубь истории), пока используются уже загруженные.
+         * Для фонового чтения включается режим конкурентного чтения, поэтому хранилище становится доступно только для чтения
+         * \param num_days количество дней, загружаемых наперед
+         * \return вернет true, если предзагрузка включена
+         */
+        bool enable_prefetch(const int num_days = 2) {
+            if(!enable_concurrent_read()) return false;
+            prefetcher.reset();
+            prefetcher = std::unique_ptr<xquotes_prefetch::DayPrefetcher<CANDLE_TYPE>>(
+                new xquotes_prefetch::DayPrefetcher<CANDLE_TYPE>(
+                [this](candles_array_t &candles, const key_t day) {
+                    return read_day_candles_concurrent(candles, (ztime::timestamp_t)day * ztime::SECONDS_IN_DAY);
+                }, num_days));
+            return true;
+        }
+
+        /** \brief Выключить фоновую предзагрузку дней
+         */
+        void disable_prefetch() {
+            prefetcher.reset();
+        }
+
+        /** \brief Проверить, включена ли фоновая предзагрузка дней
+         * \return вернет true, если предзагрузка включена
+         */
+        inline bool is_prefetch() const {
+            return (bool)prefetcher;
+        }
+
+        /** \brief Закрыть файл хранилища
+         */
+        virtual void close() {
+            disable_prefetch();
+            Storage::close();
+        }
+#       endif
+
+        ~QuotesHistory() {
+#           ifndef XQUOTES_DO_NOT_USE_THREAD
+            disable_prefetch();
+#           endif
+        }
 
         /** \brief Записать массив свечей
          * \param candles массив свечей
@@ -653,31 +1719,87 @@ namespace xquotes_history {
         int write_candles(
                 const std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles,
                 const ztime::timestamp_t &timestamp) {
-            const size_t buffer_size = price_type == PRICE_OHLCV ? CANDLE_WITH_VOLUME_BUFFER_SIZE :
-                price_type == PRICE_OHLC ? CANDLE_WITHOUT_VOLUME_BUFFER_SIZE : ONLY_ONE_PRICE_BUFFER_SIZE;
-
-            increase_write_buffer_size(buffer_size);
-            char *buffer = write_buffer.get();
-            int err_convert = convert_candles_to_buffer(candles, buffer, buffer_size);
-            int err_write = 0;
-            if(is_use_dictionary) err_write = write_compressed_subfile(ztime::get_day(timestamp), buffer, buffer_size);
-            else err_write = write_subfile(ztime::get_day(timestamp), buffer, buffer_size);
+            if(get_price_layout() != price_type) return INVALID_PARAMETER;
+            const key_t key = ztime::get_day(timestamp);
+            int err_write = OK;
+            if(is_hour_frames()) err_write = write_hour_frames(candles, key);
+            else if(is_column_frames()) err_write = write_column_frames(candles, key);
+            else err_write = write_day_subfile(candles, key);
+            if(err_write == OK) {
+                update_day_summary(candles, key, get_price_layout());
+                update_decimal_places(candles, get_price_layout());
+            }
+            update_written_day(timestamp);
+            return err_write;
+        }
 
-            /* если ошибки записи нет, перечитаем фрагмент (если он в памяти),
-             * который мы только что записали
-             */
-            if(err_convert == OK) {
-                size_t ind_prices = 0;
-                while(ind_prices < candles_array_days.size()) {
-                    if(ztime::get_day(candles_array_days[ind_prices][0].timestamp) == ztime::get_day(timestamp)) {
-                        read_candles(candles_array_days[ind_prices], ztime::get_day(timestamp), ztime::get_first_timestamp_day(timestamp));
-                        break;
-                    }
-                    ind_prices++;
-                }
+        /** \brief Получить день котировок в виде столбцов
+         * Столбцы open, high, low, close и volume - непрерывные выровненные массивы из MINUTES_IN_DAY элементов.
+         * Метки времени не хранятся, см. CandlesView::get_timestamp.
+         * Нулевая цена означает, что данных за эту минуту нет
+         * \warning Представление действительно до следующего сдвига окна котировок
+         * (вызовов get_candle, find_candle, get_day_view, get_range и т.д. для дней вне окна) или записи этого дня
+         * \param view представление дня
+         * \param timestamp метка времени дня
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int get_day_view(CandlesView &view, const ztime::timestamp_t &timestamp) {
+            const ztime::timestamp_t timestamp_start_day = ztime::get_first_timestamp_day(timestamp);
+            candles_array_t *found_candles_array = find_candles_array(timestamp_start_day);
+            if(found_candles_array == NULL) {
+                read_candles_data(timestamp_start_day, indent_day_dn, indent_day_up);
+                found_candles_array = find_candles_array(timestamp_start_day);
+                if(found_candles_array == NULL) return STRANGE_PROGRAM_BEHAVIOR;
             }
+            const int day = ztime::get_day(timestamp);
+            const size_t slot = get_window_slot(day);
+            CandleColumns &columns = columns_days[slot];
+            if(columns_days_key[slot] != day) {
+                columns.resize(MINUTES_IN_DAY);
+                columns.set_timestamp(timestamp_start_day);
+                convert_candles_to_columns(*found_candles_array, columns);
+                columns_days_key[slot] = day;
+                extremum_days_key[slot] = -1;
+            }
+            view = columns.get_view();
+            return OK;
+        }
 
-            return err_convert != OK ? err_convert : err_write;
+        /** \brief Получить свечи за период в виде столбцов
+         * Свечи копируются в непрерывные выровненные столбцы, период может захватывать несколько дней.
+         * Нулевая цена означает, что данных за эту минуту нет
+         * \param columns столбцы свечей
+         * \param timestamp_start метка времени первой свечи
+         * \param timestamp_stop метка времени последней свечи (включительно)
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int get_range(
+                CandleColumns &columns,
+                const ztime::timestamp_t &timestamp_start,
+                const ztime::timestamp_t &timestamp_stop) {
+            if(timestamp_stop < timestamp_start) return INVALID_PARAMETER;
+            const ztime::timestamp_t first_timestamp = timestamp_start - timestamp_start % ztime::SECONDS_IN_MINUTE;
+            const ztime::timestamp_t last_timestamp = timestamp_stop - timestamp_stop % ztime::SECONDS_IN_MINUTE;
+            const size_t num_candles = (last_timestamp - first_timestamp) / ztime::SECONDS_IN_MINUTE + 1;
+            columns.resize(num_candles);
+            columns.set_timestamp(first_timestamp);
+            size_t ind = 0;
+            ztime::timestamp_t timestamp = first_timestamp;
+            while(ind < num_candles) {
+                CandlesView view;
+                int err = get_day_view(view, timestamp);
+                if(err != OK) return err;
+                const size_t minute_day = ztime::get_minute_day(timestamp);
+                const size_t length = std::min((size_t)MINUTES_IN_DAY - minute_day, num_candles - ind);
+                std::memcpy(columns.data(CandleColumns::COLUMN_OPEN) + ind, view.open.data() + minute_day, length * sizeof(double));
+                std::memcpy(columns.data(CandleColumns::COLUMN_HIGH) + ind, view.high.data() + minute_day, length * sizeof(double));
+                std::memcpy(columns.data(CandleColumns::COLUMN_LOW) + ind, view.low.data() + minute_day, length * sizeof(double));
+                std::memcpy(columns.data(CandleColumns::COLUMN_CLOSE) + ind, view.close.data() + minute_day, length * sizeof(double));
+                std::memcpy(columns.data(CandleColumns::COLUMN_VOLUME) + ind, view.volume.data() + minute_day, length * sizeof(double));
+                ind += length;
+                timestamp += length * ztime::SECONDS_IN_MINUTE;
+            }
+            return OK;
         }
 
         /** \brief Получить свечу по временной метке
@@ -698,8 +1820,8 @@ namespace xquotes_history {
             } else
             if(optimization == OPTIMIZATION_SEQUENTIAL_READING) {
                 if(candles_array_days.size() > 0 &&
-                        candles_array_days[ind_forecast_day][ind_forecast_minute].timestamp == timestamp) {
-                    candle = candles_array_days[ind_forecast_day][ind_forecast_minute];
+                        window_day(ind_forecast_day)[ind_forecast_minute].timestamp == timestamp) {
+                    candle = window_day(ind_forecast_day)[ind_forecast_minute];
                     // прогноз оправдался, делаем следующий прогноз
                     make_next_candles_forecast();
                     return candle.close != 0.0 ? OK : DATA_NOT_AVAILABLE;
@@ -708,13 +1830,13 @@ namespace xquotes_history {
                     int minute_day = ztime::get_minute_day(timestamp);
                     const ztime::timestamp_t first_timestamp_day = ztime::get_first_timestamp_day(timestamp);
                     if(set_start_candles_forecast(first_timestamp_day, minute_day)) {
-                        candle = candles_array_days[ind_forecast_day][ind_forecast_minute];
+                        candle = window_day(ind_forecast_day)[ind_forecast_minute];
                         return candle.close != 0.0 ? OK : DATA_NOT_AVAILABLE;
                     }
                     // поиск не дал результатов, грузим котировки
                     read_candles_data(first_timestamp_day, indent_day_dn, indent_day_up);
                     if(set_start_candles_forecast(first_timestamp_day, minute_day)) {
-                        candle = candles_array_days[ind_forecast_day][ind_forecast_minute];
+                        candle = window_day(ind_forecast_day)[ind_forecast_minute];
                         return candle.close != 0.0 ? OK : DATA_NOT_AVAILABLE;
                     }
                     return STRANGE_PROGRAM_BEHAVIOR;
@@ -723,6 +1845,130 @@ namespace xquotes_history {
             return INVALID_PARAMETER;
         }
 
+        /** \brief Прочитать свечи за день в режиме конкурентного чтения
+         * \details Метод можно вызывать из нескольких потоков одновременно после вызова enable_concurrent_read.
+         * Метод не использует и не изменяет дни, загруженные в память методами get_candle и get_price.
+         * Для подфайлов с кадрами по столбцам читаются только столбцы, заданные методом set_read_columns
+         * \param candles массив свечей за день
+         * \param timestamp метка времени дня
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int read_day_candles_concurrent(
+                std::array<CANDLE_TYPE, MINUTES_IN_DAY>& candles,
+                const ztime::timestamp_t &timestamp) const {
+            const key_t key = ztime::get_day(timestamp);
+            xquotes_day_cache::DayCache<CANDLE_TYPE> &day_cache = xquotes_day_cache::DayCache<CANDLE_TYPE>::get_instance();
+            if(day_cache.get(file_name, key, candles)) return OK;
+            fill_timestamp(candles, ztime::get_first_timestamp_day(timestamp));
+            unsigned long buffer_size = 0;
+            int err = OK;
+            static thread_local std::unique_ptr<char[]> read_buffer;
+            static thread_local size_t read_buffer_size = 0;
+            if(is_hour_frames()) {
+                const char *subfile = NULL;
+                unsigned long subfile_size = 0;
+                err = read_subfile_view_concurrent(key, subfile, subfile_size);
+                if(err != OK) return err;
+                err = read_hour_frames_to_candles(candles, [&](const size_t frame, const char *&data, unsigned long &data_size) {
+                    int err_frame = find_subfile_frame(subfile, subfile_size, frame, data, data_size);
+                    if(err_frame != OK || !is_use_dictionary) return err_frame;
+                    err_frame = decompress_subfile_frame_concurrent(data, data_size, read_buffer, read_buffer_size, data_size);
+                    data = read_buffer.get();
+                    return err_frame;
+                });
+            } else
+            if(is_column_frames()) {
+                err = read_frames_to_candles(candles, [&](const size_t frame, const char *&data, unsigned long &data_size) {
+                    if(!is_use_dictionary) return read_subfile_frame_view_concurrent(key, frame, data, data_size);
+                    int err_frame = read_compressed_subfile_frame_concurrent(key, frame, read_buffer, read_buffer_size, data_size);
+                    data = read_buffer.get();
+                    return err_frame;
+                });
+            } else
+            if(is_use_dictionary) {
+                err = read_compressed_subfile_concurrent(key, read_buffer, read_buffer_size, buffer_size);
+                if(err != OK) return err;
+                err = convert_buffer_to_candles(candles, read_buffer.get(), buffer_size);
+            } else {
+                const char *buffer = NULL;
+                err = read_subfile_view_concurrent(key, buffer, buffer_size);
+                if(err != OK) return err;
+                err = convert_buffer_to_candles(candles, buffer, buffer_size);
+            }
+            if(err == OK && !is_partial_read()) day_cache.put(file_name, key, candles);
+            return err;
+        }
+
+        /** \brief Получить итоги дня
+         * Итоги (open, high, low, close, объем, число валидных минут, первая и последняя валидная минута)
+         * хранятся в заголовке хранилища и записываются методом write_candles, подфайл дня не читается.
+         * Для файлов, записанных до появления итогов, вызовите rebuild_day_summaries
+         * \param summary итоги дня
+         * \param timestamp метка времени дня
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int get_day_summary(DaySummary &summary, const ztime::timestamp_t &timestamp) const {
+            const std::vector<char> *section = find_header_section(HEADER_SECTION_DAY_SUMMARIES);
+            if(section == NULL) return DATA_NOT_AVAILABLE;
+            const key_t key = ztime::get_day(timestamp);
+            const size_t ind = find_day_summary_record(*section, key);
+            if(!check_day_summary_record(*section, ind, key)) return DATA_NOT_AVAILABLE;
+            read_day_summary_record(summary, section->data() + ind * DAY_SUMMARY_RECORD_SIZE);
+            return OK;
+        }
+
+        /** \brief Получить итоги дней за период
+         * \param summaries итоги дней, отсортированные по времени (дни без итогов пропускаются)
+         * \param timestamp_start метка времени первого дня
+         * \param timestamp_stop метка времени последнего дня (включительно)
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int get_day_summaries(
+                std::vector<DaySummary> &summaries,
+                const ztime::timestamp_t &timestamp_start,
+                const ztime::timestamp_t &timestamp_stop) const {
+            summaries.clear();
+            if(timestamp_start > timestamp_stop) return INVALID_PARAMETER;
+            const std::vector<char> *section = find_header_section(HEADER_SECTION_DAY_SUMMARIES);
+            if(section == NULL) return DATA_NOT_AVAILABLE;
+            const size_t num_records = section->size() / DAY_SUMMARY_RECORD_SIZE;
+            const int day_stop = ztime::get_day(timestamp_stop);
+            for(size_t ind = find_day_summary_record(*section, ztime::get_day(timestamp_start)); ind < num_records; ++ind) {
+                DaySummary summary;
+                read_day_summary_record(summary, section->data() + ind * DAY_SUMMARY_RECORD_SIZE);
+                if((int)ztime::get_day(summary.timestamp) > day_stop) break;
+                summaries.push_back(summary);
+            }
+            return OK;
+        }
+
+        /** \brief Пересчитать итоги всех дней хранилища
+         * Метод читает все дни хранилища, его нужно вызвать один раз для файлов,
+         * записанных до появления итогов дней (см. get_day_summary).
+         * Также пересчитывается количество знаков после запятой в заметке файла (см. get_decimal_places)
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int rebuild_day_summaries() {
+            if(is_read_only()) return NOT_WRITE_FILE;
+            // итоги считаются по всем ценам дня
+            const int user_read_columns_mask = read_columns_mask;
+            read_columns_mask = (1 << CandleColumns::NUM_COLUMNS) - 1;
+            get_header_section(HEADER_SECTION_DAY_SUMMARIES).clear();
+            std::unique_ptr<candles_array_t> candles(new candles_array_t());
+            int err = OK;
+            int decimal_places = 0;
+            for(size_t i = 0; i < get_num_subfiles(); ++i) {
+                const key_t key = get_key_subfiles(i);
+                err = read_candles_from_storage(*candles, key, (ztime::timestamp_t)key * ztime::SECONDS_IN_DAY);
+                if(err != OK) break;
+                update_day_summary(*candles, key, PRICE_CLOSE);
+                decimal_places = std::max(decimal_places, find_decimal_places(*candles, PRICE_CLOSE));
+            }
+            if(err == OK) set_note_decimal_places(decimal_places);
+            read_columns_mask = user_read_columns_mask;
+            return err;
+        }
+
         /** \brief Получить цену (OPEN, HIGH, LOW, CLOSE) по указанной метке времени
          * \param price цена на указанной временной метке
          * \param timestamp временная метка
@@ -763,8 +2009,11 @@ namespace xquotes_history {
          * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
          */
         int delete_day(const ztime::timestamp_t timestamp) {
-
+            // итоги дня удаляем до удаления подфайла, чтобы они не попали в перезаписанный заголовок
+            erase_day_summary(ztime::get_day(timestamp));
             int err = delete_subfile(ztime::get_day(timestamp));
+            xquotes_day_cache::DayCache<CANDLE_TYPE>::get_instance().erase(file_name, ztime::get_day(timestamp));
+            erase_hour_frames(ztime::get_day(timestamp));
             return err;
         }
 
@@ -799,12 +2048,12 @@ namespace xquotes_history {
 
             // сначала проверяем прогноз на текущую свечу
             if(optimization == OPTIMIZATION_SEQUENTIAL_READING) {
-                if(ind_forecast_minute > 0 && candles_array_days[ind_forecast_day][ind_forecast_minute - 1].timestamp == timestamp) {
-                    price_start = price_type == PRICE_CLOSE ? candles_array_days[ind_forecast_day][ind_forecast_minute - 1].close : candles_array_days[ind_forecast_day][ind_forecast_minute - 1].open;
+                if(candles_array_days.size() > 0 && ind_forecast_minute > 0 && window_day(ind_forecast_day)[ind_forecast_minute - 1].timestamp == timestamp) {
+                    price_start = price_type == PRICE_CLOSE ? window_day(ind_forecast_day)[ind_forecast_minute - 1].close : window_day(ind_forecast_day)[ind_forecast_minute - 1].open;
                     if(price_start == 0.0) return DATA_NOT_AVAILABLE;
                 } else
-                if(ind_forecast_day > 0 && ind_forecast_minute == 0 && candles_array_days[ind_forecast_day - 1][MINUTES_IN_DAY - 1].timestamp == timestamp) {
-                    price_start = price_type == PRICE_CLOSE ? candles_array_days[ind_forecast_day - 1][MINUTES_IN_DAY - 1].close : candles_array_days[ind_forecast_day - 1][MINUTES_IN_DAY - 1].open;
+                if(candles_array_days.size() > 0 && ind_forecast_day > 0 && ind_forecast_minute == 0 && window_day(ind_forecast_day - 1)[MINUTES_IN_DAY - 1].timestamp == timestamp) {
+                    price_start = price_type == PRICE_CLOSE ? window_day(ind_forecast_day - 1)[MINUTES_IN_DAY - 1].close : window_day(ind_forecast_day - 1)[MINUTES_IN_DAY - 1].open;
                     if(price_start == 0.0) return DATA_NOT_AVAILABLE;
                 } else {
                     // придется искать цену
@@ -857,11 +2106,57 @@ namespace xquotes_history {
             return check_binary_option(state, contract_type, duration_sec, open_timestamp, price_type, optimization);
         }
 
-        /** \brief Проверить ордер (метод пока не доделан!)
+        /** \brief Проверить пакет бинарных опционов
+         * Результат каждого опциона совпадает с результатом check_binary_option без оптимизации,
+         * но запросы цен сортируются по дням, каждый день читается один раз, а цены выбираются из столбцов дня.
+         * Если включен режим конкурентного чтения (enable_concurrent_read), дни читаются в нескольких потоках
+         * \param states состояния опционов (удачная сделка WIN = 1, убыточная LOSS = -1 и нейтральная NEUTRAL = 0)
+         * \param errors коды ошибок опционов (OK, если состояние опциона получено)
+         * \param timestamps метки времени начала опционов
+         * \param durations_sec длительности опционов в секундах
+         * \param contract_types типы контрактов (доступно BUY = 1 и SELL = -1)
+         * \param price_type цена входа в опцион (цена закрытия PRICE_CLOSE или открытия PRICE_OPEN свечи)
+         * \param num_threads количество потоков, больше одного потока используется только в режиме конкурентного чтения
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int check_binary_options(
+                std::vector<int> &states,
+                std::vector<int> &errors,
+                const std::vector<ztime::timestamp_t> &timestamps,
+                const std::vector<int> &durations_sec,
+                const std::vector<int> &contract_types,
+                const int &price_type = PRICE_CLOSE,
+                const int &num_threads = 1) {
+            return check_binary_options_batch(states, errors, timestamps, durations_sec, contract_types, price_type, false, 0, num_threads);
+        }
+
+        /** \brief Проверить пакет бинарных опционов с защитой от "подглядывания в будущее"
+         * Опционы, которые заканчиваются не раньше last_timestamp, получают ошибку DATA_NOT_AVAILABLE,
+         * как в методе check_protected_binary_option. Остальные параметры см. check_binary_options
+         * \param last_timestamp последняя допустимая метка времени
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int check_protected_binary_options(
+                std::vector<int> &states,
+                std::vector<int> &errors,
+                const std::vector<ztime::timestamp_t> &timestamps,
+                const std::vector<int> &durations_sec,
+                const std::vector<int> &contract_types,
+                const ztime::timestamp_t &last_timestamp,
+                const int &price_type = PRICE_CLOSE,
+                const int &num_threads = 1) {
+            return check_binary_options_batch(states, errors, timestamps, durations_sec, contract_types, price_type, true, last_timestamp, num_threads);
+        }
+
+        /** \brief Проверить ордер
          * Данный метод вычисляет профит открытого ордера
          * При поиске цены входа в сделку данный метод в первую очередь проверит последнюю полученную цену (если используется оптимизация),
          * которая была получена через метод get_candle. Если метка времени последней полученной цены не совпадает с требуемой,
          * то метод начнет поиск цены в хранилище.
+         * Минута закрытия ордера ищется не перебором свечей, а по итогам дней и индексу экстремумов
+         * блоков по BlockExtremumIndex::BLOCK_SIZE минут, поэтому длинные ордера проверяются быстро.
+         * Если в одной минуте достигнуты оба уровня, считается, что сработал стоп лосс.
+         * Если данные закончились раньше, чем сработал тэйк профит или стоп лосс, метод вернет ошибку
          * \warning Будьте аккуратны! Данный метод может создать эффект "подглядывания в будущее"
          * \param profit Разница между ценами (представлена в единицах котировок цены)
          * \param contract_type тип контракта (доступно BUY = 1 и SELL = -1)
@@ -890,17 +2185,17 @@ namespace xquotes_history {
                 const bool &is_ignore_skipping = false) {
             profit = 0.0;
             if(price_type != PRICE_CLOSE && price_type != PRICE_OPEN) return INVALID_PARAMETER;
-            double price_start, price_stop;
-            CANDLE_TYPE candle_start, candle_stop;
+            double price_start;
+            CANDLE_TYPE candle_start;
 
             // сначала проверяем прогноз на текущую свечу
             if(optimization == OPTIMIZATION_SEQUENTIAL_READING) {
-                if(ind_forecast_minute > 0 && candles_array_days[ind_forecast_day][ind_forecast_minute - 1].timestamp == timestamp) {
-                    price_start = price_type == PRICE_CLOSE ? candles_array_days[ind_forecast_day][ind_forecast_minute - 1].close : candles_array_days[ind_forecast_day][ind_forecast_minute - 1].open;
+                if(candles_array_days.size() > 0 && ind_forecast_minute > 0 && window_day(ind_forecast_day)[ind_forecast_minute - 1].timestamp == timestamp) {
+                    price_start = price_type == PRICE_CLOSE ? window_day(ind_forecast_day)[ind_forecast_minute - 1].close : window_day(ind_forecast_day)[ind_forecast_minute - 1].open;
                     if(price_start == 0.0) return DATA_NOT_AVAILABLE;
                 } else
-                if(ind_forecast_day > 0 && ind_forecast_minute == 0 && candles_array_days[ind_forecast_day - 1][MINUTES_IN_DAY - 1].timestamp == timestamp) {
-                    price_start = price_type == PRICE_CLOSE ? candles_array_days[ind_forecast_day - 1][MINUTES_IN_DAY - 1].close : candles_array_days[ind_forecast_day - 1][MINUTES_IN_DAY - 1].open;
+                if(candles_array_days.size() > 0 && ind_forecast_day > 0 && ind_forecast_minute == 0 && window_day(ind_forecast_day - 1)[MINUTES_IN_DAY - 1].timestamp == timestamp) {
+                    price_start = price_type == PRICE_CLOSE ? window_day(ind_forecast_day - 1)[MINUTES_IN_DAY - 1].close : window_day(ind_forecast_day - 1)[MINUTES_IN_DAY - 1].open;
                     if(price_start == 0.0) return DATA_NOT_AVAILABLE;
                 } else {
                     // придется искать цену
@@ -921,68 +2216,22 @@ namespace xquotes_history {
                 double tl = price_start + spread + take_profit;
                 double bl = price_start + spread - stop_loss;
                 ztime::timestamp_t t = timestamp;
-                while(true) {
-                    CANDLE_TYPE candle;
-                    int err = get_candle(candle, t);
-                    if(err != OK) {
-                        if(is_ignore_skipping) {
-                            t += ztime::SECONDS_IN_MINUTE;
-                            continue;
-                        } else return DATA_NOT_AVAILABLE;
-                    }
-                    if( candle.high == 0.0 ||
-                        candle.low == 0.0) {
-                        if(is_ignore_skipping) {
-                            t += ztime::SECONDS_IN_MINUTE;
-                            continue;
-                        } else return DATA_NOT_AVAILABLE;
-                    }
-                    if(candle.low <= bl) {
-                        profit = -stop_loss;
-                        timestamp_end = t;
-                        break;
-                    } else
-                    if(candle.high >= tl) {
-                        profit = take_profit;
-                        timestamp_end = t;
-                        break;
-                    }
-                    t += ztime::SECONDS_IN_MINUTE;
-                }
+                CANDLE_TYPE candle;
+                int err = find_first_touch(candle, t, bl, tl, is_ignore_skipping);
+                if(err != OK) return DATA_NOT_AVAILABLE;
+                profit = candle.low <= bl ? -stop_loss : take_profit;
+                timestamp_end = t;
             } else
             if(contract_type == SELL) {
                 profit = -spread;
                 double tl = price_start - spread + stop_loss;
                 double bl = price_start - spread - take_profit;
                 ztime::timestamp_t t = timestamp;
-                while(true) {
-                    CANDLE_TYPE candle;
-                    int err = get_candle(candle, t);
-                    if(err != OK) {
-                        if(is_ignore_skipping) {
-                            t += ztime::SECONDS_IN_MINUTE;
-                            continue;
-                        } else return DATA_NOT_AVAILABLE;
-                    }
-                    if( candle.high == 0.0 ||
-                        candle.low == 0.0) {
-                        if(is_ignore_skipping) {
-                            t += ztime::SECONDS_IN_MINUTE;
-                            continue;
-                        } else return DATA_NOT_AVAILABLE;
-                    }
-                    if(candle.high >= tl) {
-                        profit = -stop_loss;
-                        timestamp_end = t;
-                        break;
-                    } else
-                    if(candle.low <= bl) {
-                        profit = take_profit;
-                        timestamp_end = t;
-                        break;
-                    }
-                    t += ztime::SECONDS_IN_MINUTE;
-                }
+                CANDLE_TYPE candle;
+                int err = find_first_touch(candle, t, bl, tl, is_ignore_skipping);
+                if(err != OK) return DATA_NOT_AVAILABLE;
+                profit = candle.high >= tl ? -stop_loss : take_profit;
+                timestamp_end = t;
             } else return DATA_NOT_AVAILABLE;
             return OK;
         }
@@ -1059,120 +2308,319 @@ namespace xquotes_history {
             return OK;
         }
 
-        /** \brief Торговать
-         * \warning метка времени start_timestamp (весь день) входит в диапазон торговли!
-         * \param start_timestamp метка времени начала торговли
-         * \param stop_timestamp метка времени конца торговли
-         * \param step_timestamp шаг метки времени (для минутного таймфрейма ztime::SECONDS_IN_MINUTE)
-         * \param f лямбла-функция для обработки торговли
-         * \param is_day_off_filter если true, используется фильтр торговли в выходные дни
-         * \param is_go_back_in_time проход поиска дней торговли совершается вглубь истории, если true
-         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+        /** \brief Торговать
+         * \details Функция f передается как параметр шаблона, поэтому лямбда-функция или функтор
+         * встраиваются в цикл торговли без косвенного вызова. Можно передать и std::function
+         * \warning метка времени start_timestamp (весь день) входит в диапазон торговли!
+         * \param start_timestamp метка времени начала торговли
+         * \param stop_timestamp метка времени конца торговли
+         * \param step_timestamp шаг метки времени (для минутного таймфрейма ztime::SECONDS_IN_MINUTE)
+         * \param f функция для обработки торговли вида void(const CANDLE_TYPE &candle, const int err)
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        template<class FUNC>
+        auto trade(
+                const ztime::timestamp_t &start_timestamp,
+                const ztime::timestamp_t &stop_timestamp,
+                const int &step_timestamp,
+                FUNC f) -> decltype((void)f(std::declval<const CANDLE_TYPE&>(), 0), int()) {
+            for(ztime::timestamp_t t = start_timestamp; t <= stop_timestamp; t += step_timestamp) {
+                CANDLE_TYPE candle;
+                int err = get_candle(candle, t);
+                f(candle, err);
+            }
+            return OK;
+        }
+
+        /** \brief Торговать
+         * \warning метка времени start_timestamp (весь день) входит в диапазон торговли!
+         * \param start_timestamp метка времени поиска начала торговли
+         * (начиная с дня метки времени будет запущена торговля)
+         * \param step_timestamp шаг метки времени (для минутного таймфрейма ztime::SECONDS_IN_MINUTE)
+         * \param num_days количество дней для торговли
+         * \param f функция для обработки торговли вида void(const CANDLE_TYPE &candle, const int day, const int err),
+         * передается как параметр шаблона (лямбда-функция, функтор или std::function)
+         * \param is_day_off_filter если true, используется фильтр торговли в выходные дни
+         * \param is_go_back_in_time проход поиска дней торговли совершается вглубь истории, если true
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        template<class FUNC>
+        auto trade(
+                const ztime::timestamp_t &start_timestamp,
+                const int &step_timestamp,
+                const int &num_days,
+                FUNC f,
+                const bool &is_day_off_filter = true,
+                const bool &is_go_back_in_time = true) -> decltype((void)f(std::declval<const CANDLE_TYPE&>(), 0, 0), int()) {
+            std::vector<ztime::timestamp_t> list_timestamp;
+            int err = get_day_timestamp_list(
+                list_timestamp,
+                start_timestamp,
+                num_days,
+                is_day_off_filter,
+                is_go_back_in_time);
+            if(err != OK || (int)list_timestamp.size() != num_days) return DATA_NOT_AVAILABLE;
+            for(int i = 0; i < num_days; ++i) {
+                ztime::timestamp_t stop_timestamp = list_timestamp[i] + ztime::SECONDS_IN_DAY;
+                for(ztime::timestamp_t t = list_timestamp[i]; t < stop_timestamp; t += step_timestamp) {
+                    CANDLE_TYPE candle;
+                    int err = get_candle(candle, t);
+                    f(candle, i, err);
+                } // for t
+            } // for i
+            return OK;
+        }
+
+        /** \brief Торговать по дням
+         * \details Функция f вызывается один раз для каждого дня и получает весь день в виде столбцов
+         * (см. get_day_view), поэтому проход по минутам дня остается в коде стратегии
+         * и может быть векторизован компилятором. Нулевая цена означает, что данных за минуту нет
+         * \warning метка времени start_timestamp (весь день) входит в диапазон торговли!
+         * Представление дня действительно только во время вызова f
+         * \param start_timestamp метка времени поиска начала торговли
+         * (начиная с дня метки времени будет запущена торговля)
+         * \param num_days количество дней для торговли
+         * \param f функция для обработки дня вида void(const CandlesView &view, const int day, const int err),
+         * передается как параметр шаблона (лямбда-функция, функтор или std::function)
+         * \param is_day_off_filter если true, используется фильтр торговли в выходные дни
+         * \param is_go_back_in_time проход поиска дней торговли совершается вглубь истории, если true
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        template<class FUNC>
+        int trade_day_views(
+                const ztime::timestamp_t &start_timestamp,
+                const int &num_days,
+                FUNC f,
+                const bool &is_day_off_filter = true,
+                const bool &is_go_back_in_time = true) {
+            std::vector<ztime::timestamp_t> list_timestamp;
+            int err = get_day_timestamp_list(
+                list_timestamp,
+                start_timestamp,
+                num_days,
+                is_day_off_filter,
+                is_go_back_in_time);
+            if(err != OK || (int)list_timestamp.size() != num_days) return DATA_NOT_AVAILABLE;
+            for(int i = 0; i < num_days; ++i) {
+                CandlesView view;
+                int err = get_day_view(view, list_timestamp[i]);
+                f(view, i, err);
+            }
+            return OK;
+        }
+
+        /** \brief Получить тип цены хранилища
+         * Если тип цены задан параметром шаблона, метод возвращает константу
+         * \return тип цены (PRICE_CLOSE, PRICE_OPEN, PRICE_OHLC или PRICE_OHLCV)
+         */
+        inline int get_price_layout() const {
+            return PRICE_LAYOUT == PRICE_RUNTIME ? price_type : PRICE_LAYOUT;
+        }
+
+        /** \brief Проверить, используется ли сжатие подфайлов
+         * Настройка берется из заметки файла, если в хранилище уже есть подфайлы
+         * \return вернет true, если подфайлы сжимаются (USE_COMPRESSION)
+         */
+        inline bool is_compression() const {
+            return is_use_dictionary;
+        }
+
+#       ifdef XQUOTES_USE_DICTIONARY_CURRENCY_PAIR
+        /** \brief Получить валютную пару хранилища
+         * \return валютная пара, см. get_price_type_with_specific
+         */
+        inline int get_currency_pair() const {
+            return currency_pair;
+        }
+#       endif
+
+        /** \brief Проверить тип цены хранилища
+         * Если тип цены задан параметром шаблона PRICE_LAYOUT, он должен совпадать с типом цены файла.
+         * Иначе чтение дней вернет INVALID_ARRAY_LENGH, а запись - INVALID_PARAMETER
+         * \return вернет true, если тип цены файла совпадает с PRICE_LAYOUT (или PRICE_LAYOUT равен PRICE_RUNTIME)
+         */
+        inline bool check_price_layout() const {
+            return get_price_layout() == price_type;
+        }
+
+        /** \brief Проверить, хранятся ли столбцы цен в отдельных кадрах подфайлов
+         * \return вернет true, если каждый столбец цен дня хранится (и сжимается) отдельно
+         */
+        inline bool is_column_frames() const {
+            return (get_file_note() & COLUMN_FRAMES_NOTES_BIT) != 0;
+        }
+
+        /** \brief Включить хранение столбцов цен в отдельных кадрах подфайлов
+         * Подфайл дня содержит таблицу смещений и независимые кадры open, high, low, close и volume,
+         * поэтому при чтении только цен закрытия (см. set_read_columns) распаковывается только один кадр.
+         * Настройка записывается в заметку файла, изменить ее можно только у пустого хранилища (до записи первого дня)
+         * \param is_enable включить кадры по столбцам
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int set_column_frames(const bool is_enable) {
+            if(is_read_only()) return NOT_WRITE_FILE;
+            if(get_num_subfiles() != 0) return INVALID_PARAMETER;
+            if(is_enable && is_hour_frames()) return INVALID_PARAMETER;
+            if(is_enable) set_file_note(get_file_note() | COLUMN_FRAMES_NOTES_BIT);
+            else set_file_note(get_file_note() & ~(note_t)COLUMN_FRAMES_NOTES_BIT);
+            return OK;
+        }
+
+        /** \brief Проверить, хранятся ли часы дня в отдельных кадрах подфайлов
+         * \return вернет true, если каждый час дня хранится (и сжимается) отдельно
+         */
+        inline bool is_hour_frames() const {
+            return (get_file_note() & HOUR_FRAMES_NOTES_BIT) != 0;
+        }
+
+        /** \brief Включить хранение часов дня в отдельных кадрах подфайлов
+         * Подфайл дня содержит таблицу смещений и NUM_HOUR_FRAMES независимых кадров по MINUTES_IN_HOUR_FRAME минут,
+         * поэтому find_candle (и методы, которые его используют, например check_binary_option)
+         * для дня вне окна котировок распаковывает только кадр с нужной минутой, см. set_hour_frames_cache.
+         * Часовые кадры нельзя совмещать с кадрами по столбцам (set_column_frames).
+         * Настройка записывается в заметку файла, изменить ее можно только у пустого хранилища (до записи первого дня)
+         * \param is_enable включить часовые кадры
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int set_hour_frames(const bool is_enable) {
+            if(is_read_only()) return NOT_WRITE_FILE;
+            if(get_num_subfiles() != 0) return INVALID_PARAMETER;
+            if(is_enable && is_column_frames()) return INVALID_PARAMETER;
+            if(is_enable) set_file_note(get_file_note() | HOUR_FRAMES_NOTES_BIT);
+            else set_file_note(get_file_note() & ~(note_t)HOUR_FRAMES_NOTES_BIT);
+            return OK;
+        }
+
+        /** \brief Установить размер кэша часовых кадров
+         * Кэш хранит распакованные часовые кадры, прочитанные методом find_candle.
+         * По умолчанию размер кэша равен NUM_HOUR_FRAMES (один день), размер 1 - хранить только последний кадр
+         * \param num_frames количество кадров в кэше
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int set_hour_frames_cache(const size_t num_frames) {
+            if(num_frames == 0) return INVALID_PARAMETER;
+            hour_frames_cache_size = num_frames;
+            hour_frames.clear();
+            hour_frames_key.clear();
+            return OK;
+        }
+
+        /** \brief Установить столбцы цен, читаемые из подфайлов с кадрами по столбцам
+         * Например, для стратегии, которая использует только цены закрытия, укажите 1 << CandleColumns::COLUMN_CLOSE.
+         * Тогда get_candle, get_price и т.д. вернут свечи, у которых остальные цены равны 0.
+         * Неполные дни не попадают в общий кэш дней. Для файлов без кадров настройка не влияет на чтение.
+         * Дни, уже загруженные в окно котировок, будут перечитаны.
+         * Вызывать метод нужно до включения фоновой предзагрузки (enable_prefetch)
+         * \param columns_mask биты столбцов (1 << CandleColumns::COLUMN_OPEN ... 1 << CandleColumns::COLUMN_VOLUME)
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int set_read_columns(const int columns_mask) {
+            const int all_columns = (1 << CandleColumns::NUM_COLUMNS) - 1;
+            if(columns_mask <= 0 || columns_mask > all_columns) return INVALID_PARAMETER;
+#           ifndef XQUOTES_DO_NOT_USE_THREAD
+            if(prefetcher) return INVALID_PARAMETER;
+#           endif
+            read_columns_mask = columns_mask;
+            std::fill(candles_array_days_key.begin(), candles_array_days_key.end(), -1);
+            std::fill(columns_days_key.begin(), columns_days_key.end(), -1);
+            return OK;
+        }
+
+        /** \brief Получить кодек цен хранилища
+         * \return кодек цен (xquotes_codec::CODEC_NONE или xquotes_codec::CODEC_DELTA_ZIGZAG_BITPACK)
          */
-        int trade(
-                const ztime::timestamp_t &start_timestamp,
-                const ztime::timestamp_t &stop_timestamp,
-                const int &step_timestamp,
-                std::function<void (
-                    const CANDLE_TYPE &candle,
-                    const int err)> f) {
-            for(ztime::timestamp_t t = start_timestamp; t <= stop_timestamp; t += step_timestamp) {
-                CANDLE_TYPE candle;
-                int err = get_candle(candle, t);
-                f(candle, err);
-            }
-            return OK;
+        inline int get_price_codec() const {
+            return (int)((get_file_note() & CODEC_NOTES_MASK) >> CODEC_NOTES_SHIFT);
         }
 
-        /** \brief Торговать
-         * \warning метка времени start_timestamp (весь день) входит в диапазон торговли!
-         * \param start_timestamp метка времени поиска начала торговли
-         * (начиная с дня метки времени будет запущена торговля)
-         * \param step_timestamp шаг метки времени (для минутного таймфрейма ztime::SECONDS_IN_MINUTE)
-         * \param num_days количество дней для торговли
-         * \param f лямбла-функция для обработки торговли
-         * \param is_day_off_filter если true, используется фильтр торговли в выходные дни
-         * \param is_go_back_in_time проход поиска дней торговли совершается вглубь истории, если true
+        /** \brief Установить кодек цен хранилища
+         * Кодек раскладывает цены дня по столбцам и хранит упакованные разности цен (см. xquotes_codec.hpp).
+         * Кодек записывается в заметку файла и работает как со сжатием zstd, так и без него.
+         * Кодек можно изменить только у пустого хранилища (до записи первого дня)
+         * \param codec кодек цен (xquotes_codec::CODEC_NONE или xquotes_codec::CODEC_DELTA_ZIGZAG_BITPACK)
          * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
          */
-        int trade(
-                const ztime::timestamp_t &start_timestamp,
-                const int &step_timestamp,
-                const int &num_days,
-                std::function<void (
-                    const CANDLE_TYPE &candle,
-                    const int day,
-                    const int err)> f,
-                const bool &is_day_off_filter = true,
-                const bool &is_go_back_in_time = true) {
-            std::vector<ztime::timestamp_t> list_timestamp;
-            int err = get_day_timestamp_list(
-                start_timestamp,
-                list_timestamp,
-                num_days,
-                is_day_off_filter,
-                is_go_back_in_time);
-            if(err != OK || list_timestamp.size() != num_days);
-            for(int i = 0; i < num_days; ++i) {
-                ztime::timestamp_t stop_timestamp = list_timestamp[i] + ztime::SECONDS_IN_DAY;
-                for(ztime::timestamp_t t = list_timestamp[i]; t < stop_timestamp; t += step_timestamp) {
-                    CANDLE_TYPE candle;
-                    int err = get_candle(candle, t);
-                    f(candle, i, err);
-                } // for t
-            } // for i
+        int set_price_codec(const int codec) {
+            if(codec != xquotes_codec::CODEC_NONE && codec != xquotes_codec::CODEC_DELTA_ZIGZAG_BITPACK) return INVALID_PARAMETER;
+            if(is_read_only()) return NOT_WRITE_FILE;
+            if(get_num_subfiles() != 0) return INVALID_PARAMETER;
+            set_file_note((get_file_note() & ~(note_t)CODEC_NOTES_MASK) | ((note_t)codec << CODEC_NOTES_SHIFT));
             return OK;
         }
 
         /** \brief Получить количество знаков после запятой
+         * Количество знаков после запятой записывается в заметку файла при записи дней, поэтому метод работает за O(1).
+         * Для файлов старой версии знаки находятся по выборке дней в целых единицах цены и запоминаются до закрытия хранилища
+         * (записать их в файл можно методом rebuild_day_summaries)
          * \param decimal_places количество знаков после запятой (или множитель, если is_factor = true)
          * \param is_factor При установке данного флага функция возвращает множитель
          * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
          */
         int get_decimal_places(int &decimal_places, const bool &is_factor = false) {
-            if(decimal_places_ != 0) {
-                decimal_places = decimal_places_;
-                return OK;
-            }
-            ztime::timestamp_t min_timestamp = 0;
-            ztime::timestamp_t max_timestamp = 0;
-            int err = get_min_max_day_timestamp(min_timestamp, max_timestamp);
-            max_timestamp += ztime::SECONDS_IN_DAY;
-            if(err != OK) return err;
-
-            const size_t MAX_CANDLES = 10000;
-            ztime::timestamp_t step = (max_timestamp - min_timestamp) / MAX_CANDLES;
-            if(step < ztime::SECONDS_IN_MINUTE) step = ztime::SECONDS_IN_MINUTE;
-
-            std::vector<CANDLE_TYPE> candles;
-            CANDLE_TYPE old_candle;
-            for(ztime::timestamp_t t = min_timestamp; t < max_timestamp; t+= step) {
-                CANDLE_TYPE candle;
-                int err = get_candle(candle, t);
-                if( err == OK &&
-                    (candle.close != 0 || candle.open != 0 || candle.low != 0 || candle.high != 0) &&
-                    (old_candle.close != candle.close || old_candle.open != candle.open || old_candle.high != candle.high || old_candle.low != candle.low)) {
-                    candles.push_back(candle);
-                    old_candle = candle;
+            if(decimal_places_ == 0) {
+                if(get_num_subfiles() == 0) return DATA_NOT_AVAILABLE;
+                int found_decimal_places = get_note_decimal_places();
+                if(found_decimal_places < 0) {
+                    // файл старой версии, проверяем равномерную выборку дней
+                    const size_t MAX_DAYS = 64;
+                    const size_t num_days = get_num_subfiles();
+                    const size_t step = std::max((size_t)1, num_days / MAX_DAYS);
+                    const int user_read_columns_mask = read_columns_mask;
+                    read_columns_mask = (1 << CandleColumns::NUM_COLUMNS) - 1;
+                    std::unique_ptr<candles_array_t> candles(new candles_array_t());
+                    found_decimal_places = 0;
+                    bool is_found = false;
+                    for(size_t i = 0; i < num_days && found_decimal_places < MAX_DECIMAL_PLACES; i += step) {
+                        const key_t key = get_key_subfiles(i);
+                        if(read_candles_from_storage(*candles, key, (ztime::timestamp_t)key * ztime::SECONDS_IN_DAY) != OK) continue;
+                        found_decimal_places = std::max(found_decimal_places, find_decimal_places(*candles, PRICE_CLOSE));
+                        is_found = true;
+                    }
+                    read_columns_mask = user_read_columns_mask;
+                    if(!is_found) return DATA_NOT_AVAILABLE;
                 }
+                // как и xquotes_common::get_decimal_places, возвращаем не меньше одного знака
+                decimal_places_ = std::max(1, found_decimal_places);
+            }
+            decimal_places = decimal_places_;
+            if(is_factor) {
+                int factor = 1;
+                for(int n = 0; n < decimal_places_; ++n) factor *= 10;
+                decimal_places = factor;
             }
-            if(candles.size() == 0) return DATA_NOT_AVAILABLE;
-            decimal_places = xquotes_common::get_decimal_places(candles, is_factor);
-            decimal_places_ = decimal_places;
             return OK;
         }
     };
 
+    /// Хранилище котировок только с ценой закрытия
+    template <class CANDLE_TYPE = Candle>
+    using QuotesHistoryClose = QuotesHistory<CANDLE_TYPE, PRICE_CLOSE>;
+
+    /// Хранилище котировок со свечами без объема
+    template <class CANDLE_TYPE = Candle>
+    using QuotesHistoryOHLC = QuotesHistory<CANDLE_TYPE, PRICE_OHLC>;
+
+    /// Хранилище котировок со свечами с объемом
+    template <class CANDLE_TYPE = Candle>
+    using QuotesHistoryOHLCV = QuotesHistory<CANDLE_TYPE, PRICE_OHLCV>;
+
     /** \brief Класс для удобного использования исторических данных нескольких валютных пар
+     * Параметр шаблона PRICE_LAYOUT см. QuotesHistory
      */
-    template <class CANDLE_TYPE = Candle>
+    template <class CANDLE_TYPE = Candle, int PRICE_LAYOUT = PRICE_RUNTIME>
     class MultipleQuotesHistory {
     private:
 
-        std::vector<std::shared_ptr<QuotesHistory<CANDLE_TYPE>>> symbols; /**< Вектор с историческими данными цен */
+        std::vector<std::shared_ptr<QuotesHistory<CANDLE_TYPE, PRICE_LAYOUT>>> symbols; /**< Вектор с историческими данными цен */
         ztime::timestamp_t min_timestamp = 0;                                              /**< Временная метка начала исторических данных по всем валютным парам */
         ztime::timestamp_t max_timestamp = std::numeric_limits<ztime::timestamp_t>::max(); /**< Временная метка конца исторических данных по всем валютным парам */
         bool is_init = false;
+#       ifndef XQUOTES_DO_NOT_USE_THREAD
+        std::shared_ptr<xquotes_thread_pool::ThreadPool> thread_pool;  /**< Пул потоков для trade_multiple_threads и др., создается при первом вызове */
+        int num_days_in_task = 4;                                       /**< Количество дней символа в одной задаче пула */
+#       endif
+        std::vector<uint64_t> day_off_bitset;   /**< Битовая карта выходных дней начиная с ключа 0, дополняется по мере необходимости */
+        std::vector<uint64_t> days_bitset;      /**< Пересечение битовых карт дней символов */
 
         /** \brief Проверка выходного дня
          */
@@ -1180,6 +2628,89 @@ namespace xquotes_history {
             return ztime::is_day_off_for_day(key);
         }
 
+        /** \brief Дополнить битовую карту выходных дней
+         * \param num_words количество слов карты, которые должны быть заполнены
+         */
+        void update_day_off_bitset(const size_t num_words) {
+            const size_t first_word = day_off_bitset.size();
+            if(first_word >= num_words) return;
+            day_off_bitset.resize(num_words, 0);
+            for(size_t w = first_word; w < num_words; ++w) {
+                for(size_t b = 0; b < 64; ++b) {
+                    if(check_day_off((key_t)(w * 64 + b))) day_off_bitset[w] |= (uint64_t)1 << b;
+                }
+            }
+        }
+
+        static inline int count_bits(const uint64_t word) {
+#           if defined(__GNUC__)
+            return __builtin_popcountll(word);
+#           else
+            int num_bits = 0;
+            for(uint64_t bits = word; bits != 0; bits &= bits - 1) ++num_bits;
+            return num_bits;
+#           endif
+        }
+
+        static inline int find_lowest_bit(const uint64_t word) {
+#           if defined(__GNUC__)
+            return __builtin_ctzll(word);
+#           else
+            int ind = 0;
+            while(((word >> ind) & 1) == 0) ++ind;
+            return ind;
+#           endif
+        }
+
+        /** \brief Скопировать минуты дня символа в столбец матриц цен
+         * \param matrix матрицы цен
+         * \param view день символа
+         * \param symbol_ind индекс символа (столбец матриц)
+         * \param first_row строка матриц для первой минуты
+         * \param first_minute_day первая минута дня
+         * \param length количество минут
+         */
+        static void copy_day_to_matrix(
+                SymbolsMatrix &matrix,
+                const CandlesView &view,
+                const size_t symbol_ind,
+                const size_t first_row,
+                const size_t first_minute_day,
+                const size_t length) {
+            const Span<const double> view_fields[CandleColumns::NUM_COLUMNS] = {view.open, view.high, view.low, view.close, view.volume};
+            const size_t stride = matrix.get_stride();
+            for(int f = 0; f < CandleColumns::NUM_COLUMNS; ++f) {
+                double *dst = matrix.data(f) + first_row * stride + symbol_ind;
+                const double *src = view_fields[f].data() + first_minute_day;
+                for(size_t i = 0; i < length; ++i) {
+                    dst[i * stride] = src[i];
+                }
+            }
+        }
+
+        static void copy_day_to_matrix(
+                SymbolsMatrix &matrix,
+                const std::array<CANDLE_TYPE, MINUTES_IN_DAY> &candles,
+                const size_t symbol_ind,
+                const size_t first_row,
+                const size_t first_minute_day,
+                const size_t length) {
+            const size_t stride = matrix.get_stride();
+            double *open = matrix.data(CandleColumns::COLUMN_OPEN) + first_row * stride + symbol_ind;
+            double *high = matrix.data(CandleColumns::COLUMN_HIGH) + first_row * stride + symbol_ind;
+            double *low = matrix.data(CandleColumns::COLUMN_LOW) + first_row * stride + symbol_ind;
+            double *close = matrix.data(CandleColumns::COLUMN_CLOSE) + first_row * stride + symbol_ind;
+            double *volume = matrix.data(CandleColumns::COLUMN_VOLUME) + first_row * stride + symbol_ind;
+            for(size_t i = 0; i < length; ++i) {
+                const CANDLE_TYPE &candle = candles[first_minute_day + i];
+                open[i * stride] = candle.open;
+                high[i * stride] = candle.high;
+                low[i * stride] = candle.low;
+                close[i * stride] = candle.close;
+                volume[i * stride] = candle.volume;
+            }
+        }
+
     public:
         MultipleQuotesHistory() {};
 
@@ -1193,7 +2724,7 @@ namespace xquotes_history {
                 const int &price_type = PRICE_OHLC,
                 const int &option = USE_COMPRESSION) {
             for(size_t i = 0; i < paths.size(); ++i) {
-                symbols.push_back(std::make_shared<QuotesHistory<CANDLE_TYPE>>(paths[i], price_type, option));
+                symbols.push_back(std::make_shared<QuotesHistory<CANDLE_TYPE, PRICE_LAYOUT>>(paths[i], price_type, option));
             }
             for(size_t i = 0; i < paths.size(); ++i) {
                 ztime::timestamp_t symbol_min_timestamp = 0, symbol_max_timestamp = 0;
@@ -1217,7 +2748,7 @@ namespace xquotes_history {
          * \param symbol_ind Индекс символа
          * \return Вернет указатель на класс исторических данны или NULL в случае ошибки
          */
-        QuotesHistory<CANDLE_TYPE>* get_quotes_history(const size_t &symbol_ind) {
+        QuotesHistory<CANDLE_TYPE, PRICE_LAYOUT>* get_quotes_history(const size_t &symbol_ind) {
             if(symbol_ind < symbols.size()) return symbols[symbol_ind].get();
             return NULL;
         }
@@ -1252,6 +2783,46 @@ namespace xquotes_history {
             }
         }
 
+        /** \brief Включить режим отображения файлов в память для всех символов
+         * \details В данном режиме хранилища доступны только для чтения
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int enable_mmap() {
+            int err = OK;
+            for(size_t i = 0; i < symbols.size(); ++i) {
+                if(!symbols[i]->enable_mmap()) err = FILE_CANNOT_OPENED;
+            }
+            return err;
+        }
+
+        /** \brief Включить режим конкурентного чтения для всех символов
+         * \details В данном режиме хранилища доступны только для чтения,
+         * а дни одного символа можно читать из нескольких потоков методом read_day_candles_concurrent
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int enable_concurrent_read() {
+            int err = OK;
+            for(size_t i = 0; i < symbols.size(); ++i) {
+                if(!symbols[i]->enable_concurrent_read()) err = FILE_CANNOT_OPENED;
+            }
+            return err;
+        }
+
+#       ifndef XQUOTES_DO_NOT_USE_THREAD
+        /** \brief Включить фоновую предзагрузку дней для всех символов
+         * \details В данном режиме хранилища доступны только для чтения
+         * \param num_days количество дней, загружаемых наперед
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int enable_prefetch(const int num_days = 2) {
+            int err = OK;
+            for(size_t i = 0; i < symbols.size(); ++i) {
+                if(!symbols[i]->enable_prefetch(num_days)) err = FILE_CANNOT_OPENED;
+            }
+            return err;
+        }
+#       endif
+
         /** \brief Получить число символов в классе исторических данных
          * \return число символов, валютных пар, индексов и пр. вместе взятых
          */
@@ -1325,6 +2896,20 @@ namespace xquotes_history {
             return symbols[symbol_ind]->get_price(price, timestamp, price_type, optimization);
         }
 
+        /** \brief Получить итоги дня символа
+         * \param summary итоги дня
+         * \param timestamp метка времени дня
+         * \param symbol_ind номер символа
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int get_day_summary(
+                DaySummary &summary,
+                const ztime::timestamp_t &timestamp,
+                const int &symbol_ind) const {
+            if(symbol_ind >= (int)symbols.size()) return INVALID_PARAMETER;
+            return symbols[symbol_ind]->get_day_summary(summary, timestamp);
+        }
+
         /** \brief Получить свечи всех символов по метке времени
          * \param symbols_candle Свечи/бар всех символов
          * \param timestamp временная метка начала свечи
@@ -1373,6 +2958,107 @@ namespace xquotes_history {
             return err;
         }
 
+        /** \brief Получить цены всех символов за период в виде матриц [минуты x символы]
+         * \details Матрицы заполняются из дней символов целиком, а не вызовами get_candle для каждой минуты и символа.
+         * Если is_parallel равен true и в пуле потоков (см. set_thread_pool) больше одного потока,
+         * дни читаются методом read_day_candles_concurrent, а каждая задача пула заполняет строки одного дня
+         * для группы символов, занимающей целые выровненные блоки строк, поэтому потоки не пишут в одни и те же кэш-линии.
+         * Для этого у всех символов заранее должен быть включен режим конкурентного чтения (см. enable_concurrent_read),
+         * метод не переводит хранилища в режим только для чтения сам и вернет INVALID_PARAMETER.
+         * Иначе дни берутся из окна котировок каждого символа (см. QuotesHistory::get_day_view).
+         * Память матриц выделяется заново только при увеличении размера, поэтому matrix можно использовать повторно.
+         * Нулевая цена означает, что данных символа за минуту нет
+         * \param matrix матрицы цен
+         * \param timestamp_start метка времени первой минуты
+         * \param timestamp_stop метка времени последней минуты (включительно)
+         * \param is_parallel заполнять матрицы пулом потоков (нужен режим конкурентного чтения)
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int get_symbols_matrix(
+                SymbolsMatrix &matrix,
+                const ztime::timestamp_t &timestamp_start,
+                const ztime::timestamp_t &timestamp_stop,
+                const bool is_parallel = false) {
+            if(symbols.size() == 0) return DATA_NOT_AVAILABLE;
+            if(timestamp_stop < timestamp_start) return INVALID_PARAMETER;
+            const ztime::timestamp_t first_timestamp = timestamp_start - timestamp_start % ztime::SECONDS_IN_MINUTE;
+            const ztime::timestamp_t last_timestamp = timestamp_stop - timestamp_stop % ztime::SECONDS_IN_MINUTE;
+            const size_t num_minutes = (last_timestamp - first_timestamp) / ztime::SECONDS_IN_MINUTE + 1;
+            const size_t num_symbols = symbols.size();
+            matrix.resize(num_minutes, num_symbols);
+            matrix.set_timestamp(first_timestamp);
+
+            const ztime::timestamp_t first_day_timestamp = ztime::get_first_timestamp_day(first_timestamp);
+            const size_t num_days = (ztime::get_first_timestamp_day(last_timestamp) - first_day_timestamp) / ztime::SECONDS_IN_DAY + 1;
+            const size_t first_minute = ztime::get_minute_day(first_timestamp);
+            const size_t last_minute = ztime::get_minute_day(last_timestamp);
+            // первая минута дня, количество минут и первая строка матриц для дня
+            auto get_day_rows = [&](const size_t day, size_t &minute_day, size_t &length, size_t &row) {
+                minute_day = day == 0 ? first_minute : 0;
+                const size_t stop_minute_day = day == num_days - 1 ? last_minute + 1 : MINUTES_IN_DAY;
+                length = stop_minute_day - minute_day;
+                row = day == 0 ? 0 : day * MINUTES_IN_DAY - first_minute;
+            };
+
+#           ifndef XQUOTES_DO_NOT_USE_THREAD
+            if(is_parallel) {
+                if(!thread_pool) set_thread_pool();
+            }
+            if(is_parallel && thread_pool->get_num_threads() > 1) {
+                for(size_t s = 0; s < num_symbols; ++s) {
+                    if(!symbols[s]->is_concurrent_read()) return INVALID_PARAMETER;
+                }
+                xquotes_thread_pool::ThreadPool &pool = *thread_pool;
+                // группа символов занимает целое число блоков строки по SymbolsMatrix::ALIGNMENT байт
+                const size_t symbols_in_group = SymbolsMatrix::ALIGNMENT / sizeof(double);
+                const size_t num_groups = (num_symbols + symbols_in_group - 1) / symbols_in_group;
+                std::vector<std::array<CANDLE_TYPE, MINUTES_IN_DAY>> thread_candles(pool.get_num_threads());
+                pool.reset_stats();
+                for(size_t day = 0; day < num_days; ++day) {
+                    for(size_t group = 0; group < num_groups; ++group) {
+                        pool.add_task([&, day, group](const int thread_ind) {
+                            std::array<CANDLE_TYPE, MINUTES_IN_DAY> &candles = thread_candles[thread_ind];
+                            const ztime::timestamp_t day_timestamp = first_day_timestamp + day * ztime::SECONDS_IN_DAY;
+                            size_t minute_day = 0, length = 0, row = 0;
+                            get_day_rows(day, minute_day, length, row);
+                            const size_t stop_symbol = std::min((group + 1) * symbols_in_group, num_symbols);
+                            for(size_t s = group * symbols_in_group; s < stop_symbol; ++s) {
+                                if(symbols[s]->read_day_candles_concurrent(candles, day_timestamp) != OK) {
+                                    // дня нет, как и в окне котировок, цены дня будут нулевыми
+                                    for(int m = 0; m < MINUTES_IN_DAY; ++m) {
+                                        candles[m] = CANDLE_TYPE();
+                                    }
+                                }
+                                copy_day_to_matrix(matrix, candles, s, row, minute_day, length);
+                            }
+                        });
+                    }
+                }
+                pool.wait();
+                return OK;
+            }
+#           endif
+            // строки заполняются блоками минут, чтобы кэш-линии строк блока заполнялись всеми символами, пока они в кэше
+            const size_t minutes_in_block = 64;
+            std::vector<CandlesView> views(num_symbols);
+            for(size_t day = 0; day < num_days; ++day) {
+                const ztime::timestamp_t day_timestamp = first_day_timestamp + day * ztime::SECONDS_IN_DAY;
+                size_t minute_day = 0, length = 0, row = 0;
+                get_day_rows(day, minute_day, length, row);
+                for(size_t s = 0; s < num_symbols; ++s) {
+                    int err = symbols[s]->get_day_view(views[s], day_timestamp);
+                    if(err != OK) return err;
+                }
+                for(size_t i = 0; i < length; i += minutes_in_block) {
+                    const size_t block_length = std::min(minutes_in_block, length - i);
+                    for(size_t s = 0; s < num_symbols; ++s) {
+                        copy_day_to_matrix(matrix, views[s], s, row + i, minute_day + i, block_length);
+                    }
+                }
+            }
+            return OK;
+        }
+
         /** \brief Проверить бинарный опцион конкретного символа
          * Данный метод проверяет состояние бинарного опциона и может иметь три состояния (удачный прогноз, нейтральный и неудачный).
          * При поиске цены входа в опцион данный метод в первую очередь проверит последнюю полученную цену,
@@ -1397,6 +3083,24 @@ namespace xquotes_history {
             return symbols[symbol_ind]->check_binary_option(state, contract_type, duration_sec, timestamp, price_type, optimization);
         }
 
+        /** \brief Проверить пакет бинарных опционов конкретного символа
+         * Параметры см. QuotesHistory::check_binary_options
+         * \param symbol_ind индекс символа
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int check_binary_options(
+                std::vector<int> &states,
+                std::vector<int> &errors,
+                const std::vector<ztime::timestamp_t> &timestamps,
+                const std::vector<int> &durations_sec,
+                const std::vector<int> &contract_types,
+                const int &symbol_ind,
+                const int &price_type = PRICE_CLOSE,
+                const int &num_threads = 1) {
+            if(symbol_ind >= (int)symbols.size()) return INVALID_PARAMETER;
+            return symbols[symbol_ind]->check_binary_options(states, errors, timestamps, durations_sec, contract_types, price_type, num_threads);
+        }
+
         /** \brief Получить имя валютной пары по индексу символа
          * \param symbol_ind индекс символа
          * \return имя символа, если символ существует, иначе пустая строка
@@ -1416,10 +3120,13 @@ namespace xquotes_history {
         }
 
         /** \brief Получить список меток времени начала дня начиная с заданной метки вреемни поиска
+         * \details В список попадают только дни, которые есть у всех выбранных символов.
+         * Дни символов хранятся битовыми картами (см. Storage::get_subfiles_bitset), поэтому пересечение дней
+         * и фильтр выходных дней - это поразрядное И слов карт, а нужное количество дней отсчитывается по числу бит в словах
          * \warning метка времени start_timestamp (начало дня) входит в список list_timestamp!
          * \param list_timestamp список меток времени начала дня для всех дней, начиная с указанной метки времени
          * \param start_timestamp метка времени начала поиска дней для списка
-         * \param is_symbol
+         * \param is_symbol список флагов, выбирающих символы
          * \param num_days максимальное количество дней в списке
          * \param is_day_off_filter если true, идет пропуск выходных дней
          * \param is_go_back_in_time если true, от метки времени идет поиск в глубь истории
@@ -1434,30 +3141,81 @@ namespace xquotes_history {
                 const bool &is_go_back_in_time = true) {
             if(symbols.size() == 0) return DATA_NOT_AVAILABLE;
             if(is_symbol.size() != symbols.size()) return INVALID_PARAMETER;
-            std::vector<key_t> list_subfile;
-            std::vector<key_t> old_list_subfile;
-            int err = OK;
-            auto filter_day = is_day_off_filter ? check_day_off : NULL;
+            list_timestamp.clear();
+
+            // общий диапазон слов битовых карт выбранных символов
+            size_t first_word = 0, stop_word = std::numeric_limits<size_t>::max();
+            bool is_any_symbol = false;
             for(size_t i = 0; i < symbols.size(); ++i) {
                 if(!is_symbol[i]) continue;
-                err = symbols[i]->get_subfile_list(
-                    ztime::get_day(start_timestamp),
-                    list_subfile,
-                    num_days,
-                    filter_day,
-                    is_go_back_in_time);
-                // если спики стали отличаться или есть ошибка
-                if((i > 0 && old_list_subfile != list_subfile) || err != OK) {
-                    if(old_list_subfile != list_subfile) err = STRANGE_PROGRAM_BEHAVIOR;
-                    break;
+                key_t first_key = 0;
+                const std::vector<uint64_t> &bitset = symbols[i]->get_subfiles_bitset(first_key);
+                first_word = std::max(first_word, (size_t)first_key / 64);
+                stop_word = std::min(stop_word, (size_t)first_key / 64 + bitset.size());
+                is_any_symbol = true;
+            }
+            if(!is_any_symbol) return OK;
+            if(first_word >= stop_word) return DATA_NOT_AVAILABLE;
+
+            // пересечение дней символов без выходных дней
+            days_bitset.assign(stop_word - first_word, ~(uint64_t)0);
+            for(size_t i = 0; i < symbols.size(); ++i) {
+                if(!is_symbol[i]) continue;
+                key_t first_key = 0;
+                const std::vector<uint64_t> &bitset = symbols[i]->get_subfiles_bitset(first_key);
+                const uint64_t *words = bitset.data() + (first_word - first_key / 64);
+                for(size_t w = 0; w < days_bitset.size(); ++w) {
+                    days_bitset[w] &= words[w];
                 }
-                old_list_subfile = list_subfile;
             }
-            if(err != OK) return err;
-            list_timestamp.clear();
-            for(size_t i = 0; i < list_subfile.size(); ++i) {
-                list_timestamp.push_back(list_subfile[i] * ztime::SECONDS_IN_DAY);
+            if(is_day_off_filter) {
+                update_day_off_bitset(stop_word);
+                for(size_t w = 0; w < days_bitset.size(); ++w) {
+                    days_bitset[w] &= ~day_off_bitset[first_word + w];
+                }
+            }
+
+            const key_t start_key = ztime::get_day(start_timestamp);
+            const size_t start_word = start_key / 64;
+            const size_t start_bit = start_key % 64;
+            auto add_days = [&](const size_t word, uint64_t bits) {
+                while(bits != 0 && (int)list_timestamp.size() < num_days) {
+                    const size_t key = word * 64 + find_lowest_bit(bits);
+                    list_timestamp.push_back((ztime::timestamp_t)key * ztime::SECONDS_IN_DAY);
+                    bits &= bits - 1;
+                }
+            };
+            if(is_go_back_in_time) {
+                if(start_word < first_word) return DATA_NOT_AVAILABLE;
+                const size_t last_word = std::min(start_word, stop_word - 1);
+                const uint64_t last_mask = last_word == start_word && start_bit != 63 ?
+                    ((uint64_t)1 << (start_bit + 1)) - 1 : ~(uint64_t)0;
+                // идем к началу истории, пока в словах не наберется num_days дней
+                size_t num_found = 0, word = last_word;
+                for(size_t w = last_word + 1; w-- > first_word;) {
+                    uint64_t bits = days_bitset[w - first_word];
+                    if(w == last_word) bits &= last_mask;
+                    num_found += count_bits(bits);
+                    word = w;
+                    if((int)num_found >= num_days) break;
+                }
+                // в первом слове лишние дни - самые ранние
+                size_t num_skip = (int)num_found > num_days ? num_found - std::max(num_days, 0) : 0;
+                for(size_t w = word; w <= last_word; ++w) {
+                    uint64_t bits = days_bitset[w - first_word];
+                    if(w == last_word) bits &= last_mask;
+                    for(; num_skip > 0 && bits != 0; --num_skip) bits &= bits - 1;
+                    add_days(w, bits);
+                }
+            } else {
+                if(start_word >= stop_word) return DATA_NOT_AVAILABLE;
+                for(size_t w = std::max(start_word, first_word); w < stop_word && (int)list_timestamp.size() < num_days; ++w) {
+                    uint64_t bits = days_bitset[w - first_word];
+                    if(w == start_word) bits &= ~(uint64_t)0 << start_bit;
+                    add_days(w, bits);
+                }
             }
+            if(list_timestamp.size() == 0 && num_days > 0) return DATA_NOT_AVAILABLE;
             return OK;
         }
 
@@ -1483,21 +3241,20 @@ namespace xquotes_history {
          * \param step_timestamp шаг метки времени (для минутного таймфрейма ztime::SECONDS_IN_MINUTE)
          * \param num_days количество дней для торговли
          * \param is_symbol список флагов, разрешающих торговлю на конкретном символе
-         * \param f лямбда-функция для обработки торговли
+         * \param f функция для обработки торговли вида
+         * void(const CANDLE_TYPE &candle, const int day, const int symbol_ind, const int err),
+         * передается как параметр шаблона (лямбда-функция, функтор или std::function)
          * \param is_day_off_filter если true, используется фильтр торговли в выходные дни
          * \param is_go_back_in_time проход поиска дней торговли совершается вглубь истории, если true
          * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
          */
+        template<class FUNC>
         int trade(
                 const ztime::timestamp_t &start_timestamp,
                 const int &step_timestamp,
                 const int &num_days,
                 const std::vector<bool> &is_symbol,
-                std::function<void(
-                    const CANDLE_TYPE &candle,
-                    const int day,
-                    const int symbol_ind,
-                    const int err)> f,
+                FUNC f,
                 const bool &is_day_off_filter = true,
                 const bool &is_go_back_in_time = true) {
             if(is_symbol.size() != symbols.size()) return INVALID_PARAMETER;
@@ -1526,30 +3283,80 @@ namespace xquotes_history {
             return OK;
         }
 
+        /** \brief Торговать по дням
+         * \details Для каждого дня функция f вызывается для каждого выбранного символа
+         * и получает весь день символа в виде столбцов (см. QuotesHistory::get_day_view).
+         * Нулевая цена означает, что данных за минуту нет
+         * \warning метка времени start_timestamp (весь день) входит в диапазон торговли!
+         * Представление дня действительно только во время вызова f
+         * \param start_timestamp метка времени поиска начала торговли
+         * (начиная с дня метки времени будет запущена торговля)
+         * \param num_days количество дней для торговли
+         * \param is_symbol список флагов, разрешающих торговлю на конкретном символе
+         * \param f функция для обработки дня вида
+         * void(const CandlesView &view, const int day, const int symbol_ind, const int err),
+         * передается как параметр шаблона (лямбда-функция, функтор или std::function)
+         * \param is_day_off_filter если true, используется фильтр торговли в выходные дни
+         * \param is_go_back_in_time проход поиска дней торговли совершается вглубь истории, если true
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        template<class FUNC>
+        int trade_day_views(
+                const ztime::timestamp_t &start_timestamp,
+                const int &num_days,
+                const std::vector<bool> &is_symbol,
+                FUNC f,
+                const bool &is_day_off_filter = true,
+                const bool &is_go_back_in_time = true) {
+            if(is_symbol.size() != symbols.size()) return INVALID_PARAMETER;
+            std::vector<ztime::timestamp_t> list_timestamp;
+            int err = get_day_timestamp_list(
+                list_timestamp,
+                start_timestamp,
+                is_symbol,
+                num_days,
+                is_day_off_filter,
+                is_go_back_in_time);
+
+            if(err != OK || (int)list_timestamp.size() != num_days) return DATA_NOT_AVAILABLE;
+            const int num_symbols = symbols.size();
+            for(int i = 0; i < num_days; ++i) {
+                for(int s = 0; s < num_symbols; ++s) {
+                    if(!is_symbol[s]) continue;
+                    CandlesView view;
+                    int err = symbols[s]->get_day_view(view, list_timestamp[i]);
+                    f(view, i, s, err);
+                } // for s
+            } // for i
+            return OK;
+        }
+
 #       ifndef XQUOTES_DO_NOT_USE_THREAD
         /** \brief Торговать в несколько потоков
+         * \details Торговля выполняется пулом потоков (см. set_thread_pool). Дни каждого символа обрабатываются по порядку
+         * и не более чем одним потоком одновременно, но разные символы обрабатываются независимо,
+         * поэтому порядок вызова f для разных символов не определен. Номер потока thread_ind меньше количества потоков пула
+         * (по умолчанию количество ядер процессора)
          * \warning метка времени start_timestamp (весь день) входит в диапазон торговли!
          * \param start_timestamp метка времени поиска начала торговли
          * (начиная с дня метки времени будет запущена торговля)
          * \param step_timestamp шаг метки времени (для минутного таймфрейма ztime::SECONDS_IN_MINUTE)
          * \param num_days количество дней для торговли
          * \param is_symbol список флагов, разрешающих торговлю на конкретном символе
-         * \param f лямбда-функция для обработки торговли
+         * \param f функция для обработки торговли вида
+         * void(const CANDLE_TYPE &candle, const int day, const int symbol_ind, const int thread_ind, const int err),
+         * передается как параметр шаблона (лямбда-функция, функтор или std::function)
          * \param is_day_off_filter если true, используется фильтр торговли в выходные дни
          * \param is_go_back_in_time проход поиска дней торговли совершается вглубь истории, если true
          * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
          */
+        template<class FUNC>
         int trade_multiple_threads(
                 const ztime::timestamp_t &start_timestamp,
                 const int &step_timestamp,
                 const int &num_days,
                 const std::vector<bool> &is_symbol,
-                std::function<void(
-                    const CANDLE_TYPE &candle,
-                    const int day,
-                    const int symbol_ind,
-                    const int thread_ind,
-                    const int err)> f,
+                FUNC f,
                 const bool &is_day_off_filter = true,
                 const bool &is_go_back_in_time = true) {
             if(is_symbol.size() != symbols.size()) return INVALID_PARAMETER;
@@ -1573,29 +3380,165 @@ namespace xquotes_history {
             }
             const int num_list_symbol = list_symbol_ind.size();
 
-            // получаем максимальное количество потоков процессора и создаем массив потоков
-            const int num_hardware_thread = std::thread::hardware_concurrency();
-            const int num_thread = std::min((int)list_symbol_ind.size(),num_hardware_thread);
-            std::vector<std::thread> list_thread;
-            list_thread.resize(num_thread);
-
-            for(int thread_ind = 0; thread_ind < num_thread; ++thread_ind) {
-                list_thread[thread_ind] = std::thread([&, thread_ind, num_thread]() {
-                    for(int i = 0; i < num_days; ++i) {
+            /* задача пула - num_days_in_task дней одного символа. Следующая задача символа добавляется
+             * в конце предыдущей, поэтому символ никогда не обрабатывается двумя потоками сразу,
+             * а дни символа идут по порядку. Свободные потоки забирают задачи у занятых
+             */
+            if(!thread_pool) set_thread_pool();
+            xquotes_thread_pool::ThreadPool &pool = *thread_pool;
+            const int days_in_task = num_days_in_task;
+            pool.reset_stats();
+            std::function<void(const int, const int)> add_symbol_task;
+            add_symbol_task = [&](const int symbol_ind, const int first_day) {
+                pool.add_task([&, symbol_ind, first_day](const int thread_ind) {
+                    const int last_day = std::min(first_day + days_in_task, num_days);
+                    for(int i = first_day; i < last_day; ++i) {
                         ztime::timestamp_t stop_timestamp = list_timestamp[i] + ztime::SECONDS_IN_DAY;
                         for(ztime::timestamp_t t = list_timestamp[i]; t < stop_timestamp; t += step_timestamp) {
-                            for(int s = thread_ind; s < num_list_symbol; s += num_thread) {
-                                int symbol_ind = list_symbol_ind[s];
-                                CANDLE_TYPE candle;
-                                int err = get_candle(candle, t, symbol_ind);
-                                f(candle, i, symbol_ind, thread_ind, err);
+                            CANDLE_TYPE candle;
+                            int err = get_candle(candle, t, symbol_ind);
+                            f(candle, i, symbol_ind, thread_ind, err);
+                        } // for t
+                    } // for i
+                    if(last_day < num_days) add_symbol_task(symbol_ind, last_day);
+                });
+            };
+            for(int s = 0; s < num_list_symbol; ++s) {
+                add_symbol_task(list_symbol_ind[s], 0);
+            }
+            pool.wait();
+            return OK;
+        }
+
+        /** \brief Настроить пул потоков для trade_multiple_threads
+         * \details Пул создается один раз и используется всеми вызовами trade_multiple_threads.
+         * Если метод не вызывать, пул с настройками по умолчанию создается при первом вызове trade_multiple_threads
+         * \param num_threads количество потоков, если 0 - по количеству ядер процессора
+         * \param num_days_in_task количество дней одного символа в задаче пула
+         * \param is_pin_threads закрепить потоки за ядрами процессора (только Linux)
+         */
+        void set_thread_pool(const int num_threads = 0, const int num_days_in_task = 4, const bool is_pin_threads = false) {
+            thread_pool.reset();
+            thread_pool = std::make_shared<xquotes_thread_pool::ThreadPool>(num_threads, is_pin_threads);
+            MultipleQuotesHistory::num_days_in_task = std::max(num_days_in_task, 1);
+        }
+
+        /** \brief Получить статистику потоков последнего вызова trade_multiple_threads
+         * \param stats статистика каждого потока (время работы, загрузка, количество задач и задач, взятых у других потоков)
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int get_thread_stats(std::vector<xquotes_thread_pool::ThreadStats> &stats) const {
+            if(!thread_pool) return DATA_NOT_AVAILABLE;
+            thread_pool->get_stats(stats);
+            return OK;
+        }
+
+        /** \brief Торговать, распределив дни по потокам
+         * \details Список дней торговли делится на диапазоны по num_days_in_range дней, диапазоны обрабатываются
+         * пулом потоков (см. set_thread_pool) независимо друг от друга, поэтому торговлю даже по одному символу
+         * можно распределить по всем ядрам. Задача читает дни символов методом read_day_candles_concurrent
+         * в буфер своего потока и не использует окно котировок, которое заполняет get_candle.
+         * Для каждого диапазона создается свой результат, f вызывается для свечей диапазона
+         * в том же порядке, что и в методе trade. Когда все диапазоны обработаны, merge вызывается
+         * в потоке вызова метода для результатов диапазонов в порядке дней, поэтому итог не зависит от количества потоков.
+         * У выбранных символов заранее должен быть включен режим конкурентного чтения (см. enable_concurrent_read),
+         * метод не переводит хранилища в режим только для чтения сам и вернет INVALID_PARAMETER
+         * \warning метка времени start_timestamp (весь день) входит в диапазон торговли!
+         * \param start_timestamp метка времени поиска начала торговли
+         * (начиная с дня метки времени будет запущена торговля)
+         * \param step_timestamp шаг метки времени (для минутного таймфрейма ztime::SECONDS_IN_MINUTE)
+         * \param num_days количество дней для торговли
+         * \param is_symbol список флагов, разрешающих торговлю на конкретном символе
+         * \param f функция для обработки торговли вида
+         * void(RESULT_TYPE &result, const CANDLE_TYPE &candle, const int day, const int symbol_ind, const int err),
+         * в нее передается результат диапазона дней
+         * \param merge функция для объединения результатов вида
+         * void(const RESULT_TYPE &result, const int first_day, const int last_day),
+         * в нее передается результат диапазона и номера первого и следующего за последним дней диапазона
+         * \param num_days_in_range количество дней в диапазоне, если 0 - подбирается по количеству потоков пула
+         * \param is_day_off_filter если true, используется фильтр торговли в выходные дни
+         * \param is_go_back_in_time проход поиска дней торговли совершается вглубь истории, если true
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        template<class RESULT_TYPE, class FUNC, class MERGE_FUNC>
+        int trade_day_ranges(
+                const ztime::timestamp_t &start_timestamp,
+                const int &step_timestamp,
+                const int &num_days,
+                const std::vector<bool> &is_symbol,
+                FUNC f,
+                MERGE_FUNC merge,
+                const int num_days_in_range = 0,
+                const bool &is_day_off_filter = true,
+                const bool &is_go_back_in_time = true) {
+            if(is_symbol.size() != symbols.size() || step_timestamp <= 0) return INVALID_PARAMETER;
+            std::vector<ztime::timestamp_t> list_timestamp;
+            int err = get_day_timestamp_list(
+                list_timestamp,
+                start_timestamp,
+                is_symbol,
+                num_days,
+                is_day_off_filter,
+                is_go_back_in_time);
+
+            if(err != OK || (int)list_timestamp.size() != num_days) return DATA_NOT_AVAILABLE;
+
+            const int num_symbols = symbols.size();
+            std::vector<int> list_symbol_ind;
+            for(int s = 0; s < num_symbols; ++s) {
+                if(!is_symbol[s]) continue;
+                if(!symbols[s]->is_concurrent_read()) return INVALID_PARAMETER;
+                list_symbol_ind.push_back(s);
+            }
+            const int num_list_symbol = list_symbol_ind.size();
+
+            if(!thread_pool) set_thread_pool();
+            xquotes_thread_pool::ThreadPool &pool = *thread_pool;
+            const int num_threads = pool.get_num_threads();
+            // по умолчанию на поток приходится несколько диапазонов, чтобы свободные потоки могли забрать работу у занятых
+            const int days_in_range = num_days_in_range > 0 ? num_days_in_range :
+                std::max((num_days + num_threads * 4 - 1) / (num_threads * 4), 1);
+            const int num_ranges = (num_days + days_in_range - 1) / days_in_range;
+            std::vector<RESULT_TYPE> results(num_ranges);
+
+            // дни символов, загруженные потоком
+            typedef std::array<CANDLE_TYPE, MINUTES_IN_DAY> candles_day_t;
+            std::vector<std::vector<candles_day_t>> thread_days(num_threads);
+
+            pool.reset_stats();
+            for(int r = 0; r < num_ranges; ++r) {
+                pool.add_task([&, r](const int thread_ind) {
+                    std::vector<candles_day_t> &days = thread_days[thread_ind];
+                    if((int)days.size() != num_list_symbol) days.resize(num_list_symbol);
+                    RESULT_TYPE &result = results[r];
+                    const int first_day = r * days_in_range;
+                    const int last_day = std::min(first_day + days_in_range, num_days);
+                    for(int i = first_day; i < last_day; ++i) {
+                        const ztime::timestamp_t day_timestamp = list_timestamp[i];
+                        for(int s = 0; s < num_list_symbol; ++s) {
+                            if(symbols[list_symbol_ind[s]]->read_day_candles_concurrent(days[s], day_timestamp) == OK) continue;
+                            // дня нет, как и в окне котировок, свечи дня будут пустыми
+                            for(int m = 0; m < MINUTES_IN_DAY; ++m) {
+                                days[s][m] = CANDLE_TYPE();
+                                days[s][m].timestamp = day_timestamp + m * ztime::SECONDS_IN_MINUTE;
+                            }
+                        }
+                        const ztime::timestamp_t stop_timestamp = day_timestamp + ztime::SECONDS_IN_DAY;
+                        for(ztime::timestamp_t t = day_timestamp; t < stop_timestamp; t += step_timestamp) {
+                            const int minute_day = ztime::get_minute_day(t);
+                            for(int s = 0; s < num_list_symbol; ++s) {
+                                const CANDLE_TYPE &candle = days[s][minute_day];
+                                f(result, candle, i, list_symbol_ind[s], candle.close != 0.0 ? OK : DATA_NOT_AVAILABLE);
                             } // for s
                         } // for t
                     } // for i
-                }); // std::thread
-            } // for thread_ind
-            for(size_t i = 0; i < list_thread.size(); ++i) {
-                list_thread[i].join();
+                });
+            }
+            pool.wait();
+
+            for(int r = 0; r < num_ranges; ++r) {
+                const int first_day = r * days_in_range;
+                merge(results[r], first_day, std::min(first_day + days_in_range, num_days));
             }
             return OK;
         }
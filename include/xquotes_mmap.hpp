@@ -0,0 +1,167 @@
+/*
+* xquotes_history - C++ header-only library for working with historical quotes data
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+/** \file Файл с классом для отображения файла в память
+ * \brief Данный файл содержит класс MemoryMappedFile
+ *
+ * Класс MemoryMappedFile отображает файл в память только для чтения.
+ * Используется классом Storage для чтения подфайлов без промежуточного копирования
+ */
+#ifndef XQUOTES_MMAP_HPP_INCLUDED
+#define XQUOTES_MMAP_HPP_INCLUDED
+
+#include <string>
+#include <cstddef>
+
+#if defined(_WIN32) || defined(_WIN64)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace xquotes_mmap {
+
+    /** \brief Класс файла, отображенного в память (только для чтения)
+     */
+    class MemoryMappedFile {
+    private:
+        const char *mapped_data = NULL;     /**< Указатель на начало отображения */
+        size_t mapped_size = 0;             /**< Размер отображения */
+#       if defined(_WIN32) || defined(_WIN64)
+        HANDLE file_handle = INVALID_HANDLE_VALUE;
+        HANDLE mapping_handle = NULL;
+#       else
+        int file_descriptor = -1;
+#       endif
+
+    public:
+
+        MemoryMappedFile() {};
+
+        MemoryMappedFile(const MemoryMappedFile&) = delete;
+        MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+        /** \brief Отобразить файл в память
+         * \param path путь к файлу
+         * \return вернет true в случае успеха
+         */
+        bool open(const std::string &path) {
+            close();
+#           if defined(_WIN32) || defined(_WIN64)
+            file_handle = CreateFileA(
+                path.c_str(),
+                GENERIC_READ,
+                FILE_SHARE_READ | FILE_SHARE_WRITE,
+                NULL,
+                OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS,
+                NULL);
+            if(file_handle == INVALID_HANDLE_VALUE) return false;
+            LARGE_INTEGER file_size;
+            if(!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0) {
+                close();
+                return false;
+            }
+            mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+            if(mapping_handle == NULL) {
+                close();
+                return false;
+            }
+            mapped_data = (const char*)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+            if(mapped_data == NULL) {
+                close();
+                return false;
+            }
+            mapped_size = (size_t)file_size.QuadPart;
+#           else
+            file_descriptor = ::open(path.c_str(), O_RDONLY);
+            if(file_descriptor < 0) return false;
+            struct stat file_stat;
+            if(fstat(file_descriptor, &file_stat) != 0 || file_stat.st_size == 0) {
+                close();
+                return false;
+            }
+            void *data = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+            if(data == MAP_FAILED) {
+                close();
+                return false;
+            }
+            mapped_data = (const char*)data;
+            mapped_size = (size_t)file_stat.st_size;
+#           endif
+            return true;
+        }
+
+        /** \brief Закрыть отображение файла
+         */
+        void close() {
+#           if defined(_WIN32) || defined(_WIN64)
+            if(mapped_data != NULL) UnmapViewOfFile(mapped_data);
+            if(mapping_handle != NULL) CloseHandle(mapping_handle);
+            if(file_handle != INVALID_HANDLE_VALUE) CloseHandle(file_handle);
+            mapping_handle = NULL;
+            file_handle = INVALID_HANDLE_VALUE;
+#           else
+            if(mapped_data != NULL) munmap((void*)mapped_data, mapped_size);
+            if(file_descriptor >= 0) ::close(file_descriptor);
+            file_descriptor = -1;
+#           endif
+            mapped_data = NULL;
+            mapped_size = 0;
+        }
+
+        /** \brief Проверить, отображен ли файл в память
+         * \return вернет true, если файл отображен
+         */
+        inline bool is_open() const {
+            return mapped_data != NULL;
+        }
+
+        /** \brief Получить указатель на данные файла
+         * \return указатель на начало отображения
+         */
+        inline const char *data() const {
+            return mapped_data;
+        }
+
+        /** \brief Получить размер отображения
+         * \return размер файла в байтах
+         */
+        inline size_t size() const {
+            return mapped_size;
+        }
+
+        ~MemoryMappedFile() {
+            close();
+        }
+    };
+}
+
+#endif // XQUOTES_MMAP_HPP_INCLUDED
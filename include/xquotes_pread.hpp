@@ -0,0 +1,150 @@
+/*
+* xquotes_history - C++ header-only library for working with historical quotes data
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+/** \file Файл с классом для позиционного чтения файла
+ * \brief Данный файл содержит класс PositionalReadFile
+ *
+ * Класс PositionalReadFile читает данные по смещению без общего указателя позиции файла,
+ * поэтому один открытый файл можно читать из нескольких потоков одновременно.
+ * Используется классом Storage в режиме конкурентного чтения
+ */
+#ifndef XQUOTES_PREAD_HPP_INCLUDED
+#define XQUOTES_PREAD_HPP_INCLUDED
+
+#include <string>
+#include <cstddef>
+#include <algorithm>
+
+#if defined(_WIN32) || defined(_WIN64)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace xquotes_pread {
+
+    /** \brief Класс файла для позиционного чтения (только для чтения)
+     */
+    class PositionalReadFile {
+    private:
+#       if defined(_WIN32) || defined(_WIN64)
+        HANDLE file_handle = INVALID_HANDLE_VALUE;
+#       else
+        int file_descriptor = -1;
+#       endif
+
+    public:
+
+        PositionalReadFile() {};
+
+        PositionalReadFile(const PositionalReadFile&) = delete;
+        PositionalReadFile& operator=(const PositionalReadFile&) = delete;
+
+        /** \brief Открыть файл
+         * \param path путь к файлу
+         * \return вернет true в случае успеха
+         */
+        bool open(const std::string &path) {
+            close();
+#           if defined(_WIN32) || defined(_WIN64)
+            file_handle = CreateFileA(
+                path.c_str(),
+                GENERIC_READ,
+                FILE_SHARE_READ | FILE_SHARE_WRITE,
+                NULL,
+                OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS,
+                NULL);
+            return file_handle != INVALID_HANDLE_VALUE;
+#           else
+            file_descriptor = ::open(path.c_str(), O_RDONLY);
+            return file_descriptor >= 0;
+#           endif
+        }
+
+        /** \brief Закрыть файл
+         */
+        void close() {
+#           if defined(_WIN32) || defined(_WIN64)
+            if(file_handle != INVALID_HANDLE_VALUE) CloseHandle(file_handle);
+            file_handle = INVALID_HANDLE_VALUE;
+#           else
+            if(file_descriptor >= 0) ::close(file_descriptor);
+            file_descriptor = -1;
+#           endif
+        }
+
+        /** \brief Проверить, открыт ли файл
+         * \return вернет true, если файл открыт
+         */
+        inline bool is_open() const {
+#           if defined(_WIN32) || defined(_WIN64)
+            return file_handle != INVALID_HANDLE_VALUE;
+#           else
+            return file_descriptor >= 0;
+#           endif
+        }
+
+        /** \brief Прочитать данные по смещению
+         * \details Метод можно вызывать из нескольких потоков одновременно
+         * \param offset смещение в файле
+         * \param buffer буфер для данных
+         * \param size количество байт
+         * \return вернет true, если прочитано ровно size байт
+         */
+        bool read(const unsigned long long offset, char *buffer, const size_t size) const {
+            size_t bytes_read = 0;
+            while(bytes_read < size) {
+                const unsigned long long position = offset + bytes_read;
+#               if defined(_WIN32) || defined(_WIN64)
+                OVERLAPPED overlapped = {};
+                overlapped.Offset = (DWORD)(position & 0xFFFFFFFFULL);
+                overlapped.OffsetHigh = (DWORD)(position >> 32);
+                DWORD bytes = 0;
+                const DWORD bytes_to_read = (DWORD)std::min<size_t>(size - bytes_read, 0x40000000);
+                if(!ReadFile(file_handle, buffer + bytes_read, bytes_to_read, &bytes, &overlapped) || bytes == 0) return false;
+#               else
+                const ssize_t bytes = ::pread(file_descriptor, buffer + bytes_read, size - bytes_read, (off_t)position);
+                // чтение, прерванное сигналом, повторяем
+                if(bytes < 0 && errno == EINTR) continue;
+                if(bytes <= 0) return false;
+#               endif
+                bytes_read += (size_t)bytes;
+            }
+            return true;
+        }
+
+        ~PositionalReadFile() {
+            close();
+        }
+    };
+}
+
+#endif // XQUOTES_PREAD_HPP_INCLUDED
@@ -0,0 +1,200 @@
+/*
+* xquotes_history - C++ header-only library for working with historical quotes data
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+/** \file Файл с классом фоновой предзагрузки дней котировок
+ * \brief Данный файл содержит класс DayPrefetcher
+ *
+ * Класс DayPrefetcher в отдельном потоке распаковывает дни котировок, которые скоро понадобятся.
+ * Направление чтения (в будущее или вглубь истории) определяется по последовательности запрошенных дней.
+ * Используется классом QuotesHistory, чтобы убрать задержку при переходе через границу дня
+ */
+#ifndef XQUOTES_PREFETCH_HPP_INCLUDED
+#define XQUOTES_PREFETCH_HPP_INCLUDED
+
+#include "xquotes_common.hpp"
+#include <array>
+#include <map>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <limits>
+#include <algorithm>
+
+namespace xquotes_prefetch {
+    using namespace xquotes_common;
+
+    /** \brief Класс фоновой предзагрузки дней котировок
+     * \details Функция загрузки дня вызывается из фонового потока, поэтому она должна быть потокобезопасной
+     */
+    template <class CANDLE_TYPE = Candle>
+    class DayPrefetcher {
+    public:
+        typedef std::array<CANDLE_TYPE, MINUTES_IN_DAY> candles_array_t;
+        typedef std::function<int(candles_array_t &candles, const key_t day)> load_day_t;
+
+    private:
+        load_day_t load_day;                    /**< Функция загрузки дня */
+        int num_days = 0;                       /**< Количество дней, загружаемых наперед */
+        std::map<key_t, std::unique_ptr<candles_array_t>> ready_days; /**< Загруженные дни, пустой указатель означает отсутствие дня */
+
+        key_t last_day = 0;                     /**< Последний запрошенный день */
+        int direction = 1;                      /**< Направление чтения: 1 - в будущее, -1 - вглубь истории */
+        bool is_last_day = false;               /**< Флаг наличия запрошенного дня */
+        unsigned long long request_id = 0;      /**< Номер последнего запроса */
+        unsigned long long hits = 0;            /**< Количество дней, выданных из предзагрузки */
+        unsigned long long misses = 0;          /**< Количество дней, которые не успели загрузить */
+        bool is_stop = false;
+
+        std::mutex prefetch_mutex;
+        std::condition_variable prefetch_condition;
+        std::thread prefetch_thread;
+
+        /** \brief Проверить, нужен ли день для текущего запроса
+         */
+        inline bool check_day(const key_t day, const key_t center_day) const {
+            const int offset = ((int)day - (int)center_day) * direction;
+            return offset >= -num_days && offset <= num_days;
+        }
+
+        void run() {
+            std::unique_lock<std::mutex> lock(prefetch_mutex);
+            unsigned long long processed_request_id = 0;
+            while(true) {
+                prefetch_condition.wait(lock, [&]() {
+                    return is_stop || request_id != processed_request_id;
+                });
+                if(is_stop) return;
+                processed_request_id = request_id;
+                const key_t center_day = last_day;
+
+                // удаляем дни, которые больше не нужны
+                auto it = ready_days.begin();
+                while(it != ready_days.end()) {
+                    if(!check_day(it->first, center_day)) it = ready_days.erase(it);
+                    else ++it;
+                }
+
+                // загружаем дни по направлению чтения
+                for(int i = 1; i <= num_days; ++i) {
+                    if(is_stop || request_id != processed_request_id) break;
+                    const int day = (int)center_day + i * direction;
+                    if(day < 0 || day > (int)std::numeric_limits<key_t>::max()) break;
+                    if(ready_days.find((key_t)day) != ready_days.end()) continue;
+                    lock.unlock();
+                    std::unique_ptr<candles_array_t> candles(new candles_array_t());
+                    const int err = load_day(*candles, (key_t)day);
+                    lock.lock();
+                    if(err != OK) candles.reset();
+                    ready_days[(key_t)day] = std::move(candles);
+                }
+            }
+        }
+
+    public:
+
+        /** \brief Инициализировать предзагрузку
+         * \param load_day потокобезопасная функция загрузки дня
+         * \param num_days количество дней, загружаемых наперед
+         */
+        DayPrefetcher(const load_day_t &load_day, const int num_days) :
+            load_day(load_day), num_days(std::max(num_days, 1)) {
+            prefetch_thread = std::thread([this]() {
+                run();
+            });
+        }
+
+        DayPrefetcher(const DayPrefetcher&) = delete;
+        DayPrefetcher& operator=(const DayPrefetcher&) = delete;
+
+        /** \brief Сообщить о запросе дня
+         * \details По последовательности запросов определяется направление чтения,
+         * после чего фоновый поток начинает загружать следующие дни
+         * \param day запрошенный день
+         */
+        void request(const key_t day) {
+            std::lock_guard<std::mutex> lock(prefetch_mutex);
+            if(is_last_day && day == last_day) return;
+            if(is_last_day) direction = day > last_day ? 1 : -1;
+            last_day = day;
+            is_last_day = true;
+            ++request_id;
+            prefetch_condition.notify_one();
+        }
+
+        /** \brief Забрать загруженный день
+         * \param day день
+         * \param candles массив свечей за день
+         * \return вернет true, если день был загружен заранее
+         */
+        bool take(const key_t day, candles_array_t &candles) {
+            std::lock_guard<std::mutex> lock(prefetch_mutex);
+            auto it = ready_days.find(day);
+            if(it == ready_days.end() || !it->second) {
+                if(it == ready_days.end()) ++misses;
+                return false;
+            }
+            candles = *(it->second);
+            ready_days.erase(it);
+            ++hits;
+            return true;
+        }
+
+        /** \brief Удалить загруженные дни
+         */
+        void clear() {
+            std::lock_guard<std::mutex> lock(prefetch_mutex);
+            ready_days.clear();
+        }
+
+        /** \brief Получить количество дней, выданных из предзагрузки
+         * \return количество дней
+         */
+        unsigned long long get_hits() {
+            std::lock_guard<std::mutex> lock(prefetch_mutex);
+            return hits;
+        }
+
+        /** \brief Получить количество дней, которые не успели загрузить
+         * \return количество дней
+         */
+        unsigned long long get_misses() {
+            std::lock_guard<std::mutex> lock(prefetch_mutex);
+            return misses;
+        }
+
+        ~DayPrefetcher() {
+            {
+                std::lock_guard<std::mutex> lock(prefetch_mutex);
+                is_stop = true;
+            }
+            prefetch_condition.notify_one();
+            if(prefetch_thread.joinable()) prefetch_thread.join();
+        }
+    };
+}
+
+#endif // XQUOTES_PREFETCH_HPP_INCLUDED
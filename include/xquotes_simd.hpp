@@ -0,0 +1,526 @@
+/*
+* xquotes_history - C++ header-only library for working with historical quotes data
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+/** \file Файл с векторизованными функциями конвертации цен
+ * \brief Данный файл содержит функции конвертации цен price_t в double и обратно,
+ * а также выборку цен по индексам минут (gather_doubles)
+ *
+ * Функции используются классом QuotesHistory при чтении и записи дней котировок.
+ * Есть три реализации: скалярная, SSE4.1 и AVX2. Реализация выбирается во время работы программы
+ * по возможностям процессора. Результат всех реализаций совпадает побитово со скалярным кодом
+ * (convert_to_double и convert_to_uint из xquotes_common.hpp).
+ * Векторные реализации доступны только для компиляторов GCC и Clang на x86.
+ * Чтобы отключить их, объявите макрос XQUOTES_DO_NOT_USE_SIMD
+ */
+#ifndef XQUOTES_SIMD_HPP_INCLUDED
+#define XQUOTES_SIMD_HPP_INCLUDED
+
+#include "xquotes_common.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if !defined(XQUOTES_DO_NOT_USE_SIMD) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define XQUOTES_SIMD_X86
+#include <immintrin.h>
+#define XQUOTES_SIMD_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define XQUOTES_SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace xquotes_simd {
+    using namespace xquotes_common;
+
+    /// Наборы инструкций для конвертации цен
+    enum {
+        SIMD_NONE = 0,      ///< скалярный код
+        SIMD_SSE41 = 1,     ///< SSE4.1
+        SIMD_AVX2 = 2,      ///< AVX2
+    };
+
+    /** \brief Определить лучший набор инструкций, поддерживаемый процессором
+     * \return набор инструкций (SIMD_NONE, SIMD_SSE41 или SIMD_AVX2)
+     */
+    inline int detect_simd_level() {
+#       ifdef XQUOTES_SIMD_X86
+        __builtin_cpu_init();
+        /* mingw не выравнивает стек по 32 байта, из-за чего переменные __m256d,
+         * вытесненные на стек, могут вызвать падение программы. Поэтому под Windows только SSE4.1
+         */
+#       if !defined(_WIN32) && !defined(_WIN64)
+        if(__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+#       endif
+        if(__builtin_cpu_supports("sse4.1")) return SIMD_SSE41;
+#       endif
+        return SIMD_NONE;
+    }
+
+    /** \brief Текущий набор инструкций
+     * \warning Данная функция нужна для внутреннего использования
+     */
+    inline std::atomic<int> &simd_level_variable() {
+        static std::atomic<int> simd_level(detect_simd_level());
+        return simd_level;
+    }
+
+    /** \brief Получить используемый набор инструкций
+     * \return набор инструкций (SIMD_NONE, SIMD_SSE41 или SIMD_AVX2)
+     */
+    inline int get_simd_level() {
+        return simd_level_variable().load(std::memory_order_relaxed);
+    }
+
+    /** \brief Установить используемый набор инструкций
+     * Набор инструкций не может быть выше поддерживаемого процессором.
+     * Метод нужен для тестов и сравнения скорости реализаций
+     * \param level набор инструкций (SIMD_NONE, SIMD_SSE41 или SIMD_AVX2)
+     * \return установленный набор инструкций
+     */
+    inline int set_simd_level(const int level) {
+        const int max_level = detect_simd_level();
+        const int new_level = level < SIMD_NONE ? SIMD_NONE : level > max_level ? max_level : level;
+        simd_level_variable().store(new_level, std::memory_order_relaxed);
+        return new_level;
+    }
+
+    /** \brief Конвертировать цены price_t в double (скалярный код)
+     * Буфер цен состоит из num_records записей по record_size цен подряд.
+     * Запись i сохраняется в массив dst начиная с dst[i * dst_stride]
+     * \param src буфер цен
+     * \param dst массив double
+     * \param num_records количество записей
+     * \param record_size количество цен в записи
+     * \param dst_stride шаг записей в массиве dst (в элементах double)
+     */
+    template<class PRICE_T>
+    void convert_prices_to_doubles_scalar(
+            const PRICE_T *src,
+            double *dst,
+            const size_t num_records,
+            const size_t record_size,
+            const size_t dst_stride) {
+        for(size_t i = 0; i < num_records; ++i) {
+            for(size_t j = 0; j < record_size; ++j) {
+                dst[i * dst_stride + j] = (double)src[i * record_size + j] / PRICE_MULTIPLER;
+            }
+        }
+    }
+
+    /** \brief Конвертировать цены double в price_t (скалярный код)
+     * Запись i читается из массива src начиная с src[i * src_stride],
+     * в буфер цен записывается num_records записей по record_size цен подряд
+     * \param src массив double
+     * \param src_stride шаг записей в массиве src (в элементах double)
+     * \param dst буфер цен
+     * \param num_records количество записей
+     * \param record_size количество цен в записи
+     */
+    template<class PRICE_T>
+    void convert_doubles_to_prices_scalar(
+            const double *src,
+            const size_t src_stride,
+            PRICE_T *dst,
+            const size_t num_records,
+            const size_t record_size) {
+        for(size_t i = 0; i < num_records; ++i) {
+            for(size_t j = 0; j < record_size; ++j) {
+                dst[i * record_size + j] = (PRICE_T)((src[i * src_stride + j] * PRICE_MULTIPLER) + 0.5);
+            }
+        }
+    }
+
+#   ifdef XQUOTES_SIMD_X86
+    /* Загрузка цен в вектор double. Беззнаковые 32-битные цены конвертируются точно через
+     * смещение на 2^31, 64-битные - через мантиссу числа 2^52 (только если цены меньше 2^52,
+     * иначе функция вернет false и запись будет сконвертирована скалярным кодом)
+     */
+    XQUOTES_SIMD_TARGET_SSE41
+    inline bool load_prices_sse41(const uint32_t *src, __m128d &value) {
+        const __m128i sign = _mm_set1_epi32((int)0x80000000);
+        const __m128i data = _mm_xor_si128(_mm_loadl_epi64((const __m128i*)src), sign);
+        value = _mm_add_pd(_mm_cvtepi32_pd(data), _mm_set1_pd(2147483648.0));
+        return true;
+    }
+
+    XQUOTES_SIMD_TARGET_SSE41
+    inline bool load_prices_sse41(const uint64_t *src, __m128d &value) {
+        const __m128i data = _mm_loadu_si128((const __m128i*)src);
+        if(!_mm_testz_si128(data, _mm_set1_epi64x((long long)0xFFF0000000000000ULL))) return false;
+        const __m128i magic = _mm_set1_epi64x(0x4330000000000000LL);
+        value = _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(data, magic)), _mm_castsi128_pd(magic));
+        return true;
+    }
+
+    /* Сохранение вектора (уже умноженного и округленного) в цены.
+     * Если значения не лежат в диапазоне [0, 2^31), функция вернет false
+     */
+    XQUOTES_SIMD_TARGET_SSE41
+    inline bool store_prices_sse41(const __m128d &value, uint32_t *dst) {
+        const __m128d in_range = _mm_and_pd(
+            _mm_cmpge_pd(value, _mm_setzero_pd()),
+            _mm_cmplt_pd(value, _mm_set1_pd(2147483648.0)));
+        if(_mm_movemask_pd(in_range) != 0x3) return false;
+        _mm_storel_epi64((__m128i*)dst, _mm_cvttpd_epi32(value));
+        return true;
+    }
+
+    XQUOTES_SIMD_TARGET_SSE41
+    inline bool store_prices_sse41(const __m128d &value, uint64_t *dst) {
+        const __m128d in_range = _mm_and_pd(
+            _mm_cmpge_pd(value, _mm_setzero_pd()),
+            _mm_cmplt_pd(value, _mm_set1_pd(2147483648.0)));
+        if(_mm_movemask_pd(in_range) != 0x3) return false;
+        _mm_storeu_si128((__m128i*)dst, _mm_cvtepu32_epi64(_mm_cvttpd_epi32(value)));
+        return true;
+    }
+
+    XQUOTES_SIMD_TARGET_AVX2
+    inline bool load_prices_avx2(const uint32_t *src, __m256d &value) {
+        const __m128i sign = _mm_set1_epi32((int)0x80000000);
+        const __m128i data = _mm_xor_si128(_mm_loadu_si128((const __m128i*)src), sign);
+        value = _mm256_add_pd(_mm256_cvtepi32_pd(data), _mm256_set1_pd(2147483648.0));
+        return true;
+    }
+
+    XQUOTES_SIMD_TARGET_AVX2
+    inline bool load_prices_avx2(const uint64_t *src, __m256d &value) {
+        const __m256i data = _mm256_loadu_si256((const __m256i*)src);
+        if(!_mm256_testz_si256(data, _mm256_set1_epi64x((long long)0xFFF0000000000000ULL))) return false;
+        const __m256i magic = _mm256_set1_epi64x(0x4330000000000000LL);
+        value = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(data, magic)), _mm256_castsi256_pd(magic));
+        return true;
+    }
+
+    XQUOTES_SIMD_TARGET_AVX2
+    inline bool store_prices_avx2(const __m256d &value, uint32_t *dst) {
+        const __m256d in_range = _mm256_and_pd(
+            _mm256_cmp_pd(value, _mm256_setzero_pd(), _CMP_GE_OQ),
+            _mm256_cmp_pd(value, _mm256_set1_pd(2147483648.0), _CMP_LT_OQ));
+        if(_mm256_movemask_pd(in_range) != 0xF) return false;
+        _mm_storeu_si128((__m128i*)dst, _mm256_cvttpd_epi32(value));
+        return true;
+    }
+
+    XQUOTES_SIMD_TARGET_AVX2
+    inline bool store_prices_avx2(const __m256d &value, uint64_t *dst) {
+        const __m256d in_range = _mm256_and_pd(
+            _mm256_cmp_pd(value, _mm256_setzero_pd(), _CMP_GE_OQ),
+            _mm256_cmp_pd(value, _mm256_set1_pd(2147483648.0), _CMP_LT_OQ));
+        if(_mm256_movemask_pd(in_range) != 0xF) return false;
+        _mm256_storeu_si256((__m256i*)dst, _mm256_cvtepu32_epi64(_mm256_cvttpd_epi32(value)));
+        return true;
+    }
+
+    /** \brief Конвертировать цены price_t в double (SSE4.1)
+     * Параметры см. convert_prices_to_doubles_scalar
+     */
+    template<class UINT_T>
+    XQUOTES_SIMD_TARGET_SSE41
+    void convert_prices_to_doubles_sse41(
+            const UINT_T *src,
+            double *dst,
+            const size_t num_records,
+            const size_t record_size,
+            const size_t dst_stride) {
+        const __m128d multipler = _mm_set1_pd(PRICE_MULTIPLER);
+        __m128d value;
+        size_t i = 0;
+        if(record_size == 1) {
+            for(; i + 2 <= num_records; i += 2) {
+                if(!load_prices_sse41(src + i, value)) {
+                    convert_prices_to_doubles_scalar(src + i, dst + i * dst_stride, 2, 1, dst_stride);
+                    continue;
+                }
+                value = _mm_div_pd(value, multipler);
+                _mm_storel_pd(dst + i * dst_stride, value);
+                _mm_storeh_pd(dst + (i + 1) * dst_stride, value);
+            }
+        } else
+        if(record_size == 4 || record_size == 5) {
+            for(; i < num_records; ++i) {
+                const UINT_T *record_src = src + i * record_size;
+                double *record_dst = dst + i * dst_stride;
+                for(size_t j = 0; j < 4; j += 2) {
+                    if(!load_prices_sse41(record_src + j, value)) {
+                        convert_prices_to_doubles_scalar(record_src + j, record_dst + j, 1, 2, 2);
+                        continue;
+                    }
+                    _mm_storeu_pd(record_dst + j, _mm_div_pd(value, multipler));
+                }
+                if(record_size == 5) record_dst[4] = (double)record_src[4] / PRICE_MULTIPLER;
+            }
+        }
+        if(i < num_records) {
+            convert_prices_to_doubles_scalar(src + i * record_size, dst + i * dst_stride, num_records - i, record_size, dst_stride);
+        }
+    }
+
+    /** \brief Конвертировать цены double в price_t (SSE4.1)
+     * Параметры см. convert_doubles_to_prices_scalar
+     */
+    template<class UINT_T>
+    XQUOTES_SIMD_TARGET_SSE41
+    void convert_doubles_to_prices_sse41(
+            const double *src,
+            const size_t src_stride,
+            UINT_T *dst,
+            const size_t num_records,
+            const size_t record_size) {
+        const __m128d multipler = _mm_set1_pd(PRICE_MULTIPLER);
+        const __m128d half = _mm_set1_pd(0.5);
+        size_t i = 0;
+        if(record_size == 1) {
+            for(; i + 2 <= num_records; i += 2) {
+                const __m128d value = _mm_add_pd(_mm_mul_pd(_mm_set_pd(src[(i + 1) * src_stride], src[i * src_stride]), multipler), half);
+                if(!store_prices_sse41(value, dst + i)) {
+                    convert_doubles_to_prices_scalar(src + i * src_stride, src_stride, dst + i, 2, 1);
+                }
+            }
+        } else
+        if(record_size == 4 || record_size == 5) {
+            for(; i < num_records; ++i) {
+                const double *record_src = src + i * src_stride;
+                UINT_T *record_dst = dst + i * record_size;
+                for(size_t j = 0; j < 4; j += 2) {
+                    const __m128d value = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(record_src + j), multipler), half);
+                    if(!store_prices_sse41(value, record_dst + j)) {
+                        convert_doubles_to_prices_scalar(record_src + j, 2, record_dst + j, 1, 2);
+                    }
+                }
+                if(record_size == 5) record_dst[4] = (UINT_T)((record_src[4] * PRICE_MULTIPLER) + 0.5);
+            }
+        }
+        if(i < num_records) {
+            convert_doubles_to_prices_scalar(src + i * src_stride, src_stride, dst + i * record_size, num_records - i, record_size);
+        }
+    }
+
+    /** \brief Конвертировать цены price_t в double (AVX2)
+     * Параметры см. convert_prices_to_doubles_scalar
+     */
+    template<class UINT_T>
+    XQUOTES_SIMD_TARGET_AVX2
+    void convert_prices_to_doubles_avx2(
+            const UINT_T *src,
+            double *dst,
+            const size_t num_records,
+            const size_t record_size,
+            const size_t dst_stride) {
+        const __m256d multipler = _mm256_set1_pd(PRICE_MULTIPLER);
+        __m256d value;
+        size_t i = 0;
+        if(record_size == 1) {
+            for(; i + 4 <= num_records; i += 4) {
+                if(!load_prices_avx2(src + i, value)) {
+                    convert_prices_to_doubles_scalar(src + i, dst + i * dst_stride, 4, 1, dst_stride);
+                    continue;
+                }
+                value = _mm256_div_pd(value, multipler);
+                const __m128d lo = _mm256_castpd256_pd128(value);
+                const __m128d hi = _mm256_extractf128_pd(value, 1);
+                _mm_storel_pd(dst + i * dst_stride, lo);
+                _mm_storeh_pd(dst + (i + 1) * dst_stride, lo);
+                _mm_storel_pd(dst + (i + 2) * dst_stride, hi);
+                _mm_storeh_pd(dst + (i + 3) * dst_stride, hi);
+            }
+        } else
+        if(record_size == 4 || record_size == 5) {
+            for(; i < num_records; ++i) {
+                const UINT_T *record_src = src + i * record_size;
+                double *record_dst = dst + i * dst_stride;
+                if(!load_prices_avx2(record_src, value)) {
+                    convert_prices_to_doubles_scalar(record_src, record_dst, 1, record_size, dst_stride);
+                    continue;
+                }
+                _mm256_storeu_pd(record_dst, _mm256_div_pd(value, multipler));
+                if(record_size == 5) record_dst[4] = (double)record_src[4] / PRICE_MULTIPLER;
+            }
+        }
+        if(i < num_records) {
+            convert_prices_to_doubles_scalar(src + i * record_size, dst + i * dst_stride, num_records - i, record_size, dst_stride);
+        }
+    }
+
+    /** \brief Конвертировать цены double в price_t (AVX2)
+     * Параметры см. convert_doubles_to_prices_scalar
+     */
+    template<class UINT_T>
+    XQUOTES_SIMD_TARGET_AVX2
+    void convert_doubles_to_prices_avx2(
+            const double *src,
+            const size_t src_stride,
+            UINT_T *dst,
+            const size_t num_records,
+            const size_t record_size) {
+        const __m256d multipler = _mm256_set1_pd(PRICE_MULTIPLER);
+        const __m256d half = _mm256_set1_pd(0.5);
+        size_t i = 0;
+        if(record_size == 1) {
+            for(; i + 4 <= num_records; i += 4) {
+                const __m256d data = _mm256_set_pd(
+                    src[(i + 3) * src_stride],
+                    src[(i + 2) * src_stride],
+                    src[(i + 1) * src_stride],
+                    src[i * src_stride]);
+                const __m256d value = _mm256_add_pd(_mm256_mul_pd(data, multipler), half);
+                if(!store_prices_avx2(value, dst + i)) {
+                    convert_doubles_to_prices_scalar(src + i * src_stride, src_stride, dst + i, 4, 1);
+                }
+            }
+        } else
+        if(record_size == 4 || record_size == 5) {
+            for(; i < num_records; ++i) {
+                const double *record_src = src + i * src_stride;
+                UINT_T *record_dst = dst + i * record_size;
+                const __m256d value = _mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(record_src), multipler), half);
+                if(!store_prices_avx2(value, record_dst)) {
+                    convert_doubles_to_prices_scalar(record_src, src_stride, record_dst, 1, record_size);
+                    continue;
+                }
+                if(record_size == 5) record_dst[4] = (UINT_T)((record_src[4] * PRICE_MULTIPLER) + 0.5);
+            }
+        }
+        if(i < num_records) {
+            convert_doubles_to_prices_scalar(src + i * src_stride, src_stride, dst + i * record_size, num_records - i, record_size);
+        }
+    }
+#   endif // XQUOTES_SIMD_X86
+
+    /** \brief Выбрать элементы массива по индексам (скалярный код)
+     * dst[i] = src[indices[i]]
+     * \param src исходный массив
+     * \param indices индексы элементов в массиве src
+     * \param dst массив для выбранных элементов
+     * \param num_indices количество индексов
+     */
+    inline void gather_doubles_scalar(
+            const double *src,
+            const int32_t *indices,
+            double *dst,
+            const size_t num_indices) {
+        for(size_t i = 0; i < num_indices; ++i) {
+            dst[i] = src[indices[i]];
+        }
+    }
+
+#   ifdef XQUOTES_SIMD_X86
+    /** \brief Выбрать элементы массива по индексам (AVX2)
+     * Параметры см. gather_doubles_scalar
+     */
+    XQUOTES_SIMD_TARGET_AVX2
+    inline void gather_doubles_avx2(
+            const double *src,
+            const int32_t *indices,
+            double *dst,
+            const size_t num_indices) {
+        // маскированный вариант с нулевым исходным значением: у обычного gather регистр назначения не инициализирован
+        const __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+        size_t i = 0;
+        for(; i + 4 <= num_indices; i += 4) {
+            const __m128i index = _mm_loadu_si128((const __m128i*)(indices + i));
+            _mm256_storeu_pd(dst + i, _mm256_mask_i32gather_pd(_mm256_setzero_pd(), src, index, mask, sizeof(double)));
+        }
+        gather_doubles_scalar(src, indices + i, dst + i, num_indices - i);
+    }
+#   endif
+
+    /** \brief Выбрать элементы массива по индексам
+     * Векторная реализация есть только для AVX2, иначе используется скалярный код.
+     * Параметры см. gather_doubles_scalar
+     */
+    inline void gather_doubles(
+            const double *src,
+            const int32_t *indices,
+            double *dst,
+            const size_t num_indices) {
+#       ifdef XQUOTES_SIMD_X86
+        if(get_simd_level() == SIMD_AVX2) {
+            gather_doubles_avx2(src, indices, dst, num_indices);
+            return;
+        }
+#       endif
+        gather_doubles_scalar(src, indices, dst, num_indices);
+    }
+
+    /** \brief Беззнаковое целое того же размера, что и PRICE_T
+     * \warning Данный класс нужен для внутреннего использования
+     */
+    template<size_t SIZE> struct UnsignedOfSize;
+    template<> struct UnsignedOfSize<4> {typedef uint32_t type;};
+    template<> struct UnsignedOfSize<8> {typedef uint64_t type;};
+
+    /** \brief Конвертировать цены price_t в double
+     * Реализация выбирается по get_simd_level(). Параметры см. convert_prices_to_doubles_scalar
+     */
+    template<class PRICE_T>
+    inline void convert_prices_to_doubles(
+            const PRICE_T *src,
+            double *dst,
+            const size_t num_records,
+            const size_t record_size,
+            const size_t dst_stride) {
+#       ifdef XQUOTES_SIMD_X86
+        typedef typename UnsignedOfSize<sizeof(PRICE_T)>::type uint_t;
+        switch(get_simd_level()) {
+        case SIMD_AVX2:
+            convert_prices_to_doubles_avx2((const uint_t*)src, dst, num_records, record_size, dst_stride);
+            return;
+        case SIMD_SSE41:
+            convert_prices_to_doubles_sse41((const uint_t*)src, dst, num_records, record_size, dst_stride);
+            return;
+        default:
+            break;
+        }
+#       endif
+        convert_prices_to_doubles_scalar(src, dst, num_records, record_size, dst_stride);
+    }
+
+    /** \brief Конвертировать цены double в price_t
+     * Реализация выбирается по get_simd_level(). Параметры см. convert_doubles_to_prices_scalar
+     */
+    template<class PRICE_T>
+    inline void convert_doubles_to_prices(
+            const double *src,
+            const size_t src_stride,
+            PRICE_T *dst,
+            const size_t num_records,
+            const size_t record_size) {
+#       ifdef XQUOTES_SIMD_X86
+        typedef typename UnsignedOfSize<sizeof(PRICE_T)>::type uint_t;
+        switch(get_simd_level()) {
+        case SIMD_AVX2:
+            convert_doubles_to_prices_avx2(src, src_stride, (uint_t*)dst, num_records, record_size);
+            return;
+        case SIMD_SSE41:
+            convert_doubles_to_prices_sse41(src, src_stride, (uint_t*)dst, num_records, record_size);
+            return;
+        default:
+            break;
+        }
+#       endif
+        convert_doubles_to_prices_scalar(src, src_stride, dst, num_records, record_size);
+    }
+}
+
+#endif // XQUOTES_SIMD_HPP_INCLUDED
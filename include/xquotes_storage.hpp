@@ -32,13 +32,27 @@
 #define XQUOTES_STORAGE_HPP_INCLUDED
 
 #include "xquotes_common.hpp"
+#include "xquotes_pread.hpp"
 #include "banana_filesystem.hpp"
 #include "ztime.hpp"
 #include <limits>
 #include <algorithm>
 #include <random>
 #include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <vector>
 #include <memory>
+#include <map>
+#include <tuple>
+#include <mutex>
+
+#include <fcntl.h>
+#if defined(_WIN32) || defined(_WIN64)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #ifndef XQUOTES_NOT_USE_ZSTD
 #define XQUOTES_USE_ZSTD 1
@@ -48,15 +62,144 @@
 #define XQUOTES_USE_ZSTD 0
 #endif
 
+#ifndef XQUOTES_NOT_USE_MMAP
+#define XQUOTES_USE_MMAP 1
+#include "xquotes_mmap.hpp"
+#else
+#define XQUOTES_USE_MMAP 0
+#endif
+
 namespace xquotes_storage {
     using namespace xquotes_common;
 
+    /// Параметры расширенного заголовка хранилища
+    enum {
+        HEADER_SECTIONS_SIGNATURE = 0x53515848, ///< Сигнатура секций заголовка, записывается после заметки файла
+        HEADER_SECTION_FREE_EXTENTS = 1,        ///< Секция со списком свободных участков файла
+        HEADER_SECTION_DAY_SUMMARIES = 2,       ///< Секция с итогами дней котировок (см. QuotesHistory::get_day_summary)
+    };
+
+    /// Версии формата файла хранилища
+    enum {
+        FILE_VERSION_4 = 4,                     ///< Исходный формат, поля заголовка и цены имеют тип unsigned long (4 байта под Windows, 8 байт под Linux)
+        FILE_VERSION_5 = 5,                     ///< Формат с полями фиксированной ширины: ключи, заметка и цены uint32_t, ссылки и размеры uint64_t
+        FILE_V5_SIGNATURE = 0x35534851,         ///< Сигнатура файла формата 5 ("QHS5"), записывается в начале файла
+        FILE_V5_DATA_START = 16,                ///< Начало области данных в файле формата 5 (сигнатура, версия и ссылка на заголовок)
+    };
+
+#if     XQUOTES_USE_ZSTD == 1
+    /** \brief Реестр подготовленных словарей zstd
+     * \details Встроенные словари используются сразу многими хранилищами (например, в MultipleQuotesHistory),
+     * поэтому подготовленный словарь создается один раз на процесс и разделяется между хранилищами.
+     * Словари различаются по содержимому (ID словаря, размер и хеш данных), а не по адресу буфера.
+     * Словарь удаляется из реестра, когда его перестает использовать последнее хранилище
+     */
+    class ZstdDictionaryRegistry {
+    private:
+        typedef std::tuple<unsigned, size_t, uint64_t, int> dictionary_key_t;
+
+        template<class T>
+        class Registry {
+        public:
+            std::mutex registry_mutex;
+            std::map<dictionary_key_t, std::weak_ptr<T>> dictionaries;
+
+            /** \brief Найти словарь
+             * \warning Метод нужно вызывать под registry_mutex
+             */
+            std::shared_ptr<T> find(const dictionary_key_t &key) {
+                auto it = dictionaries.find(key);
+                return it == dictionaries.end() ? std::shared_ptr<T>() : it->second.lock();
+            }
+
+            /** \brief Удалить запись словаря, если словарь больше не используется
+             */
+            void erase_expired(const dictionary_key_t &key) {
+                std::lock_guard<std::mutex> lock(registry_mutex);
+                auto it = dictionaries.find(key);
+                if(it != dictionaries.end() && it->second.expired()) dictionaries.erase(it);
+            }
+        };
+
+        /** \brief Получить ключ словаря по его содержимому
+         */
+        static dictionary_key_t get_dictionary_key(const char *dictionary_buffer, const size_t dictionary_buffer_size, const int compress_level) {
+            // FNV-1a
+            uint64_t hash = 0xcbf29ce484222325ULL;
+            for(size_t i = 0; i < dictionary_buffer_size; ++i) {
+                hash ^= (unsigned char)dictionary_buffer[i];
+                hash *= 0x100000001b3ULL;
+            }
+            const unsigned dictionary_id = ZSTD_getDictID_fromDict(dictionary_buffer, dictionary_buffer_size);
+            return dictionary_key_t(dictionary_id, dictionary_buffer_size, hash, compress_level);
+        }
+
+        static Registry<ZSTD_DDict> &get_ddict_registry() {
+            static Registry<ZSTD_DDict> registry;
+            return registry;
+        }
+
+        static Registry<ZSTD_CDict> &get_cdict_registry() {
+            static Registry<ZSTD_CDict> registry;
+            return registry;
+        }
+
+    public:
+
+        /** \brief Получить подготовленный словарь для декомпрессии
+         * \param dictionary_buffer указатель на буфер словаря
+         * \param dictionary_buffer_size размер буфера словаря
+         * \return указатель на словарь или пустой указатель в случае ошибки
+         */
+        static std::shared_ptr<ZSTD_DDict> get_ddict(const char *dictionary_buffer, const size_t dictionary_buffer_size) {
+            if(dictionary_buffer == NULL || dictionary_buffer_size == 0) return std::shared_ptr<ZSTD_DDict>();
+            Registry<ZSTD_DDict> &registry = get_ddict_registry();
+            const dictionary_key_t key = get_dictionary_key(dictionary_buffer, dictionary_buffer_size, 0);
+            std::lock_guard<std::mutex> lock(registry.registry_mutex);
+            std::shared_ptr<ZSTD_DDict> ddict = registry.find(key);
+            if(ddict) return ddict;
+            ZSTD_DDict *new_ddict = ZSTD_createDDict(dictionary_buffer, dictionary_buffer_size);
+            if(new_ddict == NULL) return std::shared_ptr<ZSTD_DDict>();
+            ddict = std::shared_ptr<ZSTD_DDict>(new_ddict, [key](ZSTD_DDict *d) {
+                ZSTD_freeDDict(d);
+                get_ddict_registry().erase_expired(key);
+            });
+            registry.dictionaries[key] = ddict;
+            return ddict;
+        }
+
+        /** \brief Получить подготовленный словарь для компрессии
+         * \param dictionary_buffer указатель на буфер словаря
+         * \param dictionary_buffer_size размер буфера словаря
+         * \param compress_level уровень сжатия
+         * \return указатель на словарь или пустой указатель в случае ошибки
+         */
+        static std::shared_ptr<ZSTD_CDict> get_cdict(const char *dictionary_buffer, const size_t dictionary_buffer_size, const int compress_level) {
+            if(dictionary_buffer == NULL || dictionary_buffer_size == 0) return std::shared_ptr<ZSTD_CDict>();
+            Registry<ZSTD_CDict> &registry = get_cdict_registry();
+            const dictionary_key_t key = get_dictionary_key(dictionary_buffer, dictionary_buffer_size, compress_level);
+            std::lock_guard<std::mutex> lock(registry.registry_mutex);
+            std::shared_ptr<ZSTD_CDict> cdict = registry.find(key);
+            if(cdict) return cdict;
+            ZSTD_CDict *new_cdict = ZSTD_createCDict(dictionary_buffer, dictionary_buffer_size, compress_level);
+            if(new_cdict == NULL) return std::shared_ptr<ZSTD_CDict>();
+            cdict = std::shared_ptr<ZSTD_CDict>(new_cdict, [key](ZSTD_CDict *c) {
+                ZSTD_freeCDict(c);
+                get_cdict_registry().erase_expired(key);
+            });
+            registry.dictionaries[key] = cdict;
+            return cdict;
+        }
+    };
+#endif // XQUOTES_USE_ZSTD
+
     /** \brief Класс для работы с файлом-хранилищем котировок
      * \details Данный класс является родителем классов-хранилищ данных
      */
     class Storage {
         protected:
         std::fstream file;                              /**< Файл данных */
+        int sync_handle = -1;                           /**< Дескриптор файла данных для сброса данных на диск */
         std::string file_name;                          /**< Имя файла данных */
         bool is_write = false;                          /**< Флаг записи данных. Данный флаг устанавливается, если была хотя бы одна запись в файл*/
         bool is_file_open = false;                      /**< Фдаг наличия файла данных */
@@ -64,6 +207,44 @@ namespace xquotes_storage {
         int dictionary_file_size = 0;
         bool is_mem_dict_file = false;                  /**< Флаг использования выделения памяти под словарь */
         note_t file_note = 0;                           /**< Заметка файла */
+        int file_version = FILE_VERSION_4;              /**< Версия формата файла */
+#       if XQUOTES_USE_MMAP == 1
+        xquotes_mmap::MemoryMappedFile mapped_file;     /**< Файл данных, отображенный в память (режим только для чтения) */
+#       endif
+        xquotes_pread::PositionalReadFile concurrent_file;  /**< Файл данных для конкурентного чтения */
+        bool is_concurrent = false;                         /**< Флаг режима конкурентного чтения */
+
+        /** \brief Буферы и контекст потока для конкурентного чтения
+         */
+        class ThreadReadContext {
+        public:
+            std::unique_ptr<char[]> buffer;
+            size_t buffer_size = 0;
+#           if XQUOTES_USE_ZSTD == 1
+            ZSTD_DCtx *dctx = NULL;
+#           endif
+
+            char *get_buffer(const size_t size) {
+                if(size > buffer_size) {
+                    buffer = std::unique_ptr<char[]>(new char[size]);
+                    buffer_size = size;
+                }
+                return buffer.get();
+            }
+
+            ~ThreadReadContext() {
+#               if XQUOTES_USE_ZSTD == 1
+                if(dctx != NULL) ZSTD_freeDCtx(dctx);
+#               endif
+            }
+        };
+
+        /** \brief Получить буферы и контекст текущего потока
+         */
+        static ThreadReadContext &get_thread_read_context() {
+            static thread_local ThreadReadContext context;
+            return context;
+        }
 
         std::unique_ptr<char[]> compressed_file_buffer;   /**< Буфер для записи */
         size_t compressed_file_buffer_size = 0;           /**< Размер буфера для записи */
@@ -79,6 +260,65 @@ namespace xquotes_storage {
             }
         }
 
+#       if XQUOTES_USE_ZSTD == 1
+        ZSTD_CCtx *cctx = NULL;                 /**< Контекст компрессии, создается один раз на хранилище */
+        ZSTD_DCtx *dctx = NULL;                 /**< Контекст декомпрессии, создается один раз на хранилище */
+        std::shared_ptr<ZSTD_DDict> ddict;      /**< Подготовленный словарь для декомпрессии */
+        std::shared_ptr<ZSTD_CDict> cdict;      /**< Подготовленный словарь для компрессии */
+        int cdict_compress_level = 0;           /**< Уровень сжатия подготовленного словаря для компрессии */
+
+        /** \brief Обновить подготовленные словари
+         * \details Словарь для декомпрессии создается сразу.
+         * Словарь для компрессии зависит от уровня сжатия и будет создан при первой записи
+         */
+        void update_prepared_dictionary() {
+            ddict = ZstdDictionaryRegistry::get_ddict(dictionary_file_buffer, dictionary_file_size);
+            cdict.reset();
+        }
+
+        /** \brief Освободить контексты zstd и подготовленные словари
+         */
+        void free_zstd_context() {
+            if(cctx != NULL) ZSTD_freeCCtx(cctx);
+            if(dctx != NULL) ZSTD_freeDCtx(dctx);
+            cctx = NULL;
+            dctx = NULL;
+            ddict.reset();
+            cdict.reset();
+        }
+
+        /** \brief Распаковать данные с использованием словаря
+         * \param dst буфер для распакованных данных
+         * \param dst_capacity размер буфера для распакованных данных
+         * \param src сжатые данные
+         * \param src_size размер сжатых данных
+         * \return размер распакованных данных или код ошибки zstd
+         */
+        size_t decompress_using_prepared_dictionary(char *dst, const size_t dst_capacity, const char *src, const size_t src_size) {
+            if(dctx == NULL) dctx = ZSTD_createDCtx();
+            if(ddict) return ZSTD_decompress_usingDDict(dctx, dst, dst_capacity, src, src_size, ddict.get());
+            return ZSTD_decompress_usingDict(dctx, dst, dst_capacity, src, src_size, dictionary_file_buffer, dictionary_file_size);
+        }
+
+        /** \brief Сжать данные с использованием словаря
+         * \param dst буфер для сжатых данных
+         * \param dst_capacity размер буфера для сжатых данных
+         * \param src исходные данные
+         * \param src_size размер исходных данных
+         * \param compress_level уровень сжатия
+         * \return размер сжатых данных или код ошибки zstd
+         */
+        size_t compress_using_prepared_dictionary(char *dst, const size_t dst_capacity, const char *src, const size_t src_size, const int compress_level) {
+            if(cctx == NULL) cctx = ZSTD_createCCtx();
+            if(!cdict || cdict_compress_level != compress_level) {
+                cdict = ZstdDictionaryRegistry::get_cdict(dictionary_file_buffer, dictionary_file_size, compress_level);
+                cdict_compress_level = compress_level;
+            }
+            if(cdict) return ZSTD_compress_usingCDict(cctx, dst, dst_capacity, src, src_size, cdict.get());
+            return ZSTD_compress_usingDict(cctx, dst, dst_capacity, src, src_size, dictionary_file_buffer, dictionary_file_size, compress_level);
+        }
+#       endif // XQUOTES_USE_ZSTD
+
         std::unique_ptr<char[]> input_subfile_buffer;
         size_t input_subfile_buffer_size = 0;
 
@@ -111,6 +351,206 @@ namespace xquotes_storage {
         };
 
         std::vector<Subfile> subfiles;    /**< Подфайлы */
+        std::shared_ptr<const std::vector<Subfile>> subfiles_snapshot;    /**< Неизменяемый снимок заголовка для конкурентного чтения */
+
+        /** \brief Найти подфайл в снимке заголовка
+         * \param key ключ подфайла
+         * \param subfile найденный подфайл
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int find_subfile_concurrent(const key_t key, Subfile &subfile) const {
+            std::shared_ptr<const std::vector<Subfile>> snapshot = std::atomic_load(&subfiles_snapshot);
+            if(!snapshot) return FILE_NOT_OPENED;
+            if(snapshot->size() == 0) return NO_SUBFILES;
+            auto subfiles_it = std::lower_bound(
+                snapshot->begin(),
+                snapshot->end(),
+                key,
+                [](const Subfile &lhs, const key_t &key) {
+                return lhs.key < key;
+            });
+            if(subfiles_it == snapshot->end() || subfiles_it->key != key) return SUBFILES_NOT_FOUND;
+            subfile = *subfiles_it;
+            return OK;
+        }
+
+        /** \brief Прочитать данные подфайла в режиме конкурентного чтения
+         * \details В режиме отображения файла в память вернет указатель на отображение,
+         * иначе прочитает подфайл в буфер текущего потока
+         * \param key ключ подфайла
+         * \param data указатель на данные подфайла
+         * \param buffer_size размер подфайла
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int read_subfile_view_concurrent(const key_t key, const char *&data, unsigned long &buffer_size) const {
+            if(!is_concurrent) return FILE_NOT_OPENED;
+            Subfile subfile;
+            int err = find_subfile_concurrent(key, subfile);
+            if(err != OK) return err;
+            buffer_size = subfile.size;
+#           if XQUOTES_USE_MMAP == 1
+            if(mapped_file.is_open()) {
+                if((size_t)subfile.link + subfile.size > mapped_file.size()) return DATA_SIZE_ERROR;
+                data = mapped_file.data() + subfile.link;
+                return OK;
+            }
+#           endif
+            char *buffer = get_thread_read_context().get_buffer(subfile.size);
+            if(subfile.size > 0 && !concurrent_file.read(subfile.link, buffer, subfile.size)) return DATA_SIZE_ERROR;
+            data = buffer;
+            return OK;
+        }
+
+        /** \brief Класс свободного участка файла
+         */
+        class FreeExtent {
+            public:
+            link_t link = 0;        /**< Ссылка на начало участка */
+            unsigned long size = 0; /**< Размер участка */
+            FreeExtent() {};
+
+            FreeExtent(const link_t &link, const unsigned long &size) {
+                FreeExtent::link = link;
+                FreeExtent::size = size;
+            };
+        };
+
+        std::vector<FreeExtent> free_extents;   /**< Свободные участки файла, отсортированы по ссылке */
+        std::vector<FreeExtent> released_extents;   /**< Участки старых данных, которые станут свободными после записи заголовка */
+        link_t header_link = 0;                     /**< Ссылка на заголовок, записанный в файл */
+        link_t header_end = 0;                      /**< Конец заголовка, записанного в файл */
+        link_t header_data_end = 0;                 /**< Конец области данных, на которую ссылается записанный заголовок */
+
+        /** \brief Секции заголовка
+         * \details Секции записываются после заметки файла и не мешают чтению заголовка старыми версиями библиотеки.
+         * Секции с неизвестным тегом сохраняются без изменений
+         */
+        std::map<unsigned long, std::vector<char>> header_sections;
+
+        /** \brief Получить конец области данных
+         * \return ссылка на конец последнего подфайла (место записи заголовка)
+         */
+        link_t get_data_end(const std::vector<Subfile> &_subfiles) const {
+            link_t data_end = get_data_start();
+            for(size_t i = 0; i < _subfiles.size(); ++i) {
+                data_end = std::max(data_end, (link_t)(_subfiles[i].link + _subfiles[i].size));
+            }
+            return data_end;
+        }
+
+        /** \brief Получить начало области данных
+         * \return ссылка на место записи первого подфайла
+         */
+        inline link_t get_data_start() const {
+            return file_version == FILE_VERSION_5 ? (link_t)FILE_V5_DATA_START : (link_t)sizeof(unsigned long);
+        }
+
+        /** \brief Освободить участок файла
+         * \details Участок добавляется в список свободных участков и объединяется с соседними.
+         * Свободные участки в конце области данных удаляются из списка
+         * \param link ссылка на участок
+         * \param size размер участка
+         */
+        void release_extent(const link_t link, const unsigned long size) {
+            if(size > 0) {
+                auto it = std::lower_bound(
+                    free_extents.begin(),
+                    free_extents.end(),
+                    link,
+                    [](const FreeExtent &lhs, const link_t &link) {
+                    return lhs.link < link;
+                });
+                it = free_extents.insert(it, FreeExtent(link, size));
+                // объединяем со следующим участком
+                auto it_next = it + 1;
+                if(it_next != free_extents.end() && it->link + it->size == it_next->link) {
+                    it->size += it_next->size;
+                    it = free_extents.erase(it_next) - 1;
+                }
+                // объединяем с предыдущим участком
+                if(it != free_extents.begin()) {
+                    auto it_prev = it - 1;
+                    if(it_prev->link + it_prev->size == it->link) {
+                        it_prev->size += it->size;
+                        free_extents.erase(it);
+                    }
+                }
+            }
+            trim_free_extents();
+        }
+
+        /** \brief Удалить свободные участки, которые находятся за концом области данных
+         */
+        void trim_free_extents() {
+            const link_t data_end = get_data_end(subfiles);
+            while(free_extents.size() > 0 && free_extents.back().link + free_extents.back().size >= data_end) {
+                free_extents.pop_back();
+            }
+            if(subfiles.size() == 0) free_extents.clear();
+        }
+
+        /** \brief Найти место в конце файла
+         * \details Место не пересекается с данными и заголовком, на которые ссылается начало файла,
+         * поэтому сбой до записи нового заголовка не повредит файл. Участки, ожидающие освобождения,
+         * тоже считаются занятыми до записи заголовка
+         * \param size размер участка
+         * \return ссылка на участок
+         */
+        link_t get_end_link(const link_t size) const {
+            link_t link = std::max(get_data_end(subfiles), header_data_end);
+            for(size_t i = 0; i < released_extents.size(); ++i) {
+                link = std::max(link, (link_t)(released_extents[i].link + released_extents[i].size));
+            }
+            if(link < header_end && link + size > header_link) link = header_end;
+            return link;
+        }
+
+        /** \brief Выделить участок файла
+         * \details Используется первый подходящий свободный участок,
+         * если такого нет, участок выделяется в конце файла (см. get_end_link)
+         * \param size размер участка
+         * \return ссылка на участок
+         */
+        link_t allocate_extent(const unsigned long size) {
+            for(size_t i = 0; i < free_extents.size(); ++i) {
+                if(free_extents[i].size < size) continue;
+                const link_t link = free_extents[i].link;
+                free_extents[i].link += size;
+                free_extents[i].size -= size;
+                if(free_extents[i].size == 0) free_extents.erase(free_extents.begin() + i);
+                return link;
+            }
+            return get_end_link(size);
+        }
+
+        /** \brief Проверить список свободных участков
+         * \details Участки не должны пересекаться друг с другом и с подфайлами.
+         * Если список поврежден, он очищается (место не будет использовано повторно до вызова compact)
+         */
+        void check_free_extents() {
+            std::sort(free_extents.begin(), free_extents.end(), [](const FreeExtent &a, const FreeExtent &b) {
+                return a.link < b.link;
+            });
+            std::vector<FreeExtent> used_extents;
+            used_extents.reserve(subfiles.size() + free_extents.size());
+            for(size_t i = 0; i < subfiles.size(); ++i) {
+                used_extents.push_back(FreeExtent(subfiles[i].link, subfiles[i].size));
+            }
+            used_extents.insert(used_extents.end(), free_extents.begin(), free_extents.end());
+            std::sort(used_extents.begin(), used_extents.end(), [](const FreeExtent &a, const FreeExtent &b) {
+                return a.link < b.link;
+            });
+            const link_t data_end = get_data_end(subfiles);
+            link_t last_end = get_data_start();
+            for(size_t i = 0; i < used_extents.size(); ++i) {
+                if(used_extents[i].size == 0) continue;
+                if(used_extents[i].link < last_end || used_extents[i].link + used_extents[i].size > data_end) {
+                    free_extents.clear();
+                    return;
+                }
+                last_end = used_extents[i].link + used_extents[i].size;
+            }
+        }
 
         Subfile *get_max_link(std::vector<Subfile> &_subfiles) {
             if(_subfiles.size() == 0) return NULL;
@@ -134,8 +574,68 @@ namespace xquotes_storage {
             }
         }
 
-        Subfile *find_subfiles(const key_t key, std::vector<Subfile> &_subfiles) const {
+        /* прямой индекс подфайлов: ключи подфайлов - это номера дней, они идут почти подряд,
+         * поэтому позицию подфайла в subfiles можно хранить в массиве по смещению ключа
+         */
+        std::vector<int> subfiles_index;        /**< Позиции подфайлов в subfiles по смещению ключа от subfiles_index_min_key, -1 если подфайла нет */
+        key_t subfiles_index_min_key = 0;       /**< Ключ первого элемента прямого индекса */
+        bool is_subfiles_index = false;         /**< Флаг актуальности прямого индекса */
+
+        /* битовая карта подфайлов строится и сбрасывается вместе с прямым индексом,
+         * первый ключ карты кратен 64, чтобы карты разных хранилищ совпадали по словам
+         */
+        std::vector<uint64_t> subfiles_bitset;  /**< Бит (key - subfiles_bitset_first_key) установлен, если есть подфайл с ключом key */
+        key_t subfiles_bitset_first_key = 0;    /**< Ключ первого бита карты */
+
+        /** \brief Отметить ключ в битовой карте подфайлов
+         */
+        inline void set_subfiles_bitset(const key_t key) {
+            const size_t offset = key - subfiles_bitset_first_key;
+            if(offset / 64 >= subfiles_bitset.size()) subfiles_bitset.resize(offset / 64 + 1, 0);
+            subfiles_bitset[offset / 64] |= (uint64_t)1 << (offset % 64);
+        }
+
+        /** \brief Сбросить прямой индекс подфайлов
+         * \details Индекс будет построен заново при следующем поиске подфайла
+         */
+        inline void invalidate_subfiles_index() {
+            is_subfiles_index = false;
+        }
+
+        /** \brief Построить прямой индекс подфайлов
+         */
+        void build_subfiles_index() {
+            subfiles_index.clear();
+            subfiles_bitset.clear();
+            is_subfiles_index = true;
+            if(subfiles.size() == 0) return;
+            subfiles_index_min_key = subfiles.front().key;
+            subfiles_index.assign((size_t)(subfiles.back().key - subfiles_index_min_key) + 1, -1);
+            subfiles_bitset_first_key = subfiles_index_min_key / 64 * 64;
+            for(size_t i = 0; i < subfiles.size(); ++i) {
+                subfiles_index[subfiles[i].key - subfiles_index_min_key] = i;
+                set_subfiles_bitset(subfiles[i].key);
+            }
+        }
+
+        /** \brief Получить позицию подфайла в subfiles
+         * \param key ключ подфайла
+         * \return позиция подфайла или -1, если подфайла нет
+         */
+        inline int get_subfile_index(const key_t key) {
+            if(!is_subfiles_index) build_subfiles_index();
+            if(key < subfiles_index_min_key) return -1;
+            const size_t offset = key - subfiles_index_min_key;
+            if(offset >= subfiles_index.size()) return -1;
+            return subfiles_index[offset];
+        }
+
+        Subfile *find_subfiles(const key_t key, std::vector<Subfile> &_subfiles) {
             if(_subfiles.size() == 0) return NULL;
+            if(&_subfiles == &subfiles) {
+                const int ind = get_subfile_index(key);
+                return ind >= 0 ? &subfiles[ind] : NULL;
+            }
             auto subfiles_it = std::lower_bound(
                 _subfiles.begin(),
                 _subfiles.end(),
@@ -163,12 +663,20 @@ namespace xquotes_storage {
                     [](const key_t &key, const Subfile &rhs) {
                     return key < rhs.key;
                 });
-                if(subfiles_it == _subfiles.end() || subfiles_it == _subfiles.begin()) {
-                     _subfiles.insert(subfiles_it, Subfile(key, size, link));
-                } else
-                if(subfiles_it->key == key) {
-                    *subfiles_it = Subfile(key, size, link);
+                if(subfiles_it != _subfiles.begin() && (subfiles_it - 1)->key == key) {
+                    *(subfiles_it - 1) = Subfile(key, size, link);
+                    return;
                 }
+                _subfiles.insert(subfiles_it, Subfile(key, size, link));
+            }
+            if(&_subfiles != &subfiles || !is_subfiles_index) return;
+            // подфайл добавлен в конец списка, индекс можно дополнить без перестроения
+            if(subfiles.size() > 1 && subfiles.back().key == key) {
+                subfiles_index.resize((size_t)(key - subfiles_index_min_key) + 1, -1);
+                subfiles_index.back() = subfiles.size() - 1;
+                set_subfiles_bitset(key);
+            } else {
+                invalidate_subfiles_index();
             }
         }
 
@@ -190,33 +698,197 @@ namespace xquotes_storage {
             return temp;
         }
 
-        inline void seek(const unsigned long offset, const std::ios::seekdir &origin, std::fstream &_file) {
+        inline void seek(const link_t offset, const std::ios::seekdir &origin, std::fstream &_file) {
             _file.clear();
             _file.seekg(offset, origin);
             _file.clear();
         }
 
+        /** \brief Размеры полей заголовка в файле
+         * \details В формате 4 размеры полей зависят от платформы, в формате 5 они фиксированы
+         */
+        class HeaderFields {
+        public:
+            size_t key;     /**< Ключ подфайла */
+            size_t size;    /**< Размер подфайла или секции */
+            size_t link;    /**< Ссылка */
+            size_t count;   /**< Количество подфайлов или секций */
+            size_t note;    /**< Заметка файла */
+            size_t tag;     /**< Сигнатура и тег секции */
+        };
+
+        /** \brief Получить размеры полей заголовка для текущей версии формата
+         * \return размеры полей заголовка
+         */
+        inline HeaderFields get_header_fields() const {
+            HeaderFields fields;
+            if(file_version == FILE_VERSION_5) {
+                fields.key = sizeof(uint32_t);
+                fields.size = sizeof(uint64_t);
+                fields.link = sizeof(uint64_t);
+                fields.count = sizeof(uint64_t);
+                fields.note = sizeof(uint32_t);
+                fields.tag = sizeof(uint32_t);
+            } else {
+                fields.key = sizeof(key_t);
+                fields.size = sizeof(unsigned long);
+                fields.link = sizeof(unsigned long);
+                fields.count = sizeof(unsigned long);
+                fields.note = sizeof(note_t);
+                fields.tag = sizeof(unsigned long);
+            }
+            return fields;
+        }
+
+        /** \brief Прочитать поле заголовка заданного размера (little-endian)
+         */
+        template<class T>
+        inline void read_field(std::fstream &_file, T &value, const size_t size) {
+            uint64_t data = 0;
+            _file.read(reinterpret_cast<char *>(&data), size);
+            value = (T)data;
+        }
+
+        /** \brief Записать поле заголовка заданного размера (little-endian)
+         */
+        template<class T>
+        inline void write_field(std::fstream &_file, const T &value, const size_t size) {
+            const uint64_t data = (uint64_t)value;
+            _file.write(reinterpret_cast<const char *>(&data), size);
+        }
+
+        /** \brief Записать начало файла
+         * \details В формате 4 это ссылка на заголовок, в формате 5 - сигнатура, версия и ссылка на заголовок
+         * \param _file файл хранилища
+         * \param link_header ссылка на заголовок
+         */
+        void write_file_start(std::fstream &_file, const link_t link_header) {
+            seek(0, std::ios::beg, _file);
+            if(file_version == FILE_VERSION_5) {
+                write_field(_file, FILE_V5_SIGNATURE, sizeof(uint32_t));
+                write_field(_file, FILE_VERSION_5, sizeof(uint32_t));
+                write_field(_file, link_header, sizeof(uint64_t));
+            } else {
+                write_field(_file, link_header, sizeof(unsigned long));
+            }
+        }
+
         void read_header(std::fstream &_file, std::vector<Subfile> &_subfiles) {
-            // прочитаем ссылку на заголовок
+            // определим версию формата по сигнатуре в начале файла
             seek(0, std::ios::beg, _file);
-            unsigned long link_header = 0;
-            _file.read(reinterpret_cast<char *>(&link_header), sizeof(link_header));
+            uint32_t signature = 0, version = 0;
+            _file.read(reinterpret_cast<char *>(&signature), sizeof(signature));
+            _file.read(reinterpret_cast<char *>(&version), sizeof(version));
+            if(_file) file_version = signature == FILE_V5_SIGNATURE && version == FILE_VERSION_5 ? FILE_VERSION_5 : FILE_VERSION_4;
+            const HeaderFields fields = get_header_fields();
+            // прочитаем ссылку на заголовок
+            seek(file_version == FILE_VERSION_5 ? 2 * sizeof(uint32_t) : 0, std::ios::beg, _file);
+            link_t link_header = 0;
+            read_field(_file, link_header, fields.link);
+            // все, что лежит после заголовка, считаем его частью, чтобы не писать туда данные до записи нового заголовка
+            seek(0, std::ios::end, _file);
+            const std::streamoff file_size = _file.tellg();
+            header_link = link_header;
+            header_end = file_size > (std::streamoff)link_header ? (link_t)file_size : link_header;
+            header_data_end = 0;
             // прочитаем количество подфайлов
             seek(link_header, std::ios::beg, _file);
             unsigned long num_subfiles = 0;
-            _file.read(reinterpret_cast<char *>(&num_subfiles), sizeof(num_subfiles));
+            read_field(_file, num_subfiles, fields.count);
+            free_extents.clear();
+            released_extents.clear();
+            header_sections.clear();
+            invalidate_subfiles_index();
             if(num_subfiles == 0) {
                 _subfiles.clear();
                 return;
             }
             _subfiles.resize(num_subfiles);
             for(unsigned long i = 0; i < num_subfiles; ++i) {
-                _file.read(reinterpret_cast<char *>(&_subfiles[i].key), sizeof(key_t));
-                _file.read(reinterpret_cast<char *>(&_subfiles[i].size), sizeof(unsigned long));
-                _file.read(reinterpret_cast<char *>(&_subfiles[i].link), sizeof(link_t));
+                read_field(_file, _subfiles[i].key, fields.key);
+                read_field(_file, _subfiles[i].size, fields.size);
+                read_field(_file, _subfiles[i].link, fields.link);
             }
-            _file.read(reinterpret_cast<char *>(&file_note), sizeof(file_note));
+            read_field(_file, file_note, fields.note);
             sort_subfiles(_subfiles);
+            header_data_end = get_data_end(_subfiles);
+            read_header_sections(_file, link_header);
+        }
+
+        /** \brief Прочитать секции заголовка
+         * \details Секции идут после заметки файла: сигнатура, ссылка на заголовок, количество секций,
+         * затем для каждой секции тег, размер и данные. Ссылка на заголовок защищает от чтения
+         * устаревших секций, оставшихся в файле после записи заголовка старой версией библиотеки
+         * \param _file файл хранилища
+         * \param link_header ссылка на заголовок
+         */
+        void read_header_sections(std::fstream &_file, const link_t link_header) {
+            const HeaderFields fields = get_header_fields();
+            unsigned long signature = 0, num_sections = 0;
+            link_t sections_link_header = 0;
+            read_field(_file, signature, fields.tag);
+            read_field(_file, sections_link_header, fields.link);
+            read_field(_file, num_sections, fields.count);
+            if(!_file || signature != HEADER_SECTIONS_SIGNATURE || sections_link_header != link_header) {
+                _file.clear();
+                return;
+            }
+            for(unsigned long n = 0; n < num_sections; ++n) {
+                unsigned long tag = 0;
+                uint64_t size = 0;
+                read_field(_file, tag, fields.tag);
+                read_field(_file, size, fields.size);
+                if(!_file) break;
+                std::vector<char> data(size);
+                if(size > 0) _file.read(data.data(), size);
+                if(!_file) break;
+                header_sections[tag] = std::move(data);
+            }
+            _file.clear();
+
+            auto it = header_sections.find(HEADER_SECTION_FREE_EXTENTS);
+            if(it != header_sections.end()) {
+                const size_t extent_size = fields.link + fields.size;
+                const size_t num_extents = it->second.size() / extent_size;
+                free_extents.resize(num_extents);
+                const char *data = it->second.data();
+                for(size_t i = 0; i < num_extents; ++i) {
+                    uint64_t link = 0, size = 0;
+                    std::copy(data, data + fields.link, reinterpret_cast<char *>(&link));
+                    data += fields.link;
+                    std::copy(data, data + fields.size, reinterpret_cast<char *>(&size));
+                    data += fields.size;
+                    free_extents[i].link = link;
+                    free_extents[i].size = size;
+                }
+                header_sections.erase(it);
+                check_free_extents();
+            }
+        }
+
+        /** \brief Записать секции заголовка
+         * \param _file файл хранилища
+         * \param link_header ссылка на заголовок
+         * \param _free_extents список свободных участков
+         */
+        void write_header_sections(std::fstream &_file, const link_t link_header, const std::vector<FreeExtent> &_free_extents) {
+            const HeaderFields fields = get_header_fields();
+            write_field(_file, HEADER_SECTIONS_SIGNATURE, fields.tag);
+            write_field(_file, link_header, fields.link);
+            write_field(_file, header_sections.size() + 1, fields.count);
+
+            write_field(_file, HEADER_SECTION_FREE_EXTENTS, fields.tag);
+            write_field(_file, _free_extents.size() * (fields.link + fields.size), fields.size);
+            for(size_t i = 0; i < _free_extents.size(); ++i) {
+                write_field(_file, _free_extents[i].link, fields.link);
+                write_field(_file, _free_extents[i].size, fields.size);
+            }
+
+            for(auto it = header_sections.begin(); it != header_sections.end(); ++it) {
+                write_field(_file, it->first, fields.tag);
+                write_field(_file, it->second.size(), fields.size);
+                if(it->second.size() > 0) _file.write(it->second.data(), it->second.size());
+            }
         }
 
         inline bool open(const std::string &path) {
@@ -224,36 +896,102 @@ namespace xquotes_storage {
             is_write = false; // сбрасываем флаг записи подфайлов
             file = std::fstream(path, std::ios_base::binary | std::ios::in | std::ios::out | std::ios::ate);
             if(!file.is_open()) return false;
+            open_sync_handle(path);
             read_header(file, subfiles);
             is_file_open = true;
             return true;
         }
 
-        void write_header(std::fstream &_file, std::vector<Subfile> &_subfiles) {
-            if(_subfiles.size() == 0) return;
-            sort_subfiles(_subfiles);
-            Subfile *subfile_max_link = get_max_link(_subfiles);
-
-            if(subfile_max_link == NULL) return;
+        /** \brief Получить размер заголовка
+         * \param num_subfiles количество подфайлов
+         * \param num_free_extents количество свободных участков
+         * \return размер заголовка в байтах
+         */
+        link_t get_header_size(const size_t num_subfiles, const size_t num_free_extents) const {
+            const HeaderFields fields = get_header_fields();
+            link_t size = fields.count + num_subfiles * (fields.key + fields.size + fields.link) + fields.note;
+            size += fields.tag + fields.link + fields.count;
+            size += fields.tag + fields.size + num_free_extents * (fields.link + fields.size);
+            for(auto it = header_sections.begin(); it != header_sections.end(); ++it) {
+                size += fields.tag + fields.size + it->second.size();
+            }
+            return size;
+        }
 
-            // запишем позицию ссылки на заголовок
-            unsigned long link_header = subfile_max_link->link + subfile_max_link->size;
+        /** \brief Записать заголовок без ссылки на него в начале файла
+         * \param _file файл хранилища
+         * \param _subfiles список подфайлов
+         * \param _free_extents список свободных участков
+         * \param link_header ссылка на заголовок
+         */
+        void write_header_body(std::fstream &_file, std::vector<Subfile> &_subfiles, const std::vector<FreeExtent> &_free_extents, const link_t link_header) {
+            sort_subfiles(_subfiles);
+            const HeaderFields fields = get_header_fields();
 
-            seek(0, std::ios::beg, _file);
-            _file.write(reinterpret_cast<char *>(&link_header), sizeof(link_header));
             // запишем кол-во файлов
             seek(link_header, std::ios::beg, _file);
             unsigned long num_subfiles = _subfiles.size();
-            _file.write(reinterpret_cast<char *>(&num_subfiles), sizeof(num_subfiles));
+            write_field(_file, num_subfiles, fields.count);
 
             // пишем ссылки и ключи
             for(unsigned long i = 0; i < num_subfiles; ++i) {
-                _file.write(reinterpret_cast<char *>(&_subfiles[i].key), sizeof(key_t));
-                _file.write(reinterpret_cast<char *>(&_subfiles[i].size), sizeof(unsigned long));
-                _file.write(reinterpret_cast<char *>(&_subfiles[i].link), sizeof(link_t));
+                write_field(_file, _subfiles[i].key, fields.key);
+                write_field(_file, _subfiles[i].size, fields.size);
+                write_field(_file, _subfiles[i].link, fields.link);
             }
-            _file.write(reinterpret_cast<char *>(&file_note), sizeof(file_note));
-			_file.flush();
+            write_field(_file, file_note, fields.note);
+            write_header_sections(_file, link_header, _free_extents);
+            _file.flush();
+        }
+
+        void write_header(std::fstream &_file, std::vector<Subfile> &_subfiles, const std::vector<FreeExtent> &_free_extents) {
+            if(_subfiles.size() == 0) return;
+            const link_t link_header = get_data_end(_subfiles);
+            write_header_body(_file, _subfiles, _free_extents, link_header);
+            // ссылку на заголовок пишем после самого заголовка
+            write_file_start(_file, link_header);
+            _file.flush();
+        }
+
+        /** \brief Записать заголовок в файл хранилища
+         * \details Новый заголовок не пересекается с данными и заголовком, на которые ссылается начало файла,
+         * а ссылка на него пишется в начало файла последней. Участки старых версий подфайлов
+         * и место старого заголовка становятся свободными только после записи нового заголовка
+         * \param is_sync сбросить данные на диск до и после записи ссылки на заголовок
+         * \return вернет true в случае успеха
+         */
+        bool commit_header(const bool is_sync = false) {
+            if(subfiles.size() == 0) return true;
+            const std::vector<FreeExtent> old_free_extents = free_extents;
+            std::vector<FreeExtent> old_released_extents;
+            old_released_extents.swap(released_extents);
+            for(size_t i = 0; i < old_released_extents.size(); ++i) {
+                release_extent(old_released_extents[i].link, old_released_extents[i].size);
+            }
+            // место под заголовок выбираем с запасом на освобождение места старого заголовка
+            const link_t max_header_size = get_header_size(subfiles.size(), free_extents.size() + 1);
+            const link_t link_header = get_end_link(max_header_size);
+            if(header_end > header_link && (link_header >= header_end || link_header + max_header_size <= header_link)) {
+                release_extent(header_link, header_end - header_link);
+            }
+            write_header_body(file, subfiles, free_extents, link_header);
+            // данные и заголовок должны попасть на диск раньше ссылки на заголовок
+            bool is_ok = file && (!is_sync || sync_file());
+            if(is_ok) {
+                write_file_start(file, link_header);
+                file.flush();
+                is_ok = file && (!is_sync || sync_file());
+            }
+            if(!is_ok) {
+                file.clear();
+                free_extents = old_free_extents;
+                released_extents.swap(old_released_extents);
+                return false;
+            }
+            header_link = link_header;
+            header_end = link_header + get_header_size(subfiles.size(), free_extents.size());
+            header_data_end = get_data_end(subfiles);
+            return true;
         }
 
         inline bool create_file(const std::string &file_name) {
@@ -263,11 +1001,16 @@ namespace xquotes_storage {
             return true;
         }
 
-        // последний подфайл, который был найден
+        // последний подфайл, найденный методом locate_subfile (поиск идет по прямому индексу, поэтому кэш не нужен)
         unsigned long long last_key_found = 0;
-        unsigned long last_link_found = 0;
+        link_t last_link_found = 0;
         unsigned long last_size_found = 0;
-        bool is_subfile_found = false;
+        const char *last_data_found = NULL;     /**< Данные найденного подфайла, если он еще не записан в файл (пакетная запись) */
+
+        bool is_batch = false;                                      /**< Флаг пакетной записи */
+        std::map<key_t, std::vector<char>> batch_subfiles;          /**< Подфайлы, ожидающие записи в файл */
+        size_t batch_size = 0;                                      /**< Размер данных, ожидающих записи */
+        size_t batch_max_size = 0;                                  /**< Размер данных, при котором пакет будет записан автоматически */
 
         /** \brief Сохранить найденных подфайл (только его параметры!)
          */
@@ -275,24 +1018,76 @@ namespace xquotes_storage {
             last_size_found = subfile->size;
             last_key_found = subfile->key;
             last_link_found = subfile->link;
-            is_subfile_found = true;
+            last_data_found = NULL;
+        }
+
+        /** \brief Сохранить найденный подфайл, ожидающий записи
+         */
+        void save_batch_subfile_found(const key_t key, const std::vector<char> &data) {
+            last_size_found = data.size();
+            last_key_found = key;
+            last_link_found = 0;
+            last_data_found = data.data();
+        }
+
+        /** \brief Найти подфайл и запомнить его параметры
+         * \param key ключ подфайла
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int locate_subfile(const key_t key) {
+            if(is_batch) {
+                auto it = batch_subfiles.find(key);
+                if(it != batch_subfiles.end()) {
+                    save_batch_subfile_found(key, it->second);
+                    return OK;
+                }
+            }
+            if(subfiles.size() == 0) return NO_SUBFILES;
+            Subfile *subfile = find_subfiles(key, subfiles);
+            if(subfile == NULL) return SUBFILES_NOT_FOUND;
+            save_subfile_found(subfile);
+            return OK;
+        }
+
+        /** \brief Прочитать данные последнего найденного подфайла
+         * \details В режиме отображения файла в память данные копируются из отображения,
+         * иначе читаются из файла
+         * \param buffer буфер для чтения подфайла, размер не меньше last_size_found
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int copy_subfile_found(char *buffer) {
+            if(last_data_found != NULL) {
+                std::copy(last_data_found, last_data_found + last_size_found, buffer);
+                return OK;
+            }
+#           if XQUOTES_USE_MMAP == 1
+            if(mapped_file.is_open()) {
+                if((size_t)last_link_found + last_size_found > mapped_file.size()) return DATA_SIZE_ERROR;
+                std::copy(
+                    mapped_file.data() + last_link_found,
+                    mapped_file.data() + last_link_found + last_size_found,
+                    buffer);
+                return OK;
+            }
+#           endif
+            seek(last_link_found, std::ios::beg, file);
+            file.read(buffer, last_size_found);
+            return OK;
         }
 
         int write_subfile_to_beg(const key_t key, const char *buffer, const unsigned long length) {
-            seek(0, std::ios::beg, file);
-            unsigned long temp = 0;
-            file.write(reinterpret_cast<char *>(&temp), sizeof(temp));
+            write_file_start(file, 0);
             file.write(buffer, length);
             file.flush();
-            add_or_update_subfiles(key, length, sizeof(unsigned long), subfiles);
+            add_or_update_subfiles(key, length, get_data_start(), subfiles);
             is_write = true;
             return OK;
         }
 
         int write_subfile_to_end(const key_t key, const char *buffer, const unsigned long length) {
-            Subfile *subfile_max_link = get_max_link(subfiles);
-            if(subfile_max_link == NULL) return INVALID_PARAMETER;
-            unsigned long link = subfile_max_link->link + subfile_max_link->size;
+            if(subfiles.size() == 0) return INVALID_PARAMETER;
+            // сначала ищем подходящий свободный участок, затем пишем в конец области данных
+            link_t link = allocate_extent(length);
             seek(link, std::ios::beg, file);
             file.write(buffer, length);
             file.flush();
@@ -301,81 +1096,181 @@ namespace xquotes_storage {
             return OK;
         }
 
+        /** \brief Перезаписать подфайл
+         * \details Подфайл пишется в первый подходящий свободный участок или в конец файла,
+         * старый участок остается нетронутым и становится свободным после записи заголовка.
+         * Поэтому при сбое до записи заголовка файл хранит старую версию подфайла
+         * \param key ключ подфайла
+         * \param subfile подфайл
+         * \param buffer буфер с данными
+         * \param length размер данных
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
         int rewrite_subfile(const key_t key, const Subfile *subfile, const char *buffer, const unsigned long length) {
-            if(subfile->size != length) {
-                if(is_subfile_found && last_key_found == key) {
-                    is_subfile_found = false;
-                }
-                // находим случайное имя файла
-                int seed = ztime::get_millisecond();
-                std::string temp_file = "";
-                while(true) {
-                    temp_file = get_random_name(seed);
-                    if(!bf::check_file(temp_file)) break;
-                    ++seed;
-                }
-                if(!create_file(temp_file)) return FILE_CANNOT_OPENED;
-
-                /* создаем файл и пишем в него */
-                std::fstream new_file = std::fstream(temp_file, std::ios_base::binary | std::ios::in | std::ios::out | std::ios::ate);
-                if(!new_file) return FILE_CANNOT_OPENED;
-
-                std::vector<Subfile> new_subfiles;
-                unsigned long new_file_link = sizeof(unsigned long);
-                for(size_t i = 0; i < subfiles.size(); ++i) {
-                    if(subfiles[i].key != subfile->key) {
-                        // если это не переписываемый файл, просто копируем его
-                        seek(subfiles[i].link, std::ios::beg, file);
-                        char *copy_buffer = new char[subfiles[i].size];
-                        file.read(copy_buffer, subfiles[i].size);
-                        if(i == 0) {
-                            unsigned long temp = 0;
-                            new_file.write(reinterpret_cast<char *>(&temp), sizeof(unsigned long));
-                            new_file.write(copy_buffer, subfiles[i].size);
-                            add_or_update_subfiles(subfiles[i].key, subfiles[i].size, new_file_link, new_subfiles);
-                        } else {
-                            new_file.write(copy_buffer, subfiles[i].size);
-                            add_or_update_subfiles(subfiles[i].key, subfiles[i].size, new_file_link, new_subfiles);
-                        }
-                        delete [] copy_buffer;
-                        new_file_link += subfiles[i].size;
-                    } else {
-                        // если это переписываемый файл, пишем новые данные в новый файл
-                        if(i == 0) {
-                            unsigned long temp = 0;
-                            new_file.write(reinterpret_cast<char *>(&temp), sizeof(unsigned long));
-                            new_file.write(buffer, length);
-                            add_or_update_subfiles(subfile->key, length, new_file_link, new_subfiles);
-                        } else {
-                            new_file.write(buffer, length);
-                            add_or_update_subfiles(subfile->key, length, new_file_link, new_subfiles);
-                        }
-                        new_file_link += length;
-                    }
+            released_extents.push_back(FreeExtent(subfile->link, subfile->size));
+            const link_t link = allocate_extent(length);
+            seek(link, std::ios::beg, file);
+            file.write(buffer, length);
+            file.flush();
+            add_or_update_subfiles(key, length, link, subfiles);
+            is_write = true;
+            return OK;
+        }
+
+        /** \brief Переписать хранилище без свободных участков
+         * \details Подфайлы копируются во временный файл по порядку ключей,
+         * затем временный файл заменяет файл хранилища
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int compact_file() {
+            // находим случайное имя файла
+            int seed = ztime::get_millisecond();
+            std::string temp_file = "";
+            while(true) {
+                temp_file = get_random_name(seed);
+                if(!bf::check_file(temp_file)) break;
+                ++seed;
+            }
+            if(!create_file(temp_file)) return FILE_CANNOT_OPENED;
+
+            /* создаем файл и пишем в него */
+            std::fstream new_file = std::fstream(temp_file, std::ios_base::binary | std::ios::in | std::ios::out | std::ios::ate);
+            if(!new_file) return FILE_CANNOT_OPENED;
+
+            std::vector<Subfile> new_subfiles;
+            link_t new_file_link = get_data_start();
+            write_file_start(new_file, 0);
+            std::unique_ptr<char[]> copy_buffer;
+            size_t copy_buffer_size = 0;
+            for(size_t i = 0; i < subfiles.size(); ++i) {
+                if(subfiles[i].size > copy_buffer_size) {
+                    copy_buffer_size = subfiles[i].size;
+                    copy_buffer = std::unique_ptr<char[]>(new char[copy_buffer_size]);
                 }
+                seek(subfiles[i].link, std::ios::beg, file);
+                file.read(copy_buffer.get(), subfiles[i].size);
+                new_file.write(copy_buffer.get(), subfiles[i].size);
+                add_or_update_subfiles(subfiles[i].key, subfiles[i].size, new_file_link, new_subfiles);
+                new_file_link += subfiles[i].size;
+            }
 
-                /* запишем заголовок в новый файл */
-                write_header(new_file, new_subfiles);
+            /* запишем заголовок в новый файл */
+            write_header(new_file, new_subfiles, std::vector<FreeExtent>());
 
-                /* закромем все файлы и обнулим флаг открытия файла */
-                new_file.close();
-                file.close();
-                is_file_open = false;
+            /* закромем все файлы и обнулим флаг открытия файла */
+            new_file.close();
+            file.close();
+            close_sync_handle();
+            is_file_open = false;
+
+            int err = 0;
+            if((err = remove(file_name.c_str())) != 0) {
+                //std::cout << "xquotes storage error, what: remove(" << file_name << "), code: " << err << std::endl;
+                return FILE_CANNOT_REMOVED;
+            }
+            if(rename(temp_file.c_str(), file_name.c_str()) != 0) return FILE_CANNOT_RENAMED;
+            if(!open(file_name)) return FILE_CANNOT_OPENED;
+            return OK;
+        }
 
-                int err = 0;
-                if((err = remove(file_name.c_str())) != 0) {
-                    //std::cout << "xquotes storage error, what: remove(" << file_name << "), code: " << err << std::endl;
-                    return FILE_CANNOT_REMOVED;
+        /** \brief Добавить подфайл в пакет записи
+         * \param key ключ подфайла
+         * \param buffer буфер с данными
+         * \param length размер данных
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int write_batch_subfile(const key_t key, const char *buffer, const unsigned long length) {
+            std::vector<char> &data = batch_subfiles[key];
+            batch_size -= data.size();
+            data.assign(buffer, buffer + length);
+            batch_size += length;
+            if(batch_max_size > 0 && batch_size >= batch_max_size) return write_batch();
+            return OK;
+        }
+
+        /** \brief Записать пакет подфайлов в файл
+         * \details Подфайлы пакета пишутся одним непрерывным участком, на который не ссылается
+         * записанный в файл заголовок. Затем заголовок записывается один раз со сбросом данных на диск,
+         * и только после этого старые участки подфайлов становятся свободными
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int write_batch() {
+            if(batch_subfiles.size() == 0) return OK;
+            // находим старые участки подфайлов пакета
+            unsigned long new_size = 0;
+            for(auto it = batch_subfiles.begin(); it != batch_subfiles.end(); ++it) {
+                const Subfile *subfile = find_subfiles(it->first, subfiles);
+                if(subfile != NULL) released_extents.push_back(FreeExtent(subfile->link, subfile->size));
+                new_size += it->second.size();
+            }
+            // пишем подфайлы пакета одним участком
+            link_t link = allocate_extent(new_size);
+            seek(link, std::ios::beg, file);
+            std::vector<Subfile> new_subfiles;
+            new_subfiles.reserve(batch_subfiles.size());
+            for(auto it = batch_subfiles.begin(); it != batch_subfiles.end(); ++it) {
+                file.write(it->second.data(), it->second.size());
+                new_subfiles.push_back(Subfile(it->first, it->second.size(), link));
+                link += it->second.size();
+            }
+            // объединяем отсортированные списки подфайлов за один проход, индекс будет построен один раз
+            std::vector<Subfile> merged_subfiles;
+            merged_subfiles.reserve(subfiles.size() + new_subfiles.size());
+            size_t i = 0;
+            for(size_t j = 0; j < new_subfiles.size(); ++j) {
+                while(i < subfiles.size() && subfiles[i].key < new_subfiles[j].key) {
+                    merged_subfiles.push_back(subfiles[i++]);
                 }
-                if(rename(temp_file.c_str(), file_name.c_str()) != 0) return FILE_CANNOT_RENAMED;
-                if(!open(file_name)) return FILE_CANNOT_OPENED;
-            } else {
-                seek(subfile->link, std::ios::beg, file);
-                file.write(buffer, subfile->size);
+                if(i < subfiles.size() && subfiles[i].key == new_subfiles[j].key) ++i;
+                merged_subfiles.push_back(new_subfiles[j]);
             }
+            merged_subfiles.insert(merged_subfiles.end(), subfiles.begin() + i, subfiles.end());
+            subfiles.swap(merged_subfiles);
+            invalidate_subfiles_index();
+            batch_subfiles.clear();
+            batch_size = 0;
+            if(!commit_header(true)) return NOT_WRITE_FILE;
+            is_write = false;
             return OK;
         }
 
+        /** \brief Сбросить данные файла хранилища на диск
+         * \details Данные сбрасываются через дескриптор, открытый вместе с файлом хранилища
+         * \return вернет true в случае успеха
+         */
+        bool sync_file() {
+            file.flush();
+            if(!file || sync_handle < 0) return false;
+#           if defined(_WIN32) || defined(_WIN64)
+            return _commit(sync_handle) == 0;
+#           else
+            return fsync(sync_handle) == 0;
+#           endif
+        }
+
+        /** \brief Открыть дескриптор для сброса данных на диск
+         */
+        void open_sync_handle(const std::string &path) {
+            close_sync_handle();
+#           if defined(_WIN32) || defined(_WIN64)
+            sync_handle = _open(path.c_str(), _O_RDWR | _O_BINARY);
+#           else
+            sync_handle = ::open(path.c_str(), O_RDWR);
+#           endif
+        }
+
+        /** \brief Закрыть дескриптор для сброса данных на диск
+         */
+        void close_sync_handle() {
+            if(sync_handle < 0) return;
+#           if defined(_WIN32) || defined(_WIN64)
+            _close(sync_handle);
+#           else
+            ::close(sync_handle);
+#           endif
+            sync_handle = -1;
+        }
+
         /* добавляем рассчет crc64 */
 
         const long long poly = 0xC96C5795D7870F42;
@@ -433,6 +1328,9 @@ namespace xquotes_storage {
                 std::fill(dictionary_file_buffer, dictionary_file_buffer + dictionary_file_size, '\0');
                 bf::load_file(dictionary_file, dictionary_file_buffer, dictionary_file_size);
                 is_mem_dict_file = true; // ставим флаг использования памяти под словарь
+#               if XQUOTES_USE_ZSTD == 1
+                update_prepared_dictionary();
+#               endif
             }
         }
 
@@ -448,8 +1346,7 @@ namespace xquotes_storage {
                 if(!create_file(path)) return;
             }
             open(path);
-            dictionary_file_buffer = (char*)dictionary_buffer;
-            dictionary_file_size = dictionary_buffer_size;
+            set_dictionary(dictionary_buffer, dictionary_buffer_size);
         }
 
         /** \brief Инициализировать класс хранилища
@@ -465,8 +1362,7 @@ namespace xquotes_storage {
                 if(!create_file(path)) return false;
             }
             if(!open(path)) return false;
-            dictionary_file_buffer = (char*)dictionary_buffer;
-            dictionary_file_size = dictionary_buffer_size;
+            set_dictionary(dictionary_buffer, dictionary_buffer_size);
             return true;
         }
 
@@ -485,12 +1381,17 @@ namespace xquotes_storage {
         }
 
         /** \brief Инициализировать указатель на словарь
+         * \details Словарь для декомпрессии подготавливается один раз при вызове данного метода.
+         * Буфер словаря должен существовать все время работы хранилища
          * \param dictionary_buffer указатель на буфер словаря
          * \param dictionary_buffer_size размер буфера словаря
          */
         void set_dictionary(const char *dictionary_buffer, const size_t dictionary_buffer_size) {
             dictionary_file_buffer = (char*)dictionary_buffer;
             dictionary_file_size = dictionary_buffer_size;
+#           if XQUOTES_USE_ZSTD == 1
+            update_prepared_dictionary();
+#           endif
         }
 
         /** \brief Получить размер подфайла
@@ -500,16 +1401,10 @@ namespace xquotes_storage {
          * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
          */
         int get_subfile_size(const key_t key, unsigned long &size) {
-            if(subfiles.size() == 0) return NO_SUBFILES;
-            if(is_subfile_found && last_key_found == key) {
-                size = last_size_found;
-                return OK;
-            }
-            Subfile *subfile = find_subfiles(key, subfiles);
-            if(subfile == NULL) return SUBFILES_NOT_FOUND;
-            size = subfile->size;
             // запоминаем найденный файл
-            save_subfile_found(subfile);
+            int err = locate_subfile(key);
+            if(err != OK) return err;
+            size = last_size_found;
             return OK;
         }
 
@@ -522,26 +1417,11 @@ namespace xquotes_storage {
          */
         int read_subfile(const key_t key, char *&buffer, unsigned long &buffer_size) {
             if(!is_file_open) return FILE_NOT_OPENED;
-            // если ранее мы уже нашли подфайл
-            if(is_subfile_found && last_key_found == key) {
-                seek(last_link_found, std::ios::beg, file);
-                if(buffer == NULL) buffer = new char[last_size_found];
-                file.read(buffer, last_size_found);
-				buffer_size = last_size_found;
-                return OK;
-            }
-
-            if(subfiles.size() == 0) return NO_SUBFILES;
-            Subfile *subfile = find_subfiles(key, subfiles);
-            if(subfile == NULL) return SUBFILES_NOT_FOUND;
-
-            // запоминаем найденный подфайл
-            save_subfile_found(subfile);
+            int err = locate_subfile(key);
+            if(err != OK) return err;
             buffer_size = last_size_found;
-            seek(subfile->link, std::ios::beg, file);
             if(buffer == NULL) buffer = new char[last_size_found];
-            file.read(buffer, subfile->size);
-            return OK;
+            return copy_subfile_found(buffer);
         }
 
         /** \brief Прочитать подфайл
@@ -558,38 +1438,143 @@ namespace xquotes_storage {
                 size_t &read_buffer_size,
                 unsigned long &buffer_size) {
             if(!is_file_open) return FILE_NOT_OPENED;
-            // если ранее мы уже нашли подфайл
-            if(is_subfile_found && last_key_found == key) {
-                seek(last_link_found, std::ios::beg, file);
-                if(last_size_found > read_buffer_size) {
-                    read_buffer = std::unique_ptr<char[]>(new char[last_size_found]);
-                    read_buffer_size = last_size_found;
-                }
-                file.read(read_buffer.get(), last_size_found);
-				buffer_size = last_size_found;
-                return OK;
-            }
-
-            if(subfiles.size() == 0) return NO_SUBFILES;
-            Subfile *subfile = find_subfiles(key, subfiles);
-            if(subfile == NULL) return SUBFILES_NOT_FOUND;
-
-            // запоминаем найденный подфайл
-            save_subfile_found(subfile);
-            seek(subfile->link, std::ios::beg, file);
-
+            int err = locate_subfile(key);
+            if(err != OK) return err;
             if(last_size_found > read_buffer_size) {
                 read_buffer = std::unique_ptr<char[]>(new char[last_size_found]);
                 read_buffer_size = last_size_found;
             }
-            file.read(read_buffer.get(), subfile->size);
-			buffer_size = last_size_found;
+            buffer_size = last_size_found;
+            return copy_subfile_found(read_buffer.get());
+        }
+
+        /** \brief Получить данные подфайла без копирования
+         * \details В режиме отображения файла в память (см. enable_mmap) указатель data
+         * будет указывать прямо на данные подфайла внутри отображения.
+         * Иначе подфайл будет прочитан во внутренний буфер класса.
+         * \warning Указатель действителен до следующего чтения, записи или закрытия хранилища!
+         * \param key ключ подфайла
+         * \param data указатель на данные подфайла
+         * \param buffer_size сюда будет помещен размер подфайла
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int read_subfile_view(const key_t key, const char *&data, unsigned long &buffer_size) {
+            if(!is_file_open) return FILE_NOT_OPENED;
+            int err = locate_subfile(key);
+            if(err != OK) return err;
+            buffer_size = last_size_found;
+            if(last_data_found != NULL) {
+                data = last_data_found;
+                return OK;
+            }
+#           if XQUOTES_USE_MMAP == 1
+            if(mapped_file.is_open()) {
+                if((size_t)last_link_found + last_size_found > mapped_file.size()) return DATA_SIZE_ERROR;
+                data = mapped_file.data() + last_link_found;
+                return OK;
+            }
+#           endif
+            increase_input_subfile_buffer_size(last_size_found);
+            err = copy_subfile_found(input_subfile_buffer.get());
+            data = input_subfile_buffer.get();
+            return err;
+        }
+
+        /** \brief Найти кадр в подфайле, разбитом на кадры
+         * \details Подфайл с кадрами начинается с количества кадров (uint32_t)
+         * и таблицы смещений концов кадров (uint32_t на кадр, отсчет от конца таблицы), затем идут сами кадры
+         * \param subfile данные подфайла
+         * \param subfile_size размер подфайла
+         * \param frame номер кадра
+         * \param frame_data указатель на данные кадра
+         * \param frame_size размер кадра
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        static int find_subfile_frame(
+                const char *subfile,
+                const unsigned long subfile_size,
+                const size_t frame,
+                const char *&frame_data,
+                unsigned long &frame_size) {
+            uint32_t num_frames = 0;
+            if(subfile_size < sizeof(num_frames)) return DATA_SIZE_ERROR;
+            std::memcpy(&num_frames, subfile, sizeof(num_frames));
+            if(frame >= num_frames) return INVALID_PARAMETER;
+            const size_t table_size = sizeof(uint32_t) * (1 + (size_t)num_frames);
+            if(subfile_size < table_size) return DATA_SIZE_ERROR;
+            uint32_t frame_beg = 0, frame_end = 0;
+            if(frame > 0) std::memcpy(&frame_beg, subfile + sizeof(uint32_t) * frame, sizeof(frame_beg));
+            std::memcpy(&frame_end, subfile + sizeof(uint32_t) * (frame + 1), sizeof(frame_end));
+            if(frame_beg > frame_end || table_size + frame_end > subfile_size) return DATA_SIZE_ERROR;
+            frame_data = subfile + table_size + frame_beg;
+            frame_size = frame_end - frame_beg;
             return OK;
         }
 
+        /** \brief Записать подфайл, разбитый на кадры
+         * \details Кадры можно читать независимо друг от друга методом read_subfile_frame_view
+         * \param key ключ подфайла
+         * \param frames массив указателей на данные кадров
+         * \param frames_size массив размеров кадров
+         * \param num_frames количество кадров
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int write_subfile_frames(
+                const key_t key,
+                const char *const *frames,
+                const unsigned long *frames_size,
+                const size_t num_frames) {
+            const size_t table_size = sizeof(uint32_t) * (1 + num_frames);
+            size_t subfile_size = table_size;
+            for(size_t i = 0; i < num_frames; ++i) subfile_size += frames_size[i];
+            increase_compressed_file_buffer_size(subfile_size);
+            char *subfile = compressed_file_buffer.get();
+            const uint32_t frames_count = num_frames;
+            std::memcpy(subfile, &frames_count, sizeof(frames_count));
+            uint32_t frame_end = 0;
+            for(size_t i = 0; i < num_frames; ++i) {
+                std::memcpy(subfile + table_size + frame_end, frames[i], frames_size[i]);
+                frame_end += frames_size[i];
+                std::memcpy(subfile + sizeof(uint32_t) * (i + 1), &frame_end, sizeof(frame_end));
+            }
+            return write_subfile(key, subfile, subfile_size);
+        }
+
+        /** \brief Получить указатель на кадр подфайла без копирования
+         * \warning Указатель действителен до следующего чтения, записи или закрытия хранилища!
+         * \param key ключ подфайла
+         * \param frame номер кадра
+         * \param data указатель на данные кадра
+         * \param buffer_size размер кадра
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int read_subfile_frame_view(const key_t key, const size_t frame, const char *&data, unsigned long &buffer_size) {
+            const char *subfile = NULL;
+            unsigned long subfile_size = 0;
+            int err = read_subfile_view(key, subfile, subfile_size);
+            if(err != OK) return err;
+            return find_subfile_frame(subfile, subfile_size, frame, data, buffer_size);
+        }
+
+        /** \brief Получить указатель на кадр подфайла в режиме конкурентного чтения
+         * \param key ключ подфайла
+         * \param frame номер кадра
+         * \param data указатель на данные кадра
+         * \param buffer_size размер кадра
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int read_subfile_frame_view_concurrent(const key_t key, const size_t frame, const char *&data, unsigned long &buffer_size) const {
+            const char *subfile = NULL;
+            unsigned long subfile_size = 0;
+            int err = read_subfile_view_concurrent(key, subfile, subfile_size);
+            if(err != OK) return err;
+            return find_subfile_frame(subfile, subfile_size, frame, data, buffer_size);
+        }
+
         /** \brief Записать подфайл
-         * \warning Если требуется перезаписать старый подфайл, размер которого изменился,
-         * данный метод может создать временный файл для копирования данных!
+         * \details Если размер перезаписываемого подфайла изменился, данные пишутся на месте
+         * или в свободный участок файла, остальные подфайлы не копируются.
+         * Для удаления свободных участков из файла используйте метод compact
          * \param key ключ подфайла
          * \param buffer буфер для записи файла
          * \param buffer_size размер буфера (размер подфайла)
@@ -597,6 +1582,8 @@ namespace xquotes_storage {
          */
         int write_subfile(const key_t key, const char *buffer, const unsigned long &buffer_size) {
             if(!is_file_open) return FILE_NOT_OPENED;
+            if(is_read_only()) return NOT_WRITE_FILE;
+            if(is_batch) return write_batch_subfile(key, buffer, buffer_size);
             if(subfiles.size() == 0) {
                 return write_subfile_to_beg(key, buffer, buffer_size);
             }
@@ -609,17 +1596,59 @@ namespace xquotes_storage {
             return OK;
         }
 
+        /** \brief Начать пакетную запись
+         * \details Подфайлы, записанные после вызова метода, хранятся в памяти до вызова commit.
+         * Методы чтения и проверки подфайлов видят данные пакета. Методы, перечисляющие подфайлы
+         * (get_num_subfiles, get_key_subfiles, get_subfile_list, get_min_max_key), видят только записанные в файл подфайлы.
+         * При закрытии хранилища пакет записывается автоматически
+         * \param max_size размер данных пакета, при достижении которого пакет будет записан в файл (0 - без ограничения).
+         * Каждая такая запись сбрасывает данные на диск, как и вызов commit
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int begin_batch(const size_t max_size = 0) {
+            if(!is_file_open) return FILE_NOT_OPENED;
+            if(is_read_only()) return NOT_WRITE_FILE;
+            is_batch = true;
+            batch_max_size = max_size;
+            return OK;
+        }
+
+        /** \brief Завершить пакетную запись
+         * \details Подфайлы пакета пишутся в файл одним непрерывным участком,
+         * заголовок записывается один раз, затем данные сбрасываются на диск
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int commit() {
+            if(!is_batch) return OK;
+            is_batch = false;
+            return write_batch();
+        }
+
+        /** \brief Проверить режим пакетной записи
+         * \return вернет true, если начата пакетная запись
+         */
+        inline bool is_batch_mode() const {
+            return is_batch;
+        }
+
         /** \brief Проверить наличие файла
          * \param key ключ подфайла
          * \return вернет true если файл найден
          */
         bool check_subfile(const key_t key) {
-            if(subfiles.size() == 0) return false;
-            if(is_subfile_found && last_key_found == key) return true;
-            const Subfile *subfile = find_subfiles(key, subfiles);
-            if(subfile == NULL) return false;
-            save_subfile_found(subfile);
-            return true;
+            return locate_subfile(key) == OK;
+        }
+
+        /** \brief Получить битовую карту подфайлов
+         * \details Бит (key - first_key) % 64 слова (key - first_key) / 64 установлен, если есть подфайл с ключом key.
+         * Ключ first_key кратен 64, поэтому карты разных хранилищ можно объединять пословно
+         * \param first_key ключ первого бита карты
+         * \return битовая карта, действительная до изменения списка подфайлов
+         */
+        const std::vector<uint64_t> &get_subfiles_bitset(key_t &first_key) {
+            if(!is_subfiles_index) build_subfiles_index();
+            first_key = subfiles_bitset_first_key;
+            return subfiles_bitset;
         }
 
         /** \brief Получить список подфайлов, начинаюбщихся с определенного ключа
@@ -637,17 +1666,20 @@ namespace xquotes_storage {
                 bool (*f)(const key_t &key) = NULL,
                 const bool &is_go_to_beg = true) {
             if(subfiles.size() == 0) return DATA_NOT_AVAILABLE;
-            auto subfiles_it = std::lower_bound(
-                subfiles.begin(),
-                subfiles.end(),
-                key,
-                [](const Subfile &lhs, const key_t &key) {
-                return lhs.key < key;
-            });
-            if(subfiles_it == subfiles.end()) {
-                return DATA_NOT_AVAILABLE;
+            int ind = get_subfile_index(key);
+            if(ind < 0) {
+                auto subfiles_it = std::lower_bound(
+                    subfiles.begin(),
+                    subfiles.end(),
+                    key,
+                    [](const Subfile &lhs, const key_t &key) {
+                    return lhs.key < key;
+                });
+                if(subfiles_it == subfiles.end()) {
+                    return DATA_NOT_AVAILABLE;
+                }
+                ind = (int)(subfiles_it - subfiles.begin());
             }
-            int ind = (int)(subfiles_it - subfiles.begin());
             list_subfile.clear();
             if(is_go_to_beg) {
                 if(ind > 0 && subfiles[ind].key > key) {
@@ -702,28 +1734,18 @@ namespace xquotes_storage {
             //char *compressed_file_buffer = new char[compressed_file_size];
             std::fill(compressed_file_buffer.get(), compressed_file_buffer.get() + new_compressed_file_size, '\0');
 
-            ZSTD_CCtx* const cctx = ZSTD_createCCtx();
-            size_t compressed_size = ZSTD_compress_usingDict(
-                cctx,
+            size_t compressed_size = compress_using_prepared_dictionary(
                 compressed_file_buffer.get(),
                 new_compressed_file_size,
                 buffer,
                 buffer_size,
-                dictionary_file_buffer,
-                dictionary_file_size,
-                compress_level
-                );
+                compress_level);
 
             if(ZSTD_isError(compressed_size)) {
                 //std::cout << "compression error: " << ZSTD_getErrorName(compress_size) << std::endl;
-                ZSTD_freeCCtx(cctx);
-                //delete [] compressed_file_buffer;
                 return SUBFILES_COMPRESSION_ERROR;
             }
-            int err = write_subfile(key, compressed_file_buffer.get(), compressed_size);
-            ZSTD_freeCCtx(cctx);
-            //delete [] compressed_file_buffer;
-            return err;
+            return write_subfile(key, compressed_file_buffer.get(), compressed_size);
         }
 
         /** \brief Прочитать сжатый подфайл
@@ -736,23 +1758,13 @@ namespace xquotes_storage {
          */
         int read_compressed_subfile(const key_t key, char *&buffer, unsigned long& buffer_size) {
             if(!is_file_open) return FILE_NOT_OPENED;
-            if(subfiles.size() == 0) return NO_SUBFILES;
-            //char *input_subfile_buffer = NULL;
-            // если ранее мы уже нашли подфайл
-            if(is_subfile_found && last_key_found == key) {
-                increase_input_subfile_buffer_size(last_size_found);
-                seek(last_link_found, std::ios::beg, file);
-                file.read(input_subfile_buffer.get(), last_size_found);
-            } else {
-                Subfile *subfile = find_subfiles(key, subfiles);
-                if(subfile == NULL) return SUBFILES_NOT_FOUND;
-                increase_input_subfile_buffer_size(subfile->size);
-                seek(subfile->link, std::ios::beg, file);
-                file.read(input_subfile_buffer.get(), subfile->size);
-                save_subfile_found(subfile);
-            }
+            // в режиме отображения файла в память распаковываем прямо из отображения
+            const char *input_subfile = NULL;
+            unsigned long input_subfile_size = 0;
+            int err = read_subfile_view(key, input_subfile, input_subfile_size);
+            if(err != OK) return err;
 
-            const unsigned long long decompress_file_size = ZSTD_getFrameContentSize(input_subfile_buffer.get(), last_size_found);
+            const unsigned long long decompress_file_size = ZSTD_getFrameContentSize(input_subfile, input_subfile_size);
             if(decompress_file_size == ZSTD_CONTENTSIZE_ERROR) {
                 return NOT_DECOMPRESS_FILE;
             } else
@@ -767,20 +1779,14 @@ namespace xquotes_storage {
             }
             std::fill(buffer, buffer + decompress_file_size, '\0');
 
-            // на данном этапе переменная last_size_found в любом случае будет содержать размер файла
-            ZSTD_DCtx* const dctx = ZSTD_createDCtx();
-            const size_t subfile_size = ZSTD_decompress_usingDict(
-                dctx,
+            const size_t subfile_size = decompress_using_prepared_dictionary(
                 buffer,
                 decompress_file_size,
-                input_subfile_buffer.get(),
-                last_size_found,
-                dictionary_file_buffer,
-                dictionary_file_size);
+                input_subfile,
+                input_subfile_size);
 
             if(ZSTD_isError(subfile_size)) {
                 //std::cout << "error decompressin: " << ZSTD_getErrorName(subfile_size) << std::endl;
-                ZSTD_freeDCtx(dctx);
                 if(is_init_buffer) {
                     delete [] buffer;
                     buffer =  NULL;
@@ -789,7 +1795,6 @@ namespace xquotes_storage {
                 return NOT_DECOMPRESS_FILE;
             }
             buffer_size = subfile_size;
-            ZSTD_freeDCtx(dctx);
             return OK;
         }
 
@@ -808,23 +1813,13 @@ namespace xquotes_storage {
                 size_t &read_buffer_size,
                 unsigned long& buffer_size) {
             if(!is_file_open) return FILE_NOT_OPENED;
-            if(subfiles.size() == 0) return NO_SUBFILES;
-            //char *input_subfile_buffer = NULL;
-            // если ранее мы уже нашли подфайл
-            if(is_subfile_found && last_key_found == key) {
-                increase_input_subfile_buffer_size(last_size_found);
-                seek(last_link_found, std::ios::beg, file);
-                file.read(input_subfile_buffer.get(), last_size_found);
-            } else {
-                Subfile *subfile = find_subfiles(key, subfiles);
-                if(subfile == NULL) return SUBFILES_NOT_FOUND;
-                increase_input_subfile_buffer_size(subfile->size);
-                seek(subfile->link, std::ios::beg, file);
-                file.read(input_subfile_buffer.get(), subfile->size);
-                save_subfile_found(subfile);
-            }
+            // в режиме отображения файла в память распаковываем прямо из отображения
+            const char *input_subfile = NULL;
+            unsigned long input_subfile_size = 0;
+            int err = read_subfile_view(key, input_subfile, input_subfile_size);
+            if(err != OK) return err;
 
-            const unsigned long long decompress_file_size = ZSTD_getFrameContentSize(input_subfile_buffer.get(), last_size_found);
+            const unsigned long long decompress_file_size = ZSTD_getFrameContentSize(input_subfile, input_subfile_size);
             if(decompress_file_size == ZSTD_CONTENTSIZE_ERROR) {
                 return NOT_DECOMPRESS_FILE;
             } else
@@ -839,44 +1834,353 @@ namespace xquotes_storage {
             char *buffer = read_buffer.get();
             std::fill(buffer, buffer + decompress_file_size, '\0');
 
-            // на данном этапе переменная last_size_found в любом случае будет содержать размер файла
-            ZSTD_DCtx* const dctx = ZSTD_createDCtx();
-            const size_t subfile_size = ZSTD_decompress_usingDict(
-                dctx,
+            const size_t subfile_size = decompress_using_prepared_dictionary(
                 buffer,
                 decompress_file_size,
-                input_subfile_buffer.get(),
-                last_size_found,
-                dictionary_file_buffer,
-                dictionary_file_size);
+                input_subfile,
+                input_subfile_size);
 
             if(ZSTD_isError(subfile_size)) {
                 //std::cout << "error decompressin: " << ZSTD_getErrorName(subfile_size) << std::endl;
-                ZSTD_freeDCtx(dctx);
                 buffer_size = 0;
                 return NOT_DECOMPRESS_FILE;
             }
             buffer_size = subfile_size;
-            ZSTD_freeDCtx(dctx);
+            return OK;
+        }
+
+        /** \brief Прочитать сжатый подфайл в режиме конкурентного чтения
+         * \details Метод можно вызывать из нескольких потоков одновременно.
+         * Каждый поток использует свой контекст декомпрессии и общий подготовленный словарь
+         * \param key ключ подфайла
+         * \param read_buffer буфер для чтения
+         * \param read_buffer_size размер буфера для чтения
+         * \param buffer_size размер распакованного подфайла
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int read_compressed_subfile_concurrent(
+                const key_t key,
+                std::unique_ptr<char[]> &read_buffer,
+                size_t &read_buffer_size,
+                unsigned long& buffer_size) const {
+            const char *input_subfile = NULL;
+            unsigned long input_subfile_size = 0;
+            int err = read_subfile_view_concurrent(key, input_subfile, input_subfile_size);
+            if(err != OK) return err;
+
+            const unsigned long long decompress_file_size = ZSTD_getFrameContentSize(input_subfile, input_subfile_size);
+            if(decompress_file_size == ZSTD_CONTENTSIZE_ERROR) {
+                return NOT_DECOMPRESS_FILE;
+            } else
+            if(decompress_file_size == ZSTD_CONTENTSIZE_UNKNOWN) {
+                return NOT_DECOMPRESS_FILE;
+            }
+
+            if(decompress_file_size > read_buffer_size) {
+                read_buffer = std::unique_ptr<char[]>(new char[decompress_file_size]);
+                read_buffer_size = decompress_file_size;
+            }
+            char *buffer = read_buffer.get();
+
+            ThreadReadContext &context = get_thread_read_context();
+            if(context.dctx == NULL) context.dctx = ZSTD_createDCtx();
+            const size_t subfile_size = ddict ?
+                ZSTD_decompress_usingDDict(context.dctx, buffer, decompress_file_size, input_subfile, input_subfile_size, ddict.get()) :
+                ZSTD_decompress_usingDict(context.dctx, buffer, decompress_file_size, input_subfile, input_subfile_size, dictionary_file_buffer, dictionary_file_size);
+
+            if(ZSTD_isError(subfile_size)) {
+                buffer_size = 0;
+                return NOT_DECOMPRESS_FILE;
+            }
+            buffer_size = subfile_size;
+            return OK;
+        }
+
+        /** \brief Записать подфайл, разбитый на сжатые кадры
+         * \details Каждый кадр сжимается отдельно с использованием словаря,
+         * поэтому для чтения одного кадра не нужно распаковывать остальные
+         * \param key ключ подфайла
+         * \param frames массив указателей на данные кадров
+         * \param frames_size массив размеров кадров (до компрессии)
+         * \param num_frames количество кадров
+         * \param compress_level уровень сжатия, по умолчанию максимальный
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int write_compressed_subfile_frames(
+                const key_t key,
+                const char *const *frames,
+                const unsigned long *frames_size,
+                const size_t num_frames,
+                int compress_level = ZSTD_maxCLevel()) {
+            if(!is_file_open) return FILE_NOT_OPENED;
+            size_t frames_bound = 0;
+            for(size_t i = 0; i < num_frames; ++i) frames_bound += ZSTD_compressBound(frames_size[i]);
+            increase_input_subfile_buffer_size(frames_bound);
+            std::vector<const char*> compressed_frames(num_frames);
+            std::vector<unsigned long> compressed_frames_size(num_frames);
+            size_t offset = 0;
+            for(size_t i = 0; i < num_frames; ++i) {
+                const size_t compressed_size = compress_using_prepared_dictionary(
+                    input_subfile_buffer.get() + offset,
+                    frames_bound - offset,
+                    frames[i],
+                    frames_size[i],
+                    compress_level);
+                if(ZSTD_isError(compressed_size)) return SUBFILES_COMPRESSION_ERROR;
+                compressed_frames[i] = input_subfile_buffer.get() + offset;
+                compressed_frames_size[i] = compressed_size;
+                offset += compressed_size;
+            }
+            return write_subfile_frames(key, compressed_frames.data(), compressed_frames_size.data(), num_frames);
+        }
+
+        /** \brief Прочитать и распаковать один кадр подфайла
+         * \param key ключ подфайла
+         * \param frame номер кадра
+         * \param read_buffer буфер для чтения
+         * \param read_buffer_size размер буфера для чтения, внутри метода может только увеличиться!
+         * \param buffer_size размер распакованного кадра
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int read_compressed_subfile_frame(
+                const key_t key,
+                const size_t frame,
+                std::unique_ptr<char[]> &read_buffer,
+                size_t &read_buffer_size,
+                unsigned long& buffer_size) {
+            const char *input_frame = NULL;
+            unsigned long input_frame_size = 0;
+            int err = read_subfile_frame_view(key, frame, input_frame, input_frame_size);
+            if(err != OK) return err;
+            return decompress_subfile_frame(input_frame, input_frame_size, read_buffer, read_buffer_size, buffer_size);
+        }
+
+        /** \brief Распаковать кадр подфайла
+         * \details Кадр можно найти в подфайле методом find_subfile_frame
+         * \param input_frame сжатые данные кадра
+         * \param input_frame_size размер сжатого кадра
+         * \param read_buffer буфер для распакованного кадра
+         * \param read_buffer_size размер буфера, внутри метода может только увеличиться!
+         * \param buffer_size размер распакованного кадра
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int decompress_subfile_frame(
+                const char *input_frame,
+                const unsigned long input_frame_size,
+                std::unique_ptr<char[]> &read_buffer,
+                size_t &read_buffer_size,
+                unsigned long& buffer_size) {
+            const unsigned long long decompress_frame_size = ZSTD_getFrameContentSize(input_frame, input_frame_size);
+            if(decompress_frame_size == ZSTD_CONTENTSIZE_ERROR || decompress_frame_size == ZSTD_CONTENTSIZE_UNKNOWN) {
+                return NOT_DECOMPRESS_FILE;
+            }
+            if(decompress_frame_size > read_buffer_size) {
+                read_buffer = std::unique_ptr<char[]>(new char[decompress_frame_size]);
+                read_buffer_size = decompress_frame_size;
+            }
+            const size_t frame_size = decompress_using_prepared_dictionary(
+                read_buffer.get(),
+                decompress_frame_size,
+                input_frame,
+                input_frame_size);
+            if(ZSTD_isError(frame_size)) {
+                buffer_size = 0;
+                return NOT_DECOMPRESS_FILE;
+            }
+            buffer_size = frame_size;
+            return OK;
+        }
+
+        /** \brief Прочитать и распаковать один кадр подфайла в режиме конкурентного чтения
+         * \param key ключ подфайла
+         * \param frame номер кадра
+         * \param read_buffer буфер для чтения
+         * \param read_buffer_size размер буфера для чтения
+         * \param buffer_size размер распакованного кадра
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int read_compressed_subfile_frame_concurrent(
+                const key_t key,
+                const size_t frame,
+                std::unique_ptr<char[]> &read_buffer,
+                size_t &read_buffer_size,
+                unsigned long& buffer_size) const {
+            const char *input_frame = NULL;
+            unsigned long input_frame_size = 0;
+            int err = read_subfile_frame_view_concurrent(key, frame, input_frame, input_frame_size);
+            if(err != OK) return err;
+            return decompress_subfile_frame_concurrent(input_frame, input_frame_size, read_buffer, read_buffer_size, buffer_size);
+        }
+
+        /** \brief Распаковать кадр подфайла в режиме конкурентного чтения
+         * \param input_frame сжатые данные кадра
+         * \param input_frame_size размер сжатого кадра
+         * \param read_buffer буфер для распакованного кадра
+         * \param read_buffer_size размер буфера
+         * \param buffer_size размер распакованного кадра
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int decompress_subfile_frame_concurrent(
+                const char *input_frame,
+                const unsigned long input_frame_size,
+                std::unique_ptr<char[]> &read_buffer,
+                size_t &read_buffer_size,
+                unsigned long& buffer_size) const {
+            const unsigned long long decompress_frame_size = ZSTD_getFrameContentSize(input_frame, input_frame_size);
+            if(decompress_frame_size == ZSTD_CONTENTSIZE_ERROR || decompress_frame_size == ZSTD_CONTENTSIZE_UNKNOWN) {
+                return NOT_DECOMPRESS_FILE;
+            }
+            if(decompress_frame_size > read_buffer_size) {
+                read_buffer = std::unique_ptr<char[]>(new char[decompress_frame_size]);
+                read_buffer_size = decompress_frame_size;
+            }
+            ThreadReadContext &context = get_thread_read_context();
+            if(context.dctx == NULL) context.dctx = ZSTD_createDCtx();
+            const size_t frame_size = ddict ?
+                ZSTD_decompress_usingDDict(context.dctx, read_buffer.get(), decompress_frame_size, input_frame, input_frame_size, ddict.get()) :
+                ZSTD_decompress_usingDict(context.dctx, read_buffer.get(), decompress_frame_size, input_frame, input_frame_size, dictionary_file_buffer, dictionary_file_size);
+            if(ZSTD_isError(frame_size)) {
+                buffer_size = 0;
+                return NOT_DECOMPRESS_FILE;
+            }
+            buffer_size = frame_size;
             return OK;
         }
 #       endif // XQUOTES_USE_ZSTD
 
+        /** \brief Включить режим отображения файла в память
+         * \details В данном режиме хранилище доступно только для чтения.
+         * Методы read_subfile, read_compressed_subfile и read_subfile_view
+         * читают данные прямо из отображения без системных вызовов чтения файла.
+         * Если до включения режима были записаны подфайлы, заголовок будет сохранен.
+         * \return вернет true, если режим включен
+         */
+        bool enable_mmap() {
+#           if XQUOTES_USE_MMAP == 1
+            if(!is_file_open) return false;
+            if(mapped_file.is_open()) return true;
+            commit();
+            if(is_write) {
+                commit_header();
+                is_write = false;
+            }
+            file.flush();
+            return mapped_file.open(file_name);
+#           else
+            return false;
+#           endif
+        }
+
+        /** \brief Выключить режим отображения файла в память
+         */
+        void disable_mmap() {
+#           if XQUOTES_USE_MMAP == 1
+            mapped_file.close();
+            if(is_concurrent && !concurrent_file.is_open() && !concurrent_file.open(file_name)) disable_concurrent_read();
+#           endif
+        }
+
+        /** \brief Проверить режим отображения файла в память
+         * \return вернет true, если файл отображен в память
+         */
+        inline bool is_mmap() const {
+#           if XQUOTES_USE_MMAP == 1
+            return mapped_file.is_open();
+#           else
+            return false;
+#           endif
+        }
+
+        /** \brief Включить режим конкурентного чтения
+         * \details В данном режиме хранилище доступно только для чтения.
+         * Методы read_subfile_concurrent и read_compressed_subfile_concurrent используют
+         * неизменяемый снимок заголовка, позиционное чтение (или отображение файла в память, если оно включено)
+         * и буферы текущего потока, поэтому их можно вызывать из нескольких потоков одновременно.
+         * Остальные методы чтения по-прежнему не являются потокобезопасными
+         * \return вернет true, если режим включен
+         */
+        bool enable_concurrent_read() {
+            if(!is_file_open) return false;
+            if(is_concurrent) return true;
+            commit();
+            if(is_write) {
+                commit_header();
+                is_write = false;
+            }
+            file.flush();
+            if(!is_mmap() && !concurrent_file.open(file_name)) return false;
+            std::atomic_store(&subfiles_snapshot, std::shared_ptr<const std::vector<Subfile>>(new std::vector<Subfile>(subfiles)));
+            is_concurrent = true;
+            return true;
+        }
+
+        /** \brief Выключить режим конкурентного чтения
+         * \warning Метод нельзя вызывать, пока другие потоки читают подфайлы
+         */
+        void disable_concurrent_read() {
+            is_concurrent = false;
+            concurrent_file.close();
+            std::atomic_store(&subfiles_snapshot, std::shared_ptr<const std::vector<Subfile>>());
+        }
+
+        /** \brief Проверить режим конкурентного чтения
+         * \return вернет true, если включен режим конкурентного чтения
+         */
+        inline bool is_concurrent_read() const {
+            return is_concurrent;
+        }
+
+        /** \brief Проверить, доступно ли хранилище только для чтения
+         * \return вернет true, если включен режим отображения в память или конкурентного чтения
+         */
+        inline bool is_read_only() const {
+            return is_mmap() || is_concurrent;
+        }
+
+        /** \brief Прочитать подфайл в режиме конкурентного чтения
+         * \details Метод можно вызывать из нескольких потоков одновременно
+         * \param key ключ подфайла
+         * \param read_buffer буфер для чтения
+         * \param read_buffer_size размер буфера для чтения
+         * \param buffer_size размер подфайла
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int read_subfile_concurrent(
+                const key_t key,
+                std::unique_ptr<char[]> &read_buffer,
+                size_t &read_buffer_size,
+                unsigned long &buffer_size) const {
+            const char *data = NULL;
+            int err = read_subfile_view_concurrent(key, data, buffer_size);
+            if(err != OK) return err;
+            if(buffer_size > read_buffer_size) {
+                read_buffer = std::unique_ptr<char[]>(new char[buffer_size]);
+                read_buffer_size = buffer_size;
+            }
+            std::copy(data, data + buffer_size, read_buffer.get());
+            return OK;
+        }
+
         /** \brief Сохранить файл хранилища
          */
         void save() {
             if(file.is_open()) {
-                if(is_write) write_header(file, subfiles);
+                commit();
+                if(is_write) commit_header();
             }
         }
 
         /** \brief Закрыть файл хранилища
          */
         virtual void close() {
+            disable_concurrent_read();
+            disable_mmap();
             if(file.is_open()) {
-                if(is_write) write_header(file, subfiles);
+                commit();
+                if(is_write) commit_header();
                 file.close();
             }
+            close_sync_handle();
         }
 
         /** \brief Получить минимальный и максимальный ключ подфайлов
@@ -886,20 +2190,9 @@ namespace xquotes_storage {
          */
         int get_min_max_key(key_t &min_key, key_t &max_key) const {
             if(subfiles.size() == 0) return DATA_NOT_AVAILABLE;
-            auto subfiles_max_it = std::max_element(
-                subfiles.begin(),
-                subfiles.end(),
-                [](const Subfile &lhs, const Subfile &rhs) {
-                return lhs.key < rhs.key;
-            });
-            auto subfiles_min_it = std::min_element(
-                subfiles.begin(),
-                subfiles.end(),
-                [](const Subfile &lhs, const Subfile &rhs) {
-                return lhs.key < rhs.key;
-            });
-            max_key = subfiles_max_it->key;
-            min_key = subfiles_min_it->key;
+            // подфайлы всегда отсортированы по ключу
+            min_key = subfiles.front().key;
+            max_key = subfiles.back().key;
             return OK;
         }
 
@@ -930,12 +2223,60 @@ namespace xquotes_storage {
          */
         void set_file_note(note_t new_file_note) {file_note = new_file_note;};
 
+        /** \brief Найти секцию заголовка
+         * \param tag тег секции
+         * \return указатель на данные секции или NULL, если секции нет
+         */
+        inline const std::vector<char> *find_header_section(const unsigned long tag) const {
+            auto it = header_sections.find(tag);
+            return it == header_sections.end() ? NULL : &it->second;
+        }
+
+        /** \brief Получить секцию заголовка для изменения
+         * \details Если секции нет, будет создана пустая секция.
+         * Секции записываются вместе с заголовком при сохранении или закрытии хранилища.
+         * Тег HEADER_SECTION_FREE_EXTENTS зарезервирован хранилищем
+         * \param tag тег секции
+         * \return ссылка на данные секции
+         */
+        std::vector<char> &get_header_section(const unsigned long tag) {
+            is_write = true;
+            return header_sections[tag];
+        }
+
+        /** \brief Получить версию формата файла
+         * \return версия формата файла (FILE_VERSION_4 или FILE_VERSION_5)
+         */
+        inline int get_file_version() const {
+            return file_version;
+        }
+
+        /** \brief Установить версию формата файла
+         * \details Версию можно изменить только у пустого хранилища (до записи первого подфайла).
+         * Формат 5 имеет поля фиксированной ширины, поэтому файлы одинаковы под Windows и Linux.
+         * Для перевода существующего файла в новый формат используйте xqhtools
+         * \param version версия формата файла (FILE_VERSION_4 или FILE_VERSION_5)
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int set_file_version(const int version) {
+            if(version != FILE_VERSION_4 && version != FILE_VERSION_5) return INVALID_PARAMETER;
+            if(is_read_only()) return NOT_WRITE_FILE;
+            if(subfiles.size() != 0 || batch_subfiles.size() != 0) return INVALID_PARAMETER;
+            file_version = version;
+            return OK;
+        }
+
         /** \brief Переименовать подфайл
          * \param key старый ключ подфайла
          * \param new_key новый ключ подфайла
          * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
          */
         int rename_subfile(const key_t key, const key_t new_key) {
+            if(is_read_only()) return NOT_WRITE_FILE;
+            if(is_batch) {
+                int err = write_batch();
+                if(err != OK) return err;
+            }
             if(subfiles.size() == 0) return DATA_NOT_AVAILABLE;
             auto subfiles_it = std::lower_bound(
                 subfiles.begin(),
@@ -948,6 +2289,7 @@ namespace xquotes_storage {
             size_t ind = (size_t)(subfiles_it - subfiles.begin());
             subfiles[ind].key = new_key;
             sort_subfiles(subfiles);
+            invalidate_subfiles_index();
             return OK;
         }
 
@@ -956,6 +2298,11 @@ namespace xquotes_storage {
          * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
          */
         int delete_subfile(const key_t key) {
+            if(is_read_only()) return NOT_WRITE_FILE;
+            if(is_batch) {
+                int err = write_batch();
+                if(err != OK) return err;
+            }
             if(subfiles.size() == 0) return DATA_NOT_AVAILABLE;
             auto subfiles_it = std::lower_bound(
                 subfiles.begin(),
@@ -964,13 +2311,44 @@ namespace xquotes_storage {
                 [](const Subfile &lhs, const key_t &key) {
                 return lhs.key < key;
             });
-            if(subfiles_it == subfiles.end()) return DATA_NOT_AVAILABLE;
+            if(subfiles_it == subfiles.end() || subfiles_it->key != key) return DATA_NOT_AVAILABLE;
+            const link_t link = subfiles_it->link;
+            const unsigned long size = subfiles_it->size;
             subfiles.erase(subfiles_it);
-            sort_subfiles(subfiles);
-            write_header(file, subfiles);
+            invalidate_subfiles_index();
+            released_extents.push_back(FreeExtent(link, size));
+            commit_header();
             return OK;
         }
 
+        /** \brief Сжать файл хранилища
+         * \details Метод переписывает файл без свободных участков, которые появляются
+         * после перезаписи подфайлов с другим размером и удаления подфайлов.
+         * Метод копирует все подфайлы во временный файл, поэтому его стоит вызывать редко
+         * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+         */
+        int compact() {
+            if(!is_file_open) return FILE_NOT_OPENED;
+            if(is_read_only()) return NOT_WRITE_FILE;
+            if(is_batch) {
+                int err = write_batch();
+                if(err != OK) return err;
+            }
+            if(subfiles.size() == 0) return OK;
+            return compact_file();
+        }
+
+        /** \brief Получить размер свободных участков файла
+         * \return суммарный размер свободных участков в байтах
+         */
+        unsigned long get_free_space() const {
+            unsigned long free_space = 0;
+            for(size_t i = 0; i < free_extents.size(); ++i) {
+                free_space += free_extents[i].size;
+            }
+            return free_space;
+        }
+
         /** \brief Получить crc64 код подфайла
          *
          * \param key Ключ подфайла
@@ -991,6 +2369,9 @@ namespace xquotes_storage {
 
         virtual ~Storage() {
             close();
+#           if XQUOTES_USE_ZSTD == 1
+            free_zstd_context();
+#           endif
             if(is_mem_dict_file) delete [] dictionary_file_buffer;
         }
     };
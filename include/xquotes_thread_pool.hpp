@@ -0,0 +1,308 @@
+/*
+* xquotes_history - C++ header-only library for working with historical quotes data
+*
+* Copyright (c) 2018 Elektro Yar. Email: git.electroyar@gmail.com
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+/** \file Файл с пулом потоков
+ * \brief Данный файл содержит класс ThreadPool
+ *
+ * Потоки пула создаются один раз и ждут задачи. У каждого потока своя очередь задач:
+ * поток берет задачи из конца своей очереди, а когда она пуста - забирает задачи из начала очередей других потоков.
+ * Задача, добавленная из потока пула, попадает в очередь этого потока, поэтому цепочка задач
+ * (например, дни одного символа) обычно выполняется одним потоком, пока другие потоки заняты.
+ * Используется классом MultipleQuotesHistory в методе trade_multiple_threads
+ */
+#ifndef XQUOTES_THREAD_POOL_HPP_INCLUDED
+#define XQUOTES_THREAD_POOL_HPP_INCLUDED
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <exception>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace xquotes_thread_pool {
+
+    /** \brief Статистика потока пула
+     */
+    class ThreadStats {
+    public:
+        double busy_time = 0;               /**< Время выполнения задач в секундах */
+        double utilization = 0;             /**< Доля времени выполнения задач от времени работы пула (от 0 до 1) */
+        unsigned long long num_tasks = 0;   /**< Количество выполненных задач */
+        unsigned long long num_stolen = 0;  /**< Количество задач, взятых из очередей других потоков */
+        bool is_pinned = false;             /**< Поток закреплен за ядром процессора */
+
+        ThreadStats() {};
+    };
+
+    /** \brief Пул потоков с перераспределением задач между потоками
+     * \details Задачи можно добавлять как из основного потока, так и из задач пула.
+     * Метод wait ждет выполнения всех задач, в том числе добавленных во время ожидания
+     */
+    class ThreadPool {
+    public:
+        typedef std::function<void(const int thread_ind)> task_t;
+
+    private:
+        typedef std::chrono::steady_clock clock_t;
+
+        /// Поток пула и его очередь задач
+        class Worker {
+        public:
+            std::mutex mutex;
+            std::deque<task_t> tasks;
+            std::thread thread;
+            ThreadStats stats;
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::mutex pool_mutex;
+        std::condition_variable task_condition;     /**< Появились задачи или пул остановлен */
+        std::condition_variable done_condition;     /**< Все задачи выполнены */
+        std::atomic<size_t> num_queued;             /**< Количество задач в очередях */
+        std::atomic<size_t> num_pending;            /**< Количество задач в очередях и выполняемых задач */
+        std::atomic<size_t> next_worker;            /**< Очередь для следующей задачи из основного потока */
+        clock_t::time_point stats_start;            /**< Начало отсчета статистики */
+        clock_t::time_point stats_stop;             /**< Конец последнего ожидания задач */
+        std::exception_ptr task_exception;          /**< Первое исключение из задач, будет выброшено методом wait */
+        bool is_stop = false;
+
+        /** \brief Получить номер потока пула, в котором выполняется код
+         * \return номер потока или -1, если код выполняется не в потоке этого пула
+         */
+        int get_current_thread_ind() const {
+            const ThreadPool *pool = current_pool();
+            return pool == this ? current_thread_ind() : -1;
+        }
+
+        static const ThreadPool *&current_pool() {
+            static thread_local const ThreadPool *pool = NULL;
+            return pool;
+        }
+
+        static int &current_thread_ind() {
+            static thread_local int thread_ind = -1;
+            return thread_ind;
+        }
+
+        /** \brief Закрепить поток за ядром процессора
+         * \return вернет true, если поток закреплен
+         */
+        static bool pin_thread(std::thread &thread, const int thread_ind) {
+#           if defined(__linux__)
+            const int num_cores = std::max((int)std::thread::hardware_concurrency(), 1);
+            cpu_set_t cpu_set;
+            CPU_ZERO(&cpu_set);
+            CPU_SET(thread_ind % num_cores, &cpu_set);
+            return pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpu_set) == 0;
+#           else
+            (void)thread;
+            (void)thread_ind;
+            return false;
+#           endif
+        }
+
+        /** \brief Взять задачу из своей очереди или из очереди другого потока
+         */
+        bool pop_task(const int thread_ind, task_t &task, bool &is_stolen) {
+            const int num_threads = workers.size();
+            for(int i = 0; i < num_threads; ++i) {
+                Worker &worker = *workers[(thread_ind + i) % num_threads];
+                std::lock_guard<std::mutex> lock(worker.mutex);
+                if(worker.tasks.empty()) continue;
+                if(i == 0) {
+                    task = std::move(worker.tasks.back());
+                    worker.tasks.pop_back();
+                } else {
+                    task = std::move(worker.tasks.front());
+                    worker.tasks.pop_front();
+                }
+                is_stolen = i != 0;
+                --num_queued;
+                return true;
+            }
+            return false;
+        }
+
+        void run(const int thread_ind) {
+            current_pool() = this;
+            current_thread_ind() = thread_ind;
+            Worker &worker = *workers[thread_ind];
+            while(true) {
+                task_t task;
+                bool is_stolen = false;
+                if(!pop_task(thread_ind, task, is_stolen)) {
+                    std::unique_lock<std::mutex> lock(pool_mutex);
+                    task_condition.wait(lock, [&]() {
+                        return is_stop || num_queued > 0;
+                    });
+                    if(is_stop && num_queued == 0) return;
+                    continue;
+                }
+                const clock_t::time_point start = clock_t::now();
+                try {
+                    task(thread_ind);
+                } catch(...) {
+                    std::lock_guard<std::mutex> lock(pool_mutex);
+                    if(!task_exception) task_exception = std::current_exception();
+                }
+                const clock_t::time_point stop = clock_t::now();
+                {
+                    std::lock_guard<std::mutex> lock(worker.mutex);
+                    worker.stats.busy_time += std::chrono::duration<double>(stop - start).count();
+                    ++worker.stats.num_tasks;
+                    if(is_stolen) ++worker.stats.num_stolen;
+                }
+                if(--num_pending == 0) {
+                    std::lock_guard<std::mutex> lock(pool_mutex);
+                    done_condition.notify_all();
+                }
+            }
+        }
+
+    public:
+
+        /** \brief Создать пул потоков
+         * \param num_threads количество потоков, если 0 - по количеству ядер процессора
+         * \param is_pin_threads закрепить потоки за ядрами процессора (только Linux)
+         */
+        ThreadPool(const int num_threads = 0, const bool is_pin_threads = false) :
+                num_queued(0), num_pending(0), next_worker(0) {
+            const int num_workers = num_threads > 0 ? num_threads : std::max((int)std::thread::hardware_concurrency(), 1);
+            for(int i = 0; i < num_workers; ++i) {
+                workers.push_back(std::unique_ptr<Worker>(new Worker()));
+            }
+            for(int i = 0; i < num_workers; ++i) {
+                workers[i]->thread = std::thread([this, i]() {
+                    run(i);
+                });
+                if(is_pin_threads) workers[i]->stats.is_pinned = pin_thread(workers[i]->thread, i);
+            }
+            stats_start = stats_stop = clock_t::now();
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /** \brief Получить количество потоков
+         * \return количество потоков
+         */
+        inline int get_num_threads() const {
+            return workers.size();
+        }
+
+        /** \brief Добавить задачу
+         * \details Задача из потока пула попадает в очередь этого потока, задача из другого потока - в очереди потоков по кругу
+         * \param task задача, в нее передается номер потока, который ее выполняет
+         */
+        void add_task(const task_t &task) {
+            const int current_ind = get_current_thread_ind();
+            const size_t thread_ind = current_ind >= 0 ? current_ind : next_worker++ % workers.size();
+            ++num_pending;
+            {
+                Worker &worker = *workers[thread_ind];
+                std::lock_guard<std::mutex> lock(worker.mutex);
+                worker.tasks.push_back(task);
+                ++num_queued;
+            }
+            {
+                std::lock_guard<std::mutex> lock(pool_mutex);
+            }
+            task_condition.notify_one();
+        }
+
+        /** \brief Дождаться выполнения всех задач
+         * \details Если задача выбросила исключение, остальные задачи все равно выполняются,
+         * а метод после их завершения выбросит первое исключение
+         * \warning Метод нельзя вызывать из задач пула
+         */
+        void wait() {
+            std::exception_ptr exception;
+            {
+                std::unique_lock<std::mutex> lock(pool_mutex);
+                done_condition.wait(lock, [&]() {
+                    return num_pending == 0;
+                });
+                stats_stop = clock_t::now();
+                std::swap(exception, task_exception);
+            }
+            if(exception) std::rethrow_exception(exception);
+        }
+
+        /** \brief Сбросить статистику потоков
+         * \details Время работы пула для расчета загрузки потоков отсчитывается от вызова этого метода до последнего вызова wait
+         */
+        void reset_stats() {
+            for(size_t i = 0; i < workers.size(); ++i) {
+                std::lock_guard<std::mutex> lock(workers[i]->mutex);
+                const bool is_pinned = workers[i]->stats.is_pinned;
+                workers[i]->stats = ThreadStats();
+                workers[i]->stats.is_pinned = is_pinned;
+            }
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            stats_start = stats_stop = clock_t::now();
+        }
+
+        /** \brief Получить статистику потоков
+         * \param stats статистика каждого потока
+         */
+        void get_stats(std::vector<ThreadStats> &stats) {
+            double pool_time = 0;
+            {
+                std::lock_guard<std::mutex> lock(pool_mutex);
+                pool_time = std::chrono::duration<double>(stats_stop - stats_start).count();
+            }
+            stats.resize(workers.size());
+            for(size_t i = 0; i < workers.size(); ++i) {
+                std::lock_guard<std::mutex> lock(workers[i]->mutex);
+                stats[i] = workers[i]->stats;
+                stats[i].utilization = pool_time > 0 ? std::min(stats[i].busy_time / pool_time, 1.0) : 0;
+            }
+        }
+
+        ~ThreadPool() {
+            try {
+                wait();
+            } catch(...) {}
+            {
+                std::lock_guard<std::mutex> lock(pool_mutex);
+                is_stop = true;
+            }
+            task_condition.notify_all();
+            for(size_t i = 0; i < workers.size(); ++i) {
+                if(workers[i]->thread.joinable()) workers[i]->thread.join();
+            }
+        }
+    };
+}
+
+#endif // XQUOTES_THREAD_POOL_HPP_INCLUDED
@@ -0,0 +1,121 @@
+#include <iostream>
+#include "xquotes_history.hpp"
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+
+/* Программа сравнивает скорость проверки бинарных опционов
+ * вызовами check_binary_option по одному опциону и пакетом check_binary_options в одном и нескольких потоках.
+ * Проверяется сетка параметров (каждая минута нескольких дней, несколько длительностей и оба направления)
+ * в порядке времени и часть той же сетки в случайном порядке.
+ * Пакет проверяется несколько раз подряд, как при переборе параметров оптимизатором:
+ * первый вызов выделяет память под буферы, повторные вызовы используют их снова
+ */
+
+struct Options {
+    std::vector<ztime::timestamp_t> timestamps;
+    std::vector<int> durations_sec;
+    std::vector<int> contract_types;
+
+    void add(const ztime::timestamp_t timestamp, const int duration_sec, const int contract_type) {
+        timestamps.push_back(timestamp);
+        durations_sec.push_back(duration_sec);
+        contract_types.push_back(contract_type);
+    }
+};
+
+void check_options(const std::string &name, const std::string &path, const Options &options) {
+    const size_t num_options = options.timestamps.size();
+    std::cout << name << ", options: " << num_options << std::endl;
+
+    // по одному опциону
+    std::vector<int> states_single(num_options), errors_single(num_options);
+    double time_single = 0;
+    {
+        xquotes_history::QuotesHistory<> iQuotesHistory(path, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+        auto start = std::chrono::high_resolution_clock::now();
+        for(size_t i = 0; i < num_options; ++i) {
+            errors_single[i] = iQuotesHistory.check_binary_option(
+                states_single[i],
+                options.contract_types[i],
+                options.durations_sec[i],
+                options.timestamps[i]);
+        }
+        auto stop = std::chrono::high_resolution_clock::now();
+        time_single = std::chrono::duration<double, std::milli>(stop - start).count();
+        std::cout << "check_binary_option: " << time_single << " ms" << std::endl;
+    }
+
+    // пакетом
+    const int num_hardware_thread = std::max((int)std::thread::hardware_concurrency(), 1);
+    const int list_num_threads[] = {1, num_hardware_thread};
+    const int num_calls = 5;
+    for(const int num_threads : list_num_threads) {
+        xquotes_history::QuotesHistory<> iQuotesHistory(path, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+        if(num_threads > 1) iQuotesHistory.enable_concurrent_read();
+        std::vector<int> states, errors;
+        double time_first = 0, time_repeat = 0;
+        int err = xquotes_history::OK;
+        for(int call = 0; call < num_calls; ++call) {
+            auto start = std::chrono::high_resolution_clock::now();
+            err = iQuotesHistory.check_binary_options(states, errors, options.timestamps, options.durations_sec, options.contract_types,
+                xquotes_history::PRICE_CLOSE, num_threads);
+            auto stop = std::chrono::high_resolution_clock::now();
+            const double time_batch = std::chrono::duration<double, std::milli>(stop - start).count();
+            if(call == 0) time_first = time_batch;
+            else time_repeat += time_batch / (num_calls - 1);
+        }
+        size_t num_errors = 0;
+        for(size_t i = 0; i < num_options; ++i) {
+            if(errors[i] != errors_single[i] || (errors[i] == xquotes_history::OK && states[i] != states_single[i])) ++num_errors;
+        }
+        std::cout << "check_binary_options, threads " << num_threads << ": first call " << time_first << " ms (x"
+            << (time_single / time_first) << "), repeated call " << time_repeat << " ms (x" << (time_single / time_repeat) << ")";
+        if(err != xquotes_history::OK) std::cout << " error! code: " << err;
+        if(num_errors != 0) std::cout << " error! options: " << num_errors;
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::cout << "start!" << std::endl;
+    std::string path = argc > 1 ? argv[1] : "../../storage/EURGBP.qhs4"; // путь к файлу
+    const int num_days = 60;
+    const int durations_sec[] = {60, 120, 180, 300, 600};
+    const size_t num_random_options = 20000;
+
+    ztime::timestamp_t min_timestamp = 0, max_timestamp = 0;
+    {
+        xquotes_history::QuotesHistory<> iQuotesHistory(path, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+        if(iQuotesHistory.get_min_max_day_timestamp(min_timestamp, max_timestamp) != xquotes_history::OK ||
+            max_timestamp - min_timestamp < (ztime::timestamp_t)num_days * ztime::SECONDS_IN_DAY) {
+            std::cout << "error! file: " << path << std::endl;
+            return 0;
+        }
+    }
+
+    // сетка опционов в порядке времени, как их проверяет оптимизатор
+    Options grid;
+    const ztime::timestamp_t stop_timestamp = min_timestamp + num_days * ztime::SECONDS_IN_DAY;
+    for(ztime::timestamp_t t = min_timestamp; t < stop_timestamp; t += ztime::SECONDS_IN_MINUTE) {
+        for(const int duration_sec : durations_sec) {
+            grid.add(t, duration_sec, xquotes_history::BUY);
+            grid.add(t, duration_sec, xquotes_history::SELL);
+        }
+    }
+    check_options("grid", path, grid);
+
+    // часть сетки в случайном порядке (например, сигналы нескольких стратегий)
+    std::vector<size_t> indices(grid.timestamps.size());
+    for(size_t i = 0; i < indices.size(); ++i) indices[i] = i;
+    std::shuffle(indices.begin(), indices.end(), std::mt19937(12345));
+    Options random_options;
+    for(size_t i = 0; i < num_random_options && i < indices.size(); ++i) {
+        random_options.add(grid.timestamps[indices[i]], grid.durations_sec[indices[i]], grid.contract_types[indices[i]]);
+    }
+    check_options("random order", path, random_options);
+    std::cout << "end" << std::endl;
+    return 0;
+}
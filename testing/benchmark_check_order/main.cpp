@@ -0,0 +1,129 @@
+#include <iostream>
+#include "xquotes_history.hpp"
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+/* Программа сравнивает скорость проверки ордеров методом check_oreder
+ * (поиск минуты закрытия по итогам дней и индексу экстремумов блоков)
+ * и перебором минут через get_candle, как это делалось раньше.
+ * Ордера открываются в случайные минуты месяца котировок, дни месяца и следующие за ним дни
+ * помещаются в окно котировок, поэтому время чтения файла почти не влияет на результат
+ */
+
+typedef xquotes_history::QuotesHistory<> quotes_history_t;
+
+/** \brief Проверить ордер перебором минут
+ */
+int check_order_by_minutes(
+        quotes_history_t &iQuotesHistory,
+        double &profit,
+        const int contract_type,
+        const double spread,
+        const double take_profit,
+        const double stop_loss,
+        const ztime::timestamp_t timestamp,
+        ztime::timestamp_t &timestamp_end,
+        const ztime::timestamp_t timestamp_stop) {
+    xquotes_history::Candle candle_start;
+    if(iQuotesHistory.get_candle(candle_start, timestamp, xquotes_history::WITHOUT_OPTIMIZATION) != xquotes_history::OK) return xquotes_history::DATA_NOT_AVAILABLE;
+    const double price_start = candle_start.close;
+    const double tl = contract_type == xquotes_history::BUY ? price_start + spread + take_profit : price_start - spread + stop_loss;
+    const double bl = contract_type == xquotes_history::BUY ? price_start + spread - stop_loss : price_start - spread - take_profit;
+    for(ztime::timestamp_t t = timestamp; t < timestamp_stop; t += ztime::SECONDS_IN_MINUTE) {
+        xquotes_history::Candle candle;
+        if(iQuotesHistory.get_candle(candle, t) != xquotes_history::OK || candle.high == 0.0 || candle.low == 0.0) continue;
+        const bool is_stop_loss = contract_type == xquotes_history::BUY ? candle.low <= bl : candle.high >= tl;
+        const bool is_take_profit = contract_type == xquotes_history::BUY ? candle.high >= tl : candle.low <= bl;
+        if(is_stop_loss || is_take_profit) {
+            profit = is_stop_loss ? -stop_loss : take_profit;
+            timestamp_end = t;
+            return xquotes_history::OK;
+        }
+    }
+    return xquotes_history::DATA_NOT_AVAILABLE;
+}
+
+int main(int argc, char *argv[]) {
+    std::cout << "start!" << std::endl;
+    std::string path = argc > 1 ? argv[1] : "../../storage/EURGBP.qhs4"; // путь к файлу
+    const int num_orders = 5000;
+    const int num_days_orders = 30;
+    const int indent_day_up = 120;
+    const double spread = 0.0001;
+
+    quotes_history_t iQuotesHistory(path, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+    quotes_history_t iQuotesHistoryMinutes(path, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+    ztime::timestamp_t min_timestamp = 0, max_timestamp = 0;
+    if(iQuotesHistory.get_min_max_day_timestamp(min_timestamp, max_timestamp) != xquotes_history::OK ||
+        max_timestamp - min_timestamp < (ztime::timestamp_t)(num_days_orders + indent_day_up) * ztime::SECONDS_IN_DAY) {
+        std::cout << "error! file: " << path << std::endl;
+        return 0;
+    }
+    const ztime::timestamp_t timestamp_stop = max_timestamp + ztime::SECONDS_IN_DAY;
+    iQuotesHistory.set_indent(0, indent_day_up);
+    iQuotesHistoryMinutes.set_indent(0, indent_day_up);
+
+    // ордера открываются в случайные минуты первого месяца после начала данных
+    std::mt19937 generator(12345);
+    std::uniform_int_distribution<int> minute_distribution(0, num_days_orders * xquotes_history::MINUTES_IN_DAY - 1);
+    std::uniform_int_distribution<int> level_distribution(1, 40);
+    std::vector<ztime::timestamp_t> orders_timestamp(num_orders);
+    std::vector<double> orders_level(num_orders);
+    std::vector<int> orders_contract(num_orders);
+    for(int i = 0; i < num_orders; ++i) {
+        orders_timestamp[i] = min_timestamp + minute_distribution(generator) * ztime::SECONDS_IN_MINUTE;
+        orders_level[i] = 0.0005 * level_distribution(generator);
+        orders_contract[i] = i % 2 == 0 ? xquotes_history::BUY : xquotes_history::SELL;
+    }
+    std::sort(orders_timestamp.begin(), orders_timestamp.end());
+
+    // первый проход загружает дни в окно котировок, время измеряется на втором проходе
+    double time_index = 0, time_minutes = 0;
+    int num_closed = 0, num_errors = 0;
+    for(int pass = 0; pass < 2; ++pass) {
+        time_index = time_minutes = 0;
+        num_closed = num_errors = 0;
+        for(int i = 0; i < num_orders; ++i) {
+            double profit_index = 0, profit_minutes = 0;
+            ztime::timestamp_t timestamp_end_index = 0, timestamp_end_minutes = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            int err_index = iQuotesHistory.check_oreder(
+                profit_index,
+                orders_contract[i],
+                spread,
+                orders_level[i],
+                orders_level[i] * 0.7,
+                orders_timestamp[i],
+                timestamp_end_index,
+                xquotes_history::PRICE_CLOSE,
+                xquotes_history::WITHOUT_OPTIMIZATION,
+                true);
+            auto middle = std::chrono::high_resolution_clock::now();
+            int err_minutes = check_order_by_minutes(
+                iQuotesHistoryMinutes,
+                profit_minutes,
+                orders_contract[i],
+                spread,
+                orders_level[i],
+                orders_level[i] * 0.7,
+                orders_timestamp[i],
+                timestamp_end_minutes,
+                timestamp_stop);
+            auto stop = std::chrono::high_resolution_clock::now();
+            time_index += std::chrono::duration<double, std::micro>(middle - start).count();
+            time_minutes += std::chrono::duration<double, std::micro>(stop - middle).count();
+            if(err_index != err_minutes || (err_index == xquotes_history::OK &&
+                (profit_index != profit_minutes || timestamp_end_index != timestamp_end_minutes))) ++num_errors;
+            if(err_index == xquotes_history::OK) ++num_closed;
+        }
+    }
+
+    std::cout << "orders: " << num_orders << ", closed: " << num_closed << std::endl;
+    std::cout << "minutes: " << (time_minutes / num_orders) << " us per order" << std::endl;
+    std::cout << "index: " << (time_index / num_orders) << " us per order (x" << (time_minutes / time_index) << ")" << std::endl;
+    if(num_errors != 0) std::cout << "error! orders: " << num_errors << std::endl;
+    std::cout << "end" << std::endl;
+    return 0;
+}
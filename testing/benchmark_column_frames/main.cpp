@@ -0,0 +1,112 @@
+#include <iostream>
+#include "xquotes_history.hpp"
+#include <vector>
+#include <array>
+#include <chrono>
+#include <stdio.h>
+
+/* Программа сравнивает размер файла и скорость чтения дней котировок
+ * для обычных подфайлов и подфайлов с кадрами по столбцам (set_column_frames)
+ * при чтении всех цен и только цен закрытия (set_read_columns).
+ * Дни котировок берутся из исходного файла и переписываются во временные файлы
+ */
+
+typedef std::array<xquotes_history::Candle, xquotes_history::MINUTES_IN_DAY> candles_day_t;
+
+int main(int argc, char *argv[]) {
+    std::cout << "start!" << std::endl;
+    std::string path = argc > 1 ? argv[1] : "../../storage/EURGBP.qhs4"; // путь к файлу
+    const int num_passes = 5;
+
+    std::vector<candles_day_t> days;
+    std::vector<ztime::timestamp_t> days_timestamp;
+    int price_type = xquotes_history::PRICE_OHLC;
+    int file_version = xquotes_storage::FILE_VERSION_4;
+    {
+        xquotes_history::QuotesHistory<> iQuotesHistory(path, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+        price_type = iQuotesHistory.get_file_note() & 0x0F;
+        file_version = iQuotesHistory.get_file_version();
+        iQuotesHistory.enable_concurrent_read();
+        for(size_t s = 0; s < iQuotesHistory.get_num_subfiles(); ++s) {
+            const ztime::timestamp_t timestamp = iQuotesHistory.get_key_subfiles(s) * ztime::SECONDS_IN_DAY;
+            candles_day_t candles;
+            if(iQuotesHistory.read_day_candles_concurrent(candles, timestamp) != xquotes_history::OK) continue;
+            days.push_back(candles);
+            days_timestamp.push_back(timestamp);
+        }
+    }
+    std::cout << "days: " << days.size() << std::endl;
+    if(days.size() == 0) {
+        std::cout << "error! file: " << path << std::endl;
+        return 0;
+    }
+
+    const int all_columns = (1 << xquotes_history::CandleColumns::NUM_COLUMNS) - 1;
+    const int close_column = 1 << xquotes_history::CandleColumns::COLUMN_CLOSE;
+    const char *mode_names[] = {
+        "subfile, all prices",
+        "column frames, all prices",
+        "column frames, close only",
+        "column frames + codec, all prices",
+        "column frames + codec, close only"};
+    const bool mode_frames[] = {false, true, true, true, true};
+    const int mode_codecs[] = {xquotes_codec::CODEC_NONE, xquotes_codec::CODEC_NONE, xquotes_codec::CODEC_NONE,
+        xquotes_codec::CODEC_DELTA_ZIGZAG_BITPACK, xquotes_codec::CODEC_DELTA_ZIGZAG_BITPACK};
+    const int mode_columns[] = {all_columns, all_columns, close_column, all_columns, close_column};
+    const std::string temp_path = "benchmark_column_frames.tmp";
+    double time_subfile = 0;
+    for(int mode = 0; mode < 5; ++mode) {
+        remove(temp_path.c_str());
+        {
+            xquotes_history::QuotesHistory<> iQuotesHistory(temp_path, price_type, xquotes_history::USE_COMPRESSION);
+            iQuotesHistory.set_file_version(file_version);
+            iQuotesHistory.set_price_codec(mode_codecs[mode]);
+            iQuotesHistory.set_column_frames(mode_frames[mode]);
+            iQuotesHistory.begin_batch(64 * 1024 * 1024);
+            for(size_t i = 0; i < days.size(); ++i) {
+                int err = iQuotesHistory.write_candles(days[i], days_timestamp[i]);
+                if(err != xquotes_history::OK) std::cout << "error! write, code: " << err << std::endl;
+            }
+            iQuotesHistory.commit();
+        }
+
+        xquotes_history::QuotesHistory<> iQuotesHistory(temp_path, price_type, xquotes_history::USE_COMPRESSION);
+        iQuotesHistory.set_read_columns(mode_columns[mode]);
+        iQuotesHistory.enable_concurrent_read();
+        candles_day_t candles;
+        double check_sum = 0;
+        size_t num_errors = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for(int n = 0; n < num_passes; ++n) {
+            for(size_t i = 0; i < days.size(); ++i) {
+                if(iQuotesHistory.read_day_candles_concurrent(candles, days_timestamp[i]) != xquotes_history::OK) continue;
+                check_sum += candles[720].close;
+            }
+        }
+        auto stop = std::chrono::high_resolution_clock::now();
+
+        // проверим, что цены закрытия не изменились
+        for(size_t i = 0; i < days.size(); ++i) {
+            if(iQuotesHistory.read_day_candles_concurrent(candles, days_timestamp[i]) != xquotes_history::OK) {
+                ++num_errors;
+                continue;
+            }
+            for(int m = 0; m < xquotes_history::MINUTES_IN_DAY; ++m) {
+                if(candles[m].close != days[i][m].close) {
+                    ++num_errors;
+                    break;
+                }
+            }
+        }
+
+        const double time_day = std::chrono::duration<double, std::micro>(stop - start).count() / ((double)days.size() * num_passes);
+        if(mode == 0) time_subfile = time_day;
+        std::cout << mode_names[mode] << ": " << bf::get_file_size(temp_path) << " bytes, "
+            << time_day << " us per day (x" << (time_subfile / time_day) << ")";
+        if(num_errors != 0) std::cout << " error! days: " << num_errors;
+        std::cout << " check sum: " << check_sum << std::endl;
+    }
+    remove(temp_path.c_str());
+    std::cout << "end" << std::endl;
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include <iostream>
+#include "xquotes_history.hpp"
+#include <vector>
+#include <chrono>
+#include <random>
+
+/* Программа сравнивает скорость получения списка дней торговли для нескольких символов:
+ * списками ключей подфайлов каждого символа (get_subfile_list с проверкой выходных дней для каждого ключа),
+ * как это делалось раньше, и методом get_day_timestamp_list, который пересекает битовые карты дней символов.
+ * Все символы читаются из одного файла котировок, поэтому списки дней символов совпадают
+ */
+
+typedef xquotes_history::MultipleQuotesHistory<> multiple_quotes_history_t;
+
+static bool check_day_off(const xquotes_history::key_t &key) {
+    return ztime::is_day_off_for_day(key);
+}
+
+/** \brief Получить список дней торговли списками ключей подфайлов символов
+ */
+int get_day_timestamp_list_by_subfiles(
+        multiple_quotes_history_t &iMultipleQuotesHistory,
+        std::vector<ztime::timestamp_t> &list_timestamp,
+        const ztime::timestamp_t start_timestamp,
+        const int num_days,
+        const bool is_go_back_in_time) {
+    std::vector<xquotes_history::key_t> list_subfile, old_list_subfile;
+    for(int i = 0; i < iMultipleQuotesHistory.get_num_symbols(); ++i) {
+        int err = iMultipleQuotesHistory.get_quotes_history(i)->get_subfile_list(
+            ztime::get_day(start_timestamp), list_subfile, num_days, check_day_off, is_go_back_in_time);
+        if(err != xquotes_history::OK) return err;
+        if(i > 0 && old_list_subfile != list_subfile) return xquotes_history::STRANGE_PROGRAM_BEHAVIOR;
+        old_list_subfile = list_subfile;
+    }
+    list_timestamp.clear();
+    for(size_t i = 0; i < list_subfile.size(); ++i) {
+        list_timestamp.push_back((ztime::timestamp_t)list_subfile[i] * ztime::SECONDS_IN_DAY);
+    }
+    return xquotes_history::OK;
+}
+
+int main(int argc, char *argv[]) {
+    std::cout << "start!" << std::endl;
+    std::string path = argc > 1 ? argv[1] : "../../storage/EURGBP.qhs4"; // путь к файлу
+    const int num_symbols = 8;
+    const int num_queries = 2000;
+    const int list_num_days[] = {5, 60, 250};
+
+    std::vector<std::string> paths(num_symbols, path);
+    multiple_quotes_history_t iMultipleQuotesHistory(paths, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+    ztime::timestamp_t min_timestamp = 0, max_timestamp = 0;
+    if(iMultipleQuotesHistory.get_min_max_day_timestamp(min_timestamp, max_timestamp) != xquotes_history::OK) {
+        std::cout << "error! file: " << path << std::endl;
+        return 0;
+    }
+    const std::vector<bool> is_symbol(num_symbols, true);
+
+    // случайные дни начала поиска
+    std::mt19937 generator(12345);
+    std::uniform_int_distribution<ztime::timestamp_t> day_distribution(0, (max_timestamp - min_timestamp) / ztime::SECONDS_IN_DAY);
+    std::vector<ztime::timestamp_t> start_timestamps(num_queries);
+    std::vector<bool> is_go_back(num_queries);
+    for(int i = 0; i < num_queries; ++i) {
+        start_timestamps[i] = min_timestamp + day_distribution(generator) * ztime::SECONDS_IN_DAY;
+        is_go_back[i] = i % 2 == 0;
+    }
+
+    std::cout << "symbols: " << num_symbols << ", queries: " << num_queries << std::endl;
+    for(const int num_days : list_num_days) {
+        std::vector<ztime::timestamp_t> list_subfiles, list_bitset;
+        size_t num_errors = 0;
+        double time_subfiles = 0, time_bitset = 0;
+        for(int i = 0; i < num_queries; ++i) {
+            auto start = std::chrono::high_resolution_clock::now();
+            int err_subfiles = get_day_timestamp_list_by_subfiles(iMultipleQuotesHistory, list_subfiles, start_timestamps[i], num_days, is_go_back[i]);
+            auto middle = std::chrono::high_resolution_clock::now();
+            int err_bitset = iMultipleQuotesHistory.get_day_timestamp_list(list_bitset, start_timestamps[i], is_symbol, num_days, true, is_go_back[i]);
+            auto stop = std::chrono::high_resolution_clock::now();
+            time_subfiles += std::chrono::duration<double, std::micro>(middle - start).count();
+            time_bitset += std::chrono::duration<double, std::micro>(stop - middle).count();
+            if(err_subfiles == xquotes_history::OK && (err_bitset != xquotes_history::OK || list_subfiles != list_bitset)) ++num_errors;
+        }
+        std::cout << "days " << num_days << ": subfile lists " << (time_subfiles / num_queries) << " us, bitset "
+            << (time_bitset / num_queries) << " us (x" << (time_subfiles / time_bitset) << ")";
+        if(num_errors != 0) std::cout << " error! queries: " << num_errors;
+        std::cout << std::endl;
+    }
+    std::cout << "end" << std::endl;
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <iostream>
+#include "xquotes_history.hpp"
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cmath>
+
+/* Программа сравнивает скорость торговли по одному символу методом trade (один поток, окно котировок)
+ * и методом trade_day_ranges (дни распределены по потокам пула).
+ * Торговля считает сумму цен закрытия и количество минут с данными, результаты обоих методов должны совпасть
+ */
+
+typedef xquotes_history::MultipleQuotesHistory<> multiple_quotes_history_t;
+
+/// Результат диапазона дней
+struct TradeResult {
+    double sum = 0;
+    long long num_candles = 0;
+};
+
+int main(int argc, char *argv[]) {
+    std::cout << "start!" << std::endl;
+    std::string path = argc > 1 ? argv[1] : "../../storage/EURGBP.qhs4"; // путь к файлу
+    const int num_days = 250;
+
+    std::vector<std::string> paths = {path};
+    const std::vector<bool> is_symbol(1, true);
+    ztime::timestamp_t min_timestamp = 0, max_timestamp = 0;
+    {
+        multiple_quotes_history_t iMultipleQuotesHistory(paths, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+        if(iMultipleQuotesHistory.get_min_max_day_timestamp(min_timestamp, max_timestamp) != xquotes_history::OK ||
+            max_timestamp - min_timestamp < (ztime::timestamp_t)num_days * 2 * ztime::SECONDS_IN_DAY) {
+            std::cout << "error! file: " << path << std::endl;
+            return 0;
+        }
+    }
+
+    // один поток
+    TradeResult result_trade;
+    double time_trade = 0;
+    {
+        multiple_quotes_history_t iMultipleQuotesHistory(paths, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+        auto start = std::chrono::high_resolution_clock::now();
+        int err = iMultipleQuotesHistory.trade(min_timestamp, ztime::SECONDS_IN_MINUTE, num_days, is_symbol,
+            [&](const xquotes_history::Candle &candle, const int day, const int symbol_ind, const int err) {
+            (void)day;
+            (void)symbol_ind;
+            if(err != xquotes_history::OK) return;
+            result_trade.sum += candle.close;
+            ++result_trade.num_candles;
+        }, true, false);
+        auto stop = std::chrono::high_resolution_clock::now();
+        time_trade = std::chrono::duration<double, std::milli>(stop - start).count();
+        std::cout << "trade: " << time_trade << " ms";
+        if(err != xquotes_history::OK) std::cout << " error! code: " << err;
+        std::cout << std::endl;
+    }
+
+    // дни по потокам
+    const int num_hardware_thread = std::max((int)std::thread::hardware_concurrency(), 1);
+    const int list_num_threads[] = {1, num_hardware_thread};
+    for(const int num_threads : list_num_threads) {
+        multiple_quotes_history_t iMultipleQuotesHistory(paths, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+        iMultipleQuotesHistory.set_thread_pool(num_threads);
+        iMultipleQuotesHistory.enable_concurrent_read();
+        TradeResult result;
+        auto start = std::chrono::high_resolution_clock::now();
+        int err = iMultipleQuotesHistory.trade_day_ranges<TradeResult>(min_timestamp, ztime::SECONDS_IN_MINUTE, num_days, is_symbol,
+            [&](TradeResult &range_result, const xquotes_history::Candle &candle, const int day, const int symbol_ind, const int err) {
+            (void)day;
+            (void)symbol_ind;
+            if(err != xquotes_history::OK) return;
+            range_result.sum += candle.close;
+            ++range_result.num_candles;
+        },
+            [&](const TradeResult &range_result, const int first_day, const int last_day) {
+            (void)first_day;
+            (void)last_day;
+            result.sum += range_result.sum;
+            result.num_candles += range_result.num_candles;
+        }, 0, true, false);
+        auto stop = std::chrono::high_resolution_clock::now();
+        const double time_ranges = std::chrono::duration<double, std::milli>(stop - start).count();
+        std::cout << "trade_day_ranges, threads " << num_threads << ": " << time_ranges << " ms (x" << (time_trade / time_ranges) << ")";
+        if(err != xquotes_history::OK) std::cout << " error! code: " << err;
+        if(result.num_candles != result_trade.num_candles || std::abs(result.sum - result_trade.sum) > 1e-6) {
+            std::cout << " error! result: " << result.num_candles << " " << result_trade.num_candles;
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "end" << std::endl;
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include <iostream>
+#include "xquotes_history.hpp"
+#include <vector>
+#include <array>
+#include <chrono>
+#include <stdio.h>
+
+/* Программа сравнивает скорость получения максимума и минимума всех дней котировок
+ * по итогам дней из заголовка хранилища (get_day_summary) и чтением дней целиком.
+ * Исходный файл копируется во временный файл, итоги дней которого пересчитываются (rebuild_day_summaries)
+ */
+
+typedef std::array<xquotes_history::Candle, xquotes_history::MINUTES_IN_DAY> candles_day_t;
+
+bool copy_file(const std::string &path, const std::string &new_path) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if(file == NULL) return false;
+    FILE *new_file = fopen(new_path.c_str(), "wb");
+    if(new_file == NULL) {
+        fclose(file);
+        return false;
+    }
+    std::vector<char> buffer(1024 * 1024);
+    size_t size = 0;
+    while((size = fread(buffer.data(), 1, buffer.size(), file)) > 0) fwrite(buffer.data(), 1, size, new_file);
+    fclose(file);
+    fclose(new_file);
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    std::cout << "start!" << std::endl;
+    std::string path = argc > 1 ? argv[1] : "../../storage/EURGBP.qhs4"; // путь к файлу
+    const std::string temp_path = "benchmark_day_summary.tmp";
+    if(!copy_file(path, temp_path)) {
+        std::cout << "error! file: " << path << std::endl;
+        return 0;
+    }
+    {
+        xquotes_history::QuotesHistory<> iQuotesHistory(temp_path, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+        auto start = std::chrono::high_resolution_clock::now();
+        int err = iQuotesHistory.rebuild_day_summaries();
+        auto stop = std::chrono::high_resolution_clock::now();
+        std::cout << "rebuild_day_summaries: " << std::chrono::duration<double, std::milli>(stop - start).count()
+            << " ms, code: " << err << std::endl;
+    }
+
+    xquotes_history::QuotesHistory<> iQuotesHistory(temp_path, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+    iQuotesHistory.enable_concurrent_read();
+    std::vector<ztime::timestamp_t> days_timestamp;
+    for(size_t s = 0; s < iQuotesHistory.get_num_subfiles(); ++s) {
+        days_timestamp.push_back(iQuotesHistory.get_key_subfiles(s) * ztime::SECONDS_IN_DAY);
+    }
+    std::cout << "days: " << days_timestamp.size() << std::endl;
+
+    // итоги дней из заголовка
+    double range_summary = 0;
+    size_t num_errors = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for(size_t i = 0; i < days_timestamp.size(); ++i) {
+        xquotes_history::DaySummary summary;
+        if(iQuotesHistory.get_day_summary(summary, days_timestamp[i]) != xquotes_history::OK) {
+            ++num_errors;
+            continue;
+        }
+        if(summary.num_minutes > 0) range_summary += summary.high - summary.low;
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    const double time_summary = std::chrono::duration<double, std::milli>(stop - start).count();
+
+    // чтение дней целиком
+    double range_days = 0;
+    candles_day_t candles;
+    start = std::chrono::high_resolution_clock::now();
+    for(size_t i = 0; i < days_timestamp.size(); ++i) {
+        if(iQuotesHistory.read_day_candles_concurrent(candles, days_timestamp[i]) != xquotes_history::OK) continue;
+        double high = 0, low = 0;
+        for(int m = 0; m < xquotes_history::MINUTES_IN_DAY; ++m) {
+            if(candles[m].close == 0.0) continue;
+            if(high == 0.0 || candles[m].high > high) high = candles[m].high;
+            if(low == 0.0 || candles[m].low < low) low = candles[m].low;
+        }
+        range_days += high - low;
+    }
+    stop = std::chrono::high_resolution_clock::now();
+    const double time_days = std::chrono::duration<double, std::milli>(stop - start).count();
+
+    std::cout << "day summaries: " << time_summary << " ms, sum of ranges: " << range_summary << std::endl;
+    std::cout << "full days: " << time_days << " ms, sum of ranges: " << range_days
+        << " (x" << (time_days / time_summary) << ")" << std::endl;
+    if(num_errors != 0) std::cout << "error! days without summary: " << num_errors << std::endl;
+    remove(temp_path.c_str());
+    std::cout << "end" << std::endl;
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include <iostream>
+#include "xquotes_history.hpp"
+#include <vector>
+#include <chrono>
+#include <stdio.h>
+
+/* Программа измеряет скорость поминутного чтения котировок за год
+ * при разных отступах окна котировок (set_indent).
+ * При сдвиге окна загружаются только новые дни, поэтому время на минуту
+ * не должно заметно расти при увеличении отступов
+ */
+int main(int argc, char *argv[]) {
+    std::cout << "start!" << std::endl;
+    std::string path = argc > 1 ? argv[1] : "../../storage/EURGBP.qhs4"; // путь к файлу
+    const int num_days = 365;
+    const int indent[][2] = {{1, 1}, {10, 10}, {50, 50}, {100, 100}, {250, 250}};
+    const int num_indent = sizeof(indent) / sizeof(indent[0]);
+
+    double check_sum_first = 0;
+    for(int n = 0; n < num_indent; ++n) {
+        xquotes_history::QuotesHistory<> iQuotesHistory(
+            path,
+            xquotes_history::PRICE_OHLC,
+            xquotes_history::USE_COMPRESSION);
+
+        xquotes_storage::key_t min_key = 0, max_key = 0;
+        if(iQuotesHistory.get_min_max_key(min_key, max_key) != xquotes_history::OK) {
+            std::cout << "error! file: " << path << std::endl;
+            return 0;
+        }
+        const int start_day = (int)max_key - num_days > (int)min_key ? (int)max_key - num_days : (int)min_key;
+        const ztime::timestamp_t timestamp_start = (ztime::timestamp_t)start_day * ztime::SECONDS_IN_DAY;
+        const ztime::timestamp_t timestamp_stop = timestamp_start + (ztime::timestamp_t)num_days * ztime::SECONDS_IN_DAY;
+
+        iQuotesHistory.set_indent(indent[n][0], indent[n][1]);
+        double check_sum = 0;
+        int num_minutes = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for(ztime::timestamp_t t = timestamp_start; t < timestamp_stop; t += ztime::SECONDS_IN_MINUTE) {
+            xquotes_history::Candle candle;
+            if(iQuotesHistory.get_candle(candle, t) == xquotes_history::OK) check_sum += candle.close;
+            num_minutes++;
+        }
+        auto stop = std::chrono::high_resolution_clock::now();
+        const double time_ms = std::chrono::duration<double, std::milli>(stop - start).count();
+        std::cout << "indent " << indent[n][0] << "/" << indent[n][1]
+            << ": " << time_ms << " ms, "
+            << (time_ms * 1000000.0 / (double)num_minutes) << " ns per minute" << std::endl;
+        if(n == 0) check_sum_first = check_sum;
+        else if(check_sum != check_sum_first) std::cout << "error! check sum: " << check_sum << " != " << check_sum_first << std::endl;
+    }
+    std::cout << "end" << std::endl;
+    return 0;
+}
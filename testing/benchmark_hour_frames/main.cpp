@@ -0,0 +1,127 @@
+#include <iostream>
+#include "xquotes_history.hpp"
+#include <vector>
+#include <array>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+
+/* Программа сравнивает скорость проверки бинарных опционов в случайные моменты времени
+ * для обычных подфайлов и подфайлов с часовыми кадрами (set_hour_frames),
+ * а также скорость чтения дней целиком.
+ * Дни котировок берутся из исходного файла и переписываются во временные файлы
+ */
+
+typedef std::array<xquotes_history::Candle, xquotes_history::MINUTES_IN_DAY> candles_day_t;
+
+int main(int argc, char *argv[]) {
+    std::cout << "start!" << std::endl;
+    std::string path = argc > 1 ? argv[1] : "../../storage/EURGBP.qhs4"; // путь к файлу
+    const int num_options = 20000;
+    const int duration_sec = 180;
+
+    std::vector<candles_day_t> days;
+    std::vector<ztime::timestamp_t> days_timestamp;
+    int price_type = xquotes_history::PRICE_OHLC;
+    int file_version = xquotes_storage::FILE_VERSION_4;
+    {
+        xquotes_history::QuotesHistory<> iQuotesHistory(path, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+        price_type = iQuotesHistory.get_file_note() & 0x0F;
+        file_version = iQuotesHistory.get_file_version();
+        iQuotesHistory.enable_concurrent_read();
+        for(size_t s = 0; s < iQuotesHistory.get_num_subfiles(); ++s) {
+            const ztime::timestamp_t timestamp = iQuotesHistory.get_key_subfiles(s) * ztime::SECONDS_IN_DAY;
+            candles_day_t candles;
+            if(iQuotesHistory.read_day_candles_concurrent(candles, timestamp) != xquotes_history::OK) continue;
+            days.push_back(candles);
+            days_timestamp.push_back(timestamp);
+        }
+    }
+    std::cout << "days: " << days.size() << std::endl;
+    if(days.size() == 0) {
+        std::cout << "error! file: " << path << std::endl;
+        return 0;
+    }
+
+    // случайные моменты открытия опционов
+    std::vector<ztime::timestamp_t> options_timestamp(num_options);
+    std::mt19937 generator(12345);
+    std::uniform_int_distribution<size_t> day_distribution(0, days.size() - 1);
+    std::uniform_int_distribution<int> minute_distribution(0, xquotes_history::MINUTES_IN_DAY - 1);
+    for(int i = 0; i < num_options; ++i) {
+        options_timestamp[i] = days_timestamp[day_distribution(generator)] + minute_distribution(generator) * ztime::SECONDS_IN_MINUTE;
+    }
+
+    const char *mode_names[] = {
+        "subfile",
+        "hour frames",
+        "hour frames, cache 1 frame",
+        "hour frames + codec"};
+    const bool mode_frames[] = {false, true, true, true};
+    const size_t mode_cache[] = {0, 24, 1, 24};
+    const int mode_codecs[] = {xquotes_codec::CODEC_NONE, xquotes_codec::CODEC_NONE, xquotes_codec::CODEC_NONE,
+        xquotes_codec::CODEC_DELTA_ZIGZAG_BITPACK};
+    const std::string temp_path = "benchmark_hour_frames.tmp";
+    double time_subfile = 0;
+    int check_sum_subfile = 0;
+    for(int mode = 0; mode < 4; ++mode) {
+        remove(temp_path.c_str());
+        {
+            xquotes_history::QuotesHistory<> iQuotesHistory(temp_path, price_type, xquotes_history::USE_COMPRESSION);
+            iQuotesHistory.set_file_version(file_version);
+            iQuotesHistory.set_price_codec(mode_codecs[mode]);
+            iQuotesHistory.set_hour_frames(mode_frames[mode]);
+            iQuotesHistory.begin_batch(64 * 1024 * 1024);
+            for(size_t i = 0; i < days.size(); ++i) {
+                int err = iQuotesHistory.write_candles(days[i], days_timestamp[i]);
+                if(err != xquotes_history::OK) std::cout << "error! write, code: " << err << std::endl;
+            }
+            iQuotesHistory.commit();
+        }
+
+        // проверка опционов в случайные моменты времени
+        xquotes_history::QuotesHistory<> iQuotesHistory(temp_path, price_type, xquotes_history::USE_COMPRESSION);
+        if(mode_cache[mode] != 0) iQuotesHistory.set_hour_frames_cache(mode_cache[mode]);
+        int check_sum = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for(int i = 0; i < num_options; ++i) {
+            int state = 0;
+            int err = iQuotesHistory.check_binary_option(
+                state,
+                xquotes_history::BUY,
+                duration_sec,
+                options_timestamp[i],
+                xquotes_history::PRICE_CLOSE,
+                xquotes_history::WITHOUT_OPTIMIZATION);
+            if(err == xquotes_history::OK) check_sum += state + 2;
+        }
+        auto stop = std::chrono::high_resolution_clock::now();
+        const double time_option = std::chrono::duration<double, std::micro>(stop - start).count() / num_options;
+        if(mode == 0) {
+            time_subfile = time_option;
+            check_sum_subfile = check_sum;
+        }
+
+        // чтение дней целиком
+        iQuotesHistory.enable_concurrent_read();
+        candles_day_t candles;
+        size_t num_errors = 0;
+        auto start_days = std::chrono::high_resolution_clock::now();
+        for(size_t i = 0; i < days.size(); ++i) {
+            if(iQuotesHistory.read_day_candles_concurrent(candles, days_timestamp[i]) != xquotes_history::OK ||
+                candles[720].close != days[i][720].close) ++num_errors;
+        }
+        auto stop_days = std::chrono::high_resolution_clock::now();
+        const double time_day = std::chrono::duration<double, std::micro>(stop_days - start_days).count() / days.size();
+
+        std::cout << mode_names[mode] << ": " << bf::get_file_size(temp_path) << " bytes, "
+            << time_option << " us per option (x" << (time_subfile / time_option) << "), "
+            << time_day << " us per day";
+        if(num_errors != 0) std::cout << " error! days: " << num_errors;
+        if(check_sum != check_sum_subfile) std::cout << " error! check sum: " << check_sum;
+        std::cout << std::endl;
+    }
+    remove(temp_path.c_str());
+    std::cout << "end" << std::endl;
+    return 0;
+}
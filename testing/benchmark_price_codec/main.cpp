@@ -0,0 +1,101 @@
+#include <iostream>
+#include "xquotes_history.hpp"
+#include <vector>
+#include <array>
+#include <chrono>
+#include <stdio.h>
+
+/* Программа сравнивает размер файла и скорость чтения дней котировок
+ * для хранилищ со словарем zstd (текущий режим), с кодеком цен и словарем,
+ * с кодеком цен без сжатия zstd и без сжатия вообще.
+ * Дни котировок берутся из исходного файла и переписываются во временные файлы
+ */
+
+typedef std::array<xquotes_history::Candle, xquotes_history::MINUTES_IN_DAY> candles_day_t;
+
+int main(int argc, char *argv[]) {
+    std::cout << "start!" << std::endl;
+    std::string path = argc > 1 ? argv[1] : "../../storage/EURGBP.qhs4"; // путь к файлу
+    const int num_passes = 5;
+
+    std::vector<candles_day_t> days;
+    std::vector<ztime::timestamp_t> days_timestamp;
+    int price_type = xquotes_history::PRICE_OHLC;
+    int file_version = xquotes_storage::FILE_VERSION_4;
+    {
+        xquotes_history::QuotesHistory<> iQuotesHistory(path, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+        price_type = iQuotesHistory.get_file_note() & 0x0F;
+        file_version = iQuotesHistory.get_file_version();
+        iQuotesHistory.enable_concurrent_read();
+        for(size_t s = 0; s < iQuotesHistory.get_num_subfiles(); ++s) {
+            const ztime::timestamp_t timestamp = iQuotesHistory.get_key_subfiles(s) * ztime::SECONDS_IN_DAY;
+            candles_day_t candles;
+            if(iQuotesHistory.read_day_candles_concurrent(candles, timestamp) != xquotes_history::OK) continue;
+            days.push_back(candles);
+            days_timestamp.push_back(timestamp);
+        }
+    }
+    std::cout << "days: " << days.size() << std::endl;
+    if(days.size() == 0) {
+        std::cout << "error! file: " << path << std::endl;
+        return 0;
+    }
+
+    const char *mode_names[] = {"zstd dictionary", "codec + zstd dictionary", "codec", "raw"};
+    const int mode_options[] = {xquotes_history::USE_COMPRESSION, xquotes_history::USE_COMPRESSION, xquotes_history::DO_NOT_USE_COMPRESSION, xquotes_history::DO_NOT_USE_COMPRESSION};
+    const int mode_codecs[] = {xquotes_codec::CODEC_NONE, xquotes_codec::CODEC_DELTA_ZIGZAG_BITPACK, xquotes_codec::CODEC_DELTA_ZIGZAG_BITPACK, xquotes_codec::CODEC_NONE};
+    const std::string temp_path = "benchmark_price_codec.tmp";
+    double time_dictionary = 0;
+    for(int mode = 0; mode < 4; ++mode) {
+        remove(temp_path.c_str());
+        {
+            xquotes_history::QuotesHistory<> iQuotesHistory(temp_path, price_type, mode_options[mode]);
+            iQuotesHistory.set_file_version(file_version);
+            iQuotesHistory.set_price_codec(mode_codecs[mode]);
+            iQuotesHistory.begin_batch(64 * 1024 * 1024);
+            for(size_t i = 0; i < days.size(); ++i) {
+                int err = iQuotesHistory.write_candles(days[i], days_timestamp[i]);
+                if(err != xquotes_history::OK) std::cout << "error! write, code: " << err << std::endl;
+            }
+            iQuotesHistory.commit();
+        }
+
+        xquotes_history::QuotesHistory<> iQuotesHistory(temp_path, price_type, mode_options[mode]);
+        iQuotesHistory.enable_concurrent_read();
+        candles_day_t candles;
+        double check_sum = 0;
+        size_t num_errors = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for(int n = 0; n < num_passes; ++n) {
+            for(size_t i = 0; i < days.size(); ++i) {
+                if(iQuotesHistory.read_day_candles_concurrent(candles, days_timestamp[i]) != xquotes_history::OK) continue;
+                check_sum += candles[720].close;
+            }
+        }
+        auto stop = std::chrono::high_resolution_clock::now();
+
+        // проверим, что данные не изменились
+        for(size_t i = 0; i < days.size(); ++i) {
+            if(iQuotesHistory.read_day_candles_concurrent(candles, days_timestamp[i]) != xquotes_history::OK) {
+                ++num_errors;
+                continue;
+            }
+            for(int m = 0; m < xquotes_history::MINUTES_IN_DAY; ++m) {
+                if(candles[m].close != days[i][m].close || candles[m].open != days[i][m].open) {
+                    ++num_errors;
+                    break;
+                }
+            }
+        }
+
+        const double time_day = std::chrono::duration<double, std::micro>(stop - start).count() / ((double)days.size() * num_passes);
+        if(mode == 0) time_dictionary = time_day;
+        std::cout << mode_names[mode] << ": " << bf::get_file_size(temp_path) << " bytes, "
+            << time_day << " us per day (x" << (time_dictionary / time_day) << ")";
+        if(num_errors != 0) std::cout << " error! days: " << num_errors;
+        std::cout << " check sum: " << check_sum << std::endl;
+    }
+    remove(temp_path.c_str());
+    std::cout << "end" << std::endl;
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include <iostream>
+#include "xquotes_simd.hpp"
+#include <array>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+
+/* Программа сравнивает скорость конвертации дня котировок (блока из 1440 записей)
+ * из буфера цен price_t в массив свечей и обратно для скалярного кода, SSE4.1 и AVX2.
+ * Проверяются все три формата буфера: только одна цена, OHLC и OHLCV
+ */
+int main() {
+    std::cout << "start!" << std::endl;
+    const int num_passes = 20000;
+    const size_t candle_stride = sizeof(xquotes_common::Candle) / sizeof(double);
+    const size_t record_sizes[] = {1, 4, 5};
+    const char *level_names[] = {"scalar", "sse4.1", "avx2"};
+
+    std::mt19937 rng(1);
+    std::array<xquotes_common::Candle, xquotes_common::MINUTES_IN_DAY> candles;
+    std::vector<xquotes_common::price_t> buffer(xquotes_common::MINUTES_IN_DAY * 5);
+    for(size_t i = 0; i < buffer.size(); ++i) {
+        buffer[i] = 100000 + rng() % 50000;
+    }
+    std::vector<xquotes_common::price_t> check_buffer(buffer.size());
+
+    const int max_level = xquotes_simd::detect_simd_level();
+    std::cout << "cpu: " << level_names[max_level] << std::endl;
+    for(size_t r = 0; r < sizeof(record_sizes) / sizeof(record_sizes[0]); ++r) {
+        const size_t record_size = record_sizes[r];
+        double *first_price = record_size == 1 ? &candles[0].close : &candles[0].open;
+        const double day_bytes = (double)(xquotes_common::MINUTES_IN_DAY * record_size * sizeof(xquotes_common::price_t));
+        std::cout << "prices per minute: " << record_size << std::endl;
+        double time_read_scalar = 0, time_write_scalar = 0;
+        for(int level = xquotes_simd::SIMD_NONE; level <= max_level; ++level) {
+            xquotes_simd::set_simd_level(level);
+
+            auto start_read = std::chrono::high_resolution_clock::now();
+            for(int n = 0; n < num_passes; ++n) {
+                xquotes_simd::convert_prices_to_doubles(buffer.data(), first_price, xquotes_common::MINUTES_IN_DAY, record_size, candle_stride);
+            }
+            auto stop_read = std::chrono::high_resolution_clock::now();
+
+            auto start_write = std::chrono::high_resolution_clock::now();
+            for(int n = 0; n < num_passes; ++n) {
+                xquotes_simd::convert_doubles_to_prices(first_price, candle_stride, check_buffer.data(), xquotes_common::MINUTES_IN_DAY, record_size);
+            }
+            auto stop_write = std::chrono::high_resolution_clock::now();
+
+            for(size_t i = 0; i < xquotes_common::MINUTES_IN_DAY * record_size; ++i) {
+                if(check_buffer[i] != buffer[i]) {
+                    std::cout << "error! " << level_names[level] << " index " << i << ": " << check_buffer[i] << " != " << buffer[i] << std::endl;
+                    break;
+                }
+            }
+
+            const double time_read = std::chrono::duration<double, std::nano>(stop_read - start_read).count() / num_passes;
+            const double time_write = std::chrono::duration<double, std::nano>(stop_write - start_write).count() / num_passes;
+            if(level == xquotes_simd::SIMD_NONE) {
+                time_read_scalar = time_read;
+                time_write_scalar = time_write;
+            }
+            std::cout << "  " << level_names[level]
+                << " read: " << time_read << " ns per day (" << (day_bytes / time_read) << " GB/s, x" << (time_read_scalar / time_read) << ")"
+                << " write: " << time_write << " ns per day (" << (day_bytes / time_write) << " GB/s, x" << (time_write_scalar / time_write) << ")"
+                << std::endl;
+        }
+    }
+    std::cout << "end" << std::endl;
+    return 0;
+}
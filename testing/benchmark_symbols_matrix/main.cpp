@@ -0,0 +1,92 @@
+#include <iostream>
+#include "xquotes_history.hpp"
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cmath>
+
+/* Программа сравнивает скорость получения свечей всех символов за период
+ * вызовами get_symbols_candle для каждой минуты и матрицей [минуты x символы] методом get_symbols_matrix
+ * (из окна котировок и пулом потоков). Все символы читаются из одного файла котировок.
+ * Окно котировок каждого символа вмещает весь период, время измеряется на повторном проходе, матрица используется повторно
+ */
+
+typedef xquotes_history::MultipleQuotesHistory<> multiple_quotes_history_t;
+
+int main(int argc, char *argv[]) {
+    std::cout << "start!" << std::endl;
+    std::string path = argc > 1 ? argv[1] : "../../storage/EURGBP.qhs4"; // путь к файлу
+    const int num_symbols = 8;
+    const int num_days = 5;
+    const int num_passes = 3;
+    const int indent_day_up = num_days + 2;
+
+    std::vector<std::string> paths(num_symbols, path);
+    ztime::timestamp_t min_timestamp = 0, max_timestamp = 0;
+    {
+        multiple_quotes_history_t iMultipleQuotesHistory(paths, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+        if(iMultipleQuotesHistory.get_min_max_day_timestamp(min_timestamp, max_timestamp) != xquotes_history::OK ||
+            max_timestamp - min_timestamp < (ztime::timestamp_t)num_days * ztime::SECONDS_IN_DAY) {
+            std::cout << "error! file: " << path << std::endl;
+            return 0;
+        }
+    }
+    const ztime::timestamp_t timestamp_stop = min_timestamp + num_days * ztime::SECONDS_IN_DAY - ztime::SECONDS_IN_MINUTE;
+    std::cout << "symbols: " << num_symbols << ", days: " << num_days << std::endl;
+
+    // свечи по минутам
+    double sum_price = 0, time_price = 0;
+    {
+        multiple_quotes_history_t iMultipleQuotesHistory(paths, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+        for(int s = 0; s < num_symbols; ++s) {
+            iMultipleQuotesHistory.get_quotes_history(s)->set_indent(0, indent_day_up);
+        }
+        std::vector<xquotes_history::Candle> symbols_candle;
+        for(int pass = 0; pass < num_passes; ++pass) {
+            sum_price = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for(ztime::timestamp_t t = min_timestamp; t <= timestamp_stop; t += ztime::SECONDS_IN_MINUTE) {
+                iMultipleQuotesHistory.get_symbols_candle(symbols_candle, t);
+                for(int s = 0; s < num_symbols; ++s) sum_price += symbols_candle[s].close;
+            }
+            auto stop = std::chrono::high_resolution_clock::now();
+            time_price = std::chrono::duration<double, std::milli>(stop - start).count();
+        }
+        std::cout << "get_symbols_candle: " << time_price << " ms" << std::endl;
+    }
+
+    // матрицы
+    const int num_hardware_thread = std::max((int)std::thread::hardware_concurrency(), 1);
+    const char *mode_names[] = {"get_symbols_matrix, window", "get_symbols_matrix, thread pool"};
+    for(int mode = 0; mode < 2; ++mode) {
+        multiple_quotes_history_t iMultipleQuotesHistory(paths, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+        for(int s = 0; s < num_symbols; ++s) {
+            iMultipleQuotesHistory.get_quotes_history(s)->set_indent(0, indent_day_up);
+        }
+        // пулу нужно больше одного потока, иначе матрица заполняется из окна котировок
+        if(mode == 1) {
+            iMultipleQuotesHistory.set_thread_pool(std::max(num_hardware_thread, 2));
+            iMultipleQuotesHistory.enable_concurrent_read();
+        }
+        xquotes_history::SymbolsMatrix matrix;
+        double sum_matrix = 0, time_matrix = 0;
+        int err = xquotes_history::OK;
+        for(int pass = 0; pass < num_passes; ++pass) {
+            sum_matrix = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            err = iMultipleQuotesHistory.get_symbols_matrix(matrix, min_timestamp, timestamp_stop, mode == 1);
+            for(size_t m = 0; m < matrix.get_num_minutes(); ++m) {
+                const xquotes_history::Span<const double> row = matrix.row(xquotes_history::CandleColumns::COLUMN_CLOSE, m);
+                for(size_t s = 0; s < row.size(); ++s) sum_matrix += row[s];
+            }
+            auto stop = std::chrono::high_resolution_clock::now();
+            time_matrix = std::chrono::duration<double, std::milli>(stop - start).count();
+        }
+        std::cout << mode_names[mode] << ": " << time_matrix << " ms (x" << (time_price / time_matrix) << ")";
+        if(err != xquotes_history::OK) std::cout << " error! code: " << err;
+        if(std::abs(sum_matrix - sum_price) > 1e-6) std::cout << " error! sum: " << sum_matrix << " " << sum_price;
+        std::cout << std::endl;
+    }
+    std::cout << "end" << std::endl;
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <iostream>
+#include "xquotes_history.hpp"
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+/* Программа сравнивает скорость многократных коротких прогонов trade_multiple_threads,
+ * как при переборе параметров оптимизатором: потоки, создаваемые заново при каждом вызове
+ * (так работал метод раньше), и пул потоков, который создается один раз.
+ * Все символы читаются из одного файла котировок.
+ * В конце выводится загрузка потоков пула
+ */
+
+typedef xquotes_history::MultipleQuotesHistory<> multiple_quotes_history_t;
+
+/** \brief Торговать в несколько потоков, создавая потоки при каждом вызове
+ */
+int trade_spawn_threads(
+        multiple_quotes_history_t &iMultipleQuotesHistory,
+        const ztime::timestamp_t start_timestamp,
+        const int step_timestamp,
+        const int num_days,
+        const std::vector<bool> &is_symbol,
+        std::function<void(const xquotes_history::Candle &candle, const int day, const int symbol_ind, const int thread_ind, const int err)> f) {
+    std::vector<ztime::timestamp_t> list_timestamp;
+    int err = iMultipleQuotesHistory.get_day_timestamp_list(list_timestamp, start_timestamp, is_symbol, num_days, true, false);
+    if(err != xquotes_history::OK || (int)list_timestamp.size() != num_days) return xquotes_history::DATA_NOT_AVAILABLE;
+    const int num_symbols = is_symbol.size();
+    const int num_thread = std::min(num_symbols, std::max((int)std::thread::hardware_concurrency(), 1));
+    std::vector<std::thread> list_thread(num_thread);
+    for(int thread_ind = 0; thread_ind < num_thread; ++thread_ind) {
+        list_thread[thread_ind] = std::thread([&, thread_ind, num_thread]() {
+            for(int i = 0; i < num_days; ++i) {
+                const ztime::timestamp_t stop_timestamp = list_timestamp[i] + ztime::SECONDS_IN_DAY;
+                for(ztime::timestamp_t t = list_timestamp[i]; t < stop_timestamp; t += step_timestamp) {
+                    for(int s = thread_ind; s < num_symbols; s += num_thread) {
+                        xquotes_history::Candle candle;
+                        int err = iMultipleQuotesHistory.get_candle(candle, t, s);
+                        f(candle, i, s, thread_ind, err);
+                    }
+                }
+            }
+        });
+    }
+    for(size_t i = 0; i < list_thread.size(); ++i) {
+        list_thread[i].join();
+    }
+    return xquotes_history::OK;
+}
+
+int main(int argc, char *argv[]) {
+    std::cout << "start!" << std::endl;
+    std::string path = argc > 1 ? argv[1] : "../../storage/EURGBP.qhs4"; // путь к файлу
+    const int num_symbols = 8;
+    const int num_days = 2;
+    const int num_calls = 200;
+    const int step_timestamp = ztime::SECONDS_IN_MINUTE * 5;
+
+    std::vector<std::string> paths(num_symbols, path);
+    multiple_quotes_history_t iMultipleQuotesHistory(paths, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+    ztime::timestamp_t min_timestamp = 0, max_timestamp = 0;
+    if(iMultipleQuotesHistory.get_min_max_day_timestamp(min_timestamp, max_timestamp) != xquotes_history::OK ||
+        max_timestamp - min_timestamp < (ztime::timestamp_t)(num_days + 7) * ztime::SECONDS_IN_DAY) {
+        std::cout << "error! file: " << path << std::endl;
+        return 0;
+    }
+    const std::vector<bool> is_symbol(num_symbols, true);
+
+    // проверка считает сумму цен закрытия по символам, сумма должна совпасть у обоих способов
+    std::vector<std::atomic<long long>> check_sum(num_symbols);
+    auto f = [&](const xquotes_history::Candle &candle, const int day, const int symbol_ind, const int thread_ind, const int err) {
+        (void)day;
+        (void)thread_ind;
+        if(err == xquotes_history::OK) check_sum[symbol_ind] += (long long)(candle.close * 100000.0 + 0.5);
+    };
+
+    long long check_sum_spawn = 0, check_sum_pool = 0;
+    double time_spawn = 0, time_pool = 0;
+    for(int pass = 0; pass < 2; ++pass) {
+        // первый проход загружает дни в окно котировок
+        for(int s = 0; s < num_symbols; ++s) check_sum[s] = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for(int call = 0; call < num_calls; ++call) {
+            trade_spawn_threads(iMultipleQuotesHistory, min_timestamp, step_timestamp, num_days, is_symbol, f);
+        }
+        auto stop = std::chrono::high_resolution_clock::now();
+        time_spawn = std::chrono::duration<double, std::milli>(stop - start).count();
+        check_sum_spawn = 0;
+        for(int s = 0; s < num_symbols; ++s) check_sum_spawn += check_sum[s];
+
+        for(int s = 0; s < num_symbols; ++s) check_sum[s] = 0;
+        start = std::chrono::high_resolution_clock::now();
+        for(int call = 0; call < num_calls; ++call) {
+            iMultipleQuotesHistory.trade_multiple_threads(min_timestamp, step_timestamp, num_days, is_symbol, f, true, false);
+        }
+        stop = std::chrono::high_resolution_clock::now();
+        time_pool = std::chrono::duration<double, std::milli>(stop - start).count();
+        check_sum_pool = 0;
+        for(int s = 0; s < num_symbols; ++s) check_sum_pool += check_sum[s];
+    }
+
+    std::cout << "calls: " << num_calls << ", symbols: " << num_symbols << ", days: " << num_days << std::endl;
+    std::cout << "spawn threads: " << (time_spawn / num_calls) << " ms per call" << std::endl;
+    std::cout << "thread pool: " << (time_pool / num_calls) << " ms per call (x" << (time_spawn / time_pool) << ")" << std::endl;
+    if(check_sum_spawn != check_sum_pool) std::cout << "error! check sum: " << check_sum_spawn << " " << check_sum_pool << std::endl;
+
+    std::vector<xquotes_thread_pool::ThreadStats> stats;
+    iMultipleQuotesHistory.get_thread_stats(stats);
+    for(size_t i = 0; i < stats.size(); ++i) {
+        std::cout << "thread " << i << ": tasks " << stats[i].num_tasks << ", stolen " << stats[i].num_stolen
+            << ", busy " << (stats[i].busy_time * 1000.0) << " ms, utilization " << (stats[i].utilization * 100.0) << "%" << std::endl;
+    }
+    std::cout << "end" << std::endl;
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include <iostream>
+#include "xquotes_history.hpp"
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <cmath>
+
+/* Программа сравнивает скорость торговли при передаче функции обработки как std::function
+ * (так работали методы trade раньше), как лямбда-функции (параметр шаблона)
+ * и при обработке дня целиком методом trade_day_views.
+ * Стратегия считает сумму цен закрытия и количество минут, в которые цена выросла.
+ * Все дни помещаются в окно котировок, время измеряется на повторном проходе, поэтому чтение файла не влияет на результат
+ */
+
+/// Результат торговли
+struct TradeResult {
+    double sum = 0;
+    long long num_candles = 0;
+    long long num_up = 0;
+    double last_close = 0;
+
+    inline void add(const double close) {
+        if(close == 0.0) return;
+        sum += close;
+        ++num_candles;
+        if(last_close != 0.0 && close > last_close) ++num_up;
+        last_close = close;
+    }
+
+    bool operator == (const TradeResult &other) const {
+        return num_candles == other.num_candles && num_up == other.num_up && std::abs(sum - other.sum) < 1e-6;
+    }
+};
+
+template<class FUNC>
+double measure(const int num_passes, FUNC run) {
+    double time = 0;
+    for(int pass = 0; pass < num_passes; ++pass) {
+        auto start = std::chrono::high_resolution_clock::now();
+        run();
+        auto stop = std::chrono::high_resolution_clock::now();
+        if(pass > 0) time += std::chrono::duration<double, std::milli>(stop - start).count() / (num_passes - 1);
+    }
+    return time;
+}
+
+void print(const std::string &name, const double time, const double time_function, const TradeResult &result, const TradeResult &result_function) {
+    std::cout << name << ": " << time << " ms (x" << (time_function / time) << ")";
+    if(!(result == result_function)) std::cout << " error! result: " << result.num_candles << " " << result.num_up;
+    std::cout << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    std::cout << "start!" << std::endl;
+    std::string path = argc > 1 ? argv[1] : "../../storage/EURGBP.qhs4"; // путь к файлу
+    const int num_days = 100;
+    const int indent_day_up = 160;
+    const int num_passes = 4;
+    const int num_symbols = 4;
+
+    xquotes_history::QuotesHistory<> iQuotesHistory(path, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+    ztime::timestamp_t min_timestamp = 0, max_timestamp = 0;
+    if(iQuotesHistory.get_min_max_day_timestamp(min_timestamp, max_timestamp) != xquotes_history::OK ||
+        max_timestamp - min_timestamp < (ztime::timestamp_t)indent_day_up * ztime::SECONDS_IN_DAY) {
+        std::cout << "error! file: " << path << std::endl;
+        return 0;
+    }
+    iQuotesHistory.set_indent(0, indent_day_up);
+
+    std::cout << "QuotesHistory, days: " << num_days << std::endl;
+    TradeResult result_function, result_lambda, result_views;
+    std::function<void(const xquotes_history::Candle &candle, const int day, const int err)> function =
+        [&](const xquotes_history::Candle &candle, const int day, const int err) {
+        (void)day;
+        if(err == xquotes_history::OK) result_function.add(candle.close);
+    };
+    const double time_function = measure(num_passes, [&]() {
+        result_function = TradeResult();
+        iQuotesHistory.trade(min_timestamp, ztime::SECONDS_IN_MINUTE, num_days, function, true, false);
+    });
+    std::cout << "std::function: " << time_function << " ms" << std::endl;
+
+    const double time_lambda = measure(num_passes, [&]() {
+        result_lambda = TradeResult();
+        iQuotesHistory.trade(min_timestamp, ztime::SECONDS_IN_MINUTE, num_days,
+            [&](const xquotes_history::Candle &candle, const int day, const int err) {
+            (void)day;
+            if(err == xquotes_history::OK) result_lambda.add(candle.close);
+        }, true, false);
+    });
+    print("lambda", time_lambda, time_function, result_lambda, result_function);
+
+    const double time_views = measure(num_passes, [&]() {
+        result_views = TradeResult();
+        iQuotesHistory.trade_day_views(min_timestamp, num_days,
+            [&](const xquotes_history::CandlesView &view, const int day, const int err) {
+            (void)day;
+            if(err != xquotes_history::OK) return;
+            for(size_t i = 0; i < view.size(); ++i) {
+                result_views.add(view.close[i]);
+            }
+        }, true, false);
+    });
+    print("trade_day_views", time_views, time_function, result_views, result_function);
+
+    // несколько символов
+    std::cout << "MultipleQuotesHistory, symbols: " << num_symbols << ", days: " << num_days << std::endl;
+    std::vector<std::string> paths(num_symbols, path);
+    xquotes_history::MultipleQuotesHistory<> iMultipleQuotesHistory(paths, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+    for(int s = 0; s < num_symbols; ++s) {
+        iMultipleQuotesHistory.get_quotes_history(s)->set_indent(0, indent_day_up);
+    }
+    const std::vector<bool> is_symbol(num_symbols, true);
+    std::vector<TradeResult> results_function(num_symbols), results_lambda(num_symbols), results_views(num_symbols);
+    std::function<void(const xquotes_history::Candle &candle, const int day, const int symbol_ind, const int err)> multiple_function =
+        [&](const xquotes_history::Candle &candle, const int day, const int symbol_ind, const int err) {
+        (void)day;
+        if(err == xquotes_history::OK) results_function[symbol_ind].add(candle.close);
+    };
+    const double time_multiple_function = measure(num_passes, [&]() {
+        std::fill(results_function.begin(), results_function.end(), TradeResult());
+        iMultipleQuotesHistory.trade(min_timestamp, ztime::SECONDS_IN_MINUTE, num_days, is_symbol, multiple_function, true, false);
+    });
+    std::cout << "std::function: " << time_multiple_function << " ms" << std::endl;
+
+    const double time_multiple_lambda = measure(num_passes, [&]() {
+        std::fill(results_lambda.begin(), results_lambda.end(), TradeResult());
+        iMultipleQuotesHistory.trade(min_timestamp, ztime::SECONDS_IN_MINUTE, num_days, is_symbol,
+            [&](const xquotes_history::Candle &candle, const int day, const int symbol_ind, const int err) {
+            (void)day;
+            if(err == xquotes_history::OK) results_lambda[symbol_ind].add(candle.close);
+        }, true, false);
+    });
+    print("lambda", time_multiple_lambda, time_multiple_function, results_lambda[num_symbols - 1], results_function[num_symbols - 1]);
+
+    const double time_multiple_views = measure(num_passes, [&]() {
+        std::fill(results_views.begin(), results_views.end(), TradeResult());
+        iMultipleQuotesHistory.trade_day_views(min_timestamp, num_days, is_symbol,
+            [&](const xquotes_history::CandlesView &view, const int day, const int symbol_ind, const int err) {
+            (void)day;
+            if(err != xquotes_history::OK) return;
+            TradeResult &result = results_views[symbol_ind];
+            for(size_t i = 0; i < view.size(); ++i) {
+                result.add(view.close[i]);
+            }
+        }, true, false);
+    });
+    print("trade_day_views", time_multiple_views, time_multiple_function, results_views[num_symbols - 1], results_function[num_symbols - 1]);
+    std::cout << "end" << std::endl;
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <iostream>
+#include "xquotes_storage.hpp"
+#include "xquotes_dictionary_candles.hpp"
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <stdio.h>
+
+/* Программа сравнивает скорость распаковки подфайлов
+ * старым способом (контекст и словарь создаются на каждый подфайл)
+ * и через долгоживущий контекст хранилища с подготовленным словарем
+ */
+int main(int argc, char *argv[]) {
+    std::cout << "start!" << std::endl;
+    std::string path = argc > 1 ? argv[1] : "../../storage/EURGBP.qhs4"; // путь к файлу
+    const int num_passes = 10;
+
+    xquotes_storage::Storage iStorage(
+        path,
+        (const char*)xquotes_dictionary::dictionary_candles,
+        sizeof(xquotes_dictionary::dictionary_candles));
+
+    xquotes_storage::key_t min_key = 0, max_key = 0;
+    if(iStorage.get_min_max_key(min_key, max_key) != xquotes_storage::OK) {
+        std::cout << "error! file: " << path << std::endl;
+        return 0;
+    }
+    std::vector<xquotes_storage::key_t> keys;
+    for(xquotes_storage::key_t key = min_key; key <= max_key; ++key) {
+        if(iStorage.check_subfile(key)) keys.push_back(key);
+        if(key == max_key) break;
+    }
+    std::cout << "subfiles: " << keys.size() << std::endl;
+    if(keys.size() == 0) return 0;
+
+    const unsigned long max_decompress_size = 1440 * 4 * sizeof(xquotes_storage::price_t) * 2;
+    std::unique_ptr<char[]> decompress_buffer(new char[max_decompress_size]);
+    unsigned long check_sum_old = 0, check_sum_new = 0;
+
+    /* старый способ: на каждый подфайл создается контекст, словарь каждый раз разбирается заново */
+    auto start_old = std::chrono::high_resolution_clock::now();
+    for(int n = 0; n < num_passes; ++n) {
+        for(size_t i = 0; i < keys.size(); ++i) {
+            char *subfile_buffer = NULL;
+            unsigned long subfile_size = 0;
+            if(iStorage.read_subfile(keys[i], subfile_buffer, subfile_size) != xquotes_storage::OK) continue;
+            ZSTD_DCtx* const dctx = ZSTD_createDCtx();
+            const size_t decompress_size = ZSTD_decompress_usingDict(
+                dctx,
+                decompress_buffer.get(),
+                max_decompress_size,
+                subfile_buffer,
+                subfile_size,
+                xquotes_dictionary::dictionary_candles,
+                sizeof(xquotes_dictionary::dictionary_candles));
+            ZSTD_freeDCtx(dctx);
+            delete [] subfile_buffer;
+            if(!ZSTD_isError(decompress_size)) check_sum_old += decompress_size;
+        }
+    }
+    auto stop_old = std::chrono::high_resolution_clock::now();
+
+    /* новый способ: контекст хранилища и подготовленный словарь */
+    char *buffer = NULL;
+    unsigned long buffer_size = 0;
+    auto start_new = std::chrono::high_resolution_clock::now();
+    for(int n = 0; n < num_passes; ++n) {
+        for(size_t i = 0; i < keys.size(); ++i) {
+            if(iStorage.read_compressed_subfile(keys[i], buffer, buffer_size) != xquotes_storage::OK) continue;
+            check_sum_new += buffer_size;
+        }
+    }
+    auto stop_new = std::chrono::high_resolution_clock::now();
+    delete [] buffer;
+
+    const double num_reads = (double)keys.size() * num_passes;
+    const double time_old = std::chrono::duration<double, std::micro>(stop_old - start_old).count();
+    const double time_new = std::chrono::duration<double, std::micro>(stop_new - start_new).count();
+    std::cout << "old: " << (time_old / num_reads) << " us per day" << std::endl;
+    std::cout << "new: " << (time_new / num_reads) << " us per day" << std::endl;
+    std::cout << "speedup: " << (time_old / time_new) << std::endl;
+    if(check_sum_old != check_sum_new) std::cout << "error! check sum: " << check_sum_old << " != " << check_sum_new << std::endl;
+    std::cout << "end" << std::endl;
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <iostream>
+#include "xquotes_history.hpp"
+#include "../testing_common.hpp"
+#include <random>
+#include <stdio.h>
+
+/* Программа проверяет хранение столбцов цен (set_column_frames) и часов дня (set_hour_frames)
+ * в отдельных кадрах подфайлов. Одни и те же дни котировок записываются в файл с кадрами
+ * (с кодеком цен и без него) и в обычный файл для обоих форматов файла, всех типов цен, со сжатием и без.
+ * После повторного открытия свечи каждой минуты из обоих файлов должны совпадать,
+ * при чтении только цен закрытия (set_read_columns) должны совпадать цены закрытия,
+ * а для часовых кадров свечи и бинарные опционы в случайные моменты времени
+ */
+
+typedef xquotes_history::QuotesHistory<> quotes_history_t;
+
+const int num_days = 20;
+const int gap_start = 1301;    // пропуск котировок в конце дня
+const int gap_stop = xquotes_history::MINUTES_IN_DAY;
+
+enum FramesType {
+    COLUMN_FRAMES = 0,
+    HOUR_FRAMES = 1,
+};
+
+int main() {
+    std::cout << "start!" << std::endl;
+    const std::string path_frames = "test_frames.qhs4";
+    const std::string path_plain = "test_plain.qhs4";
+    const int file_versions[] = {xquotes_storage::FILE_VERSION_4, xquotes_storage::FILE_VERSION_5};
+    const int price_types[] = {xquotes_history::PRICE_CLOSE, xquotes_history::PRICE_OHLC, xquotes_history::PRICE_OHLCV};
+    int num_errors = 0;
+
+    for(int frames_type = COLUMN_FRAMES; frames_type <= HOUR_FRAMES; ++frames_type)
+    for(int file_version : file_versions)
+    for(int is_compression = 0; is_compression < 2; ++is_compression)
+    for(int codec = xquotes_codec::CODEC_NONE; codec <= xquotes_codec::CODEC_DELTA_ZIGZAG_BITPACK; ++codec)
+    for(int price_type : price_types) {
+        const int option = is_compression ? xquotes_history::USE_COMPRESSION : xquotes_history::DO_NOT_USE_COMPRESSION;
+        remove(path_frames.c_str());
+        remove(path_plain.c_str());
+        {
+            quotes_history_t iQuotesHistoryFrames(path_frames, price_type, option);
+            quotes_history_t iQuotesHistoryPlain(path_plain, price_type, option);
+            iQuotesHistoryFrames.set_file_version(file_version);
+            iQuotesHistoryPlain.set_file_version(file_version);
+            iQuotesHistoryFrames.set_price_codec(codec);
+            if(frames_type == COLUMN_FRAMES) {
+                if(iQuotesHistoryFrames.set_column_frames(true) != xquotes_history::OK) ++num_errors;
+                if(iQuotesHistoryFrames.set_hour_frames(true) != xquotes_history::INVALID_PARAMETER) ++num_errors;
+            } else {
+                if(iQuotesHistoryFrames.set_hour_frames(true) != xquotes_history::OK) ++num_errors;
+                if(iQuotesHistoryFrames.set_column_frames(true) != xquotes_history::INVALID_PARAMETER) ++num_errors;
+            }
+            for(int d = 0; d < num_days; ++d) {
+                xquotes_testing::candles_array_t candles;
+                xquotes_testing::get_test_candles(candles, d, gap_start, gap_stop);
+                if(iQuotesHistoryFrames.write_candles(candles, candles[0].timestamp) != xquotes_history::OK) ++num_errors;
+                if(iQuotesHistoryPlain.write_candles(candles, candles[0].timestamp) != xquotes_history::OK) ++num_errors;
+            }
+            // кадры нельзя выключить после записи данных
+            if(iQuotesHistoryFrames.set_column_frames(false) != xquotes_history::INVALID_PARAMETER) ++num_errors;
+            if(iQuotesHistoryFrames.set_hour_frames(false) != xquotes_history::INVALID_PARAMETER) ++num_errors;
+        }
+        quotes_history_t iQuotesHistoryFrames(path_frames, xquotes_history::PRICE_CLOSE, xquotes_history::DO_NOT_USE_COMPRESSION);
+        quotes_history_t iQuotesHistoryPlain(path_plain, xquotes_history::PRICE_CLOSE, xquotes_history::DO_NOT_USE_COMPRESSION);
+        if(iQuotesHistoryFrames.is_column_frames() != (frames_type == COLUMN_FRAMES) ||
+            iQuotesHistoryFrames.is_hour_frames() != (frames_type == HOUR_FRAMES) ||
+            iQuotesHistoryPlain.is_column_frames() || iQuotesHistoryPlain.is_hour_frames()) ++num_errors;
+        int num_candle_errors = 0;
+        // сначала читаются все столбцы, затем только цены закрытия (только для кадров по столбцам)
+        const int num_steps = frames_type == COLUMN_FRAMES ? 2 : 1;
+        for(int step = 0; step < num_steps; ++step) {
+            if(step == 1 && iQuotesHistoryFrames.set_read_columns(1 << xquotes_history::CandleColumns::COLUMN_CLOSE) != xquotes_history::OK) ++num_errors;
+            for(int d = 0; d < num_days; ++d) {
+                const ztime::timestamp_t timestamp = xquotes_testing::get_test_day_timestamp(d);
+                for(int i = 0; i < xquotes_history::MINUTES_IN_DAY; ++i) {
+                    xquotes_history::Candle candle_frames, candle_plain;
+                    int err_frames = iQuotesHistoryFrames.get_candle(candle_frames, timestamp + i * ztime::SECONDS_IN_MINUTE);
+                    int err_plain = iQuotesHistoryPlain.get_candle(candle_plain, timestamp + i * ztime::SECONDS_IN_MINUTE);
+                    if(err_frames != err_plain) ++num_candle_errors;
+                    else if(step == 0 && !xquotes_testing::is_equal(candle_frames, candle_plain)) ++num_candle_errors;
+                    else if(step == 1 && candle_frames.close != candle_plain.close) ++num_candle_errors;
+                }
+            }
+        }
+        // часовые кадры дней вне окна котировок читаются по одному через кэш кадров
+        if(frames_type == HOUR_FRAMES) {
+            quotes_history_t iQuotesHistoryRandom(path_frames, xquotes_history::PRICE_CLOSE, xquotes_history::DO_NOT_USE_COMPRESSION);
+            iQuotesHistoryRandom.set_hour_frames_cache(3);
+            std::mt19937 generator(12345);
+            for(int n = 0; n < 5000; ++n) {
+                const ztime::timestamp_t timestamp = xquotes_testing::get_test_day_timestamp(generator() % (num_days + 2)) +
+                    (generator() % xquotes_history::MINUTES_IN_DAY) * ztime::SECONDS_IN_MINUTE;
+                xquotes_history::Candle candle_frames, candle_plain;
+                int err_frames = iQuotesHistoryRandom.get_candle(candle_frames, timestamp, xquotes_history::WITHOUT_OPTIMIZATION);
+                int err_plain = iQuotesHistoryPlain.get_candle(candle_plain, timestamp, xquotes_history::WITHOUT_OPTIMIZATION);
+                if(err_frames != err_plain || (err_frames == xquotes_history::OK && !xquotes_testing::is_equal(candle_frames, candle_plain))) ++num_candle_errors;
+                int state_frames = xquotes_history::NEUTRAL, state_plain = xquotes_history::NEUTRAL;
+                err_frames = iQuotesHistoryRandom.check_binary_option(state_frames, xquotes_history::BUY, 3 * ztime::SECONDS_IN_MINUTE,
+                    timestamp, xquotes_history::PRICE_CLOSE, xquotes_history::WITHOUT_OPTIMIZATION);
+                err_plain = iQuotesHistoryPlain.check_binary_option(state_plain, xquotes_history::BUY, 3 * ztime::SECONDS_IN_MINUTE,
+                    timestamp, xquotes_history::PRICE_CLOSE, xquotes_history::WITHOUT_OPTIMIZATION);
+                if(err_frames != err_plain || state_frames != state_plain) ++num_candle_errors;
+            }
+        }
+        std::cout << (frames_type == COLUMN_FRAMES ? "column" : "hour") << " frames version " << file_version << " compression " << is_compression << " codec " << codec <<
+            " price type " << price_type << " frames " << bf::get_file_size(path_frames) <<
+            " plain " << bf::get_file_size(path_plain) << " errors " << num_candle_errors << std::endl;
+        num_errors += num_candle_errors;
+    }
+
+    remove(path_frames.c_str());
+    remove(path_plain.c_str());
+    if(num_errors != 0) {
+        std::cout << "error! errors: " << num_errors << std::endl;
+        return 1;
+    }
+    std::cout << "ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include <iostream>
+#include "xquotes_history.hpp"
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <stdio.h>
+
+/* Программа проверяет пакетную проверку бинарных опционов (check_binary_options и check_protected_binary_options).
+ * Состояния и коды ошибок опционов пакета сравниваются с результатами check_binary_option
+ * и check_protected_binary_option без оптимизации для каждого набора инструкций SIMD,
+ * цен входа PRICE_CLOSE и PRICE_OPEN, в одном и нескольких потоках. Опционы открываются
+ * в случайные моменты времени, в том числе до начала и после конца истории, а часть из них
+ * имеет неверный тип контракта или длительность не кратную минуте
+ */
+
+typedef xquotes_history::QuotesHistory<> quotes_history_t;
+
+int main(int argc, char *argv[]) {
+    std::cout << "start!" << std::endl;
+    std::string path = argc > 1 ? argv[1] : "../../storage/EURGBP.qhs4"; // путь к файлу
+    const int num_options = 20000;
+    const int price_types[] = {xquotes_history::PRICE_CLOSE, xquotes_history::PRICE_OPEN};
+    const int num_threads[] = {1, 4};
+    int num_errors = 0;
+
+    for(int simd_level = xquotes_simd::SIMD_NONE; simd_level <= xquotes_simd::SIMD_AVX2; ++simd_level) {
+        xquotes_simd::set_simd_level(simd_level);
+        quotes_history_t iQuotesHistory(path, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+        quotes_history_t iQuotesHistorySingle(path, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+        ztime::timestamp_t min_timestamp = 0, max_timestamp = 0;
+        if(iQuotesHistory.get_min_max_day_timestamp(min_timestamp, max_timestamp) != xquotes_history::OK) {
+            std::cout << "error! file: " << path << std::endl;
+            return 1;
+        }
+        const ztime::timestamp_t timestamp_start = min_timestamp - ztime::SECONDS_IN_DAY;
+        const ztime::timestamp_t timestamp_stop = max_timestamp + 3 * ztime::SECONDS_IN_DAY;
+        const ztime::timestamp_t last_timestamp = min_timestamp + (max_timestamp - min_timestamp) / 2;
+
+        std::mt19937 generator(12345);
+        std::vector<ztime::timestamp_t> timestamps(num_options);
+        std::vector<int> durations_sec(num_options);
+        std::vector<int> contract_types(num_options);
+        for(int i = 0; i < num_options; ++i) {
+            timestamps[i] = timestamp_start + generator() % (timestamp_stop - timestamp_start);
+            durations_sec[i] = ztime::SECONDS_IN_MINUTE * (1 + generator() % 5) + (generator() % 3 == 0 ? 30 : 0);
+            contract_types[i] = i % 97 == 0 ? 0 : (generator() % 2 == 0 ? xquotes_history::BUY : xquotes_history::SELL);
+        }
+        // одиночные опционы проверяются в порядке времени, чтобы дни не перечитывались
+        std::vector<int> order(num_options);
+        for(int i = 0; i < num_options; ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](const int a, const int b) {
+            return timestamps[a] < timestamps[b];
+        });
+
+        for(int price_type : price_types)
+        for(int threads : num_threads)
+        for(int is_protected = 0; is_protected < 2; ++is_protected) {
+            if(threads > 1) iQuotesHistory.enable_concurrent_read();
+            std::vector<int> states, errors;
+            int err = is_protected ?
+                iQuotesHistory.check_protected_binary_options(states, errors, timestamps, durations_sec, contract_types, last_timestamp, price_type, threads) :
+                iQuotesHistory.check_binary_options(states, errors, timestamps, durations_sec, contract_types, price_type, threads);
+            if(err != xquotes_history::OK || (int)states.size() != num_options || (int)errors.size() != num_options) {
+                std::cout << "error! code " << err << std::endl;
+                ++num_errors;
+                continue;
+            }
+            int num_option_errors = 0, num_checked = 0;
+            for(int j = 0; j < num_options; ++j) {
+                const int i = order[j];
+                int state = xquotes_history::NEUTRAL;
+                int err_single = is_protected ?
+                    iQuotesHistorySingle.check_protected_binary_option(state, contract_types[i], durations_sec[i], timestamps[i], last_timestamp, price_type, xquotes_history::WITHOUT_OPTIMIZATION) :
+                    iQuotesHistorySingle.check_binary_option(state, contract_types[i], durations_sec[i], timestamps[i], price_type, xquotes_history::WITHOUT_OPTIMIZATION);
+                if(err_single != errors[i] || (err_single == xquotes_history::OK && state != states[i])) ++num_option_errors;
+                if(err_single == xquotes_history::OK) ++num_checked;
+            }
+            std::cout << "simd " << simd_level << " price type " << price_type << " threads " << threads <<
+                " protected " << is_protected << " checked " << num_checked << " errors " << num_option_errors << std::endl;
+            num_errors += num_option_errors;
+        }
+    }
+
+    if(num_errors != 0) {
+        std::cout << "error! errors: " << num_errors << std::endl;
+        return 1;
+    }
+    std::cout << "ok" << std::endl;
+    return 0;
+}
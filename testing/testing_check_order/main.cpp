@@ -0,0 +1,116 @@
+#include <iostream>
+#include "xquotes_history.hpp"
+#include <random>
+#include <stdio.h>
+
+/* Программа проверяет метод check_oreder.
+ * Результат каждого ордера сравнивается с перебором минут через get_candle, как это делалось раньше:
+ * ордер закрывается в первой минуте, где достигнут уровень стоп лосса или тэйк профита
+ * (если достигнуты оба уровня, сработал стоп лосс), а пропуски цен либо прерывают проверку ордера,
+ * либо пропускаются. Ордера открываются в случайные минуты всей истории котировок
+ */
+
+typedef xquotes_history::QuotesHistory<> quotes_history_t;
+
+/** \brief Проверить ордер перебором минут
+ */
+int check_order_by_minutes(
+        quotes_history_t &iQuotesHistory,
+        double &profit,
+        const int contract_type,
+        const double spread,
+        const double take_profit,
+        const double stop_loss,
+        const ztime::timestamp_t timestamp,
+        ztime::timestamp_t &timestamp_end,
+        const int price_type,
+        const bool is_ignore_skipping,
+        const ztime::timestamp_t timestamp_stop) {
+    xquotes_history::Candle candle_start;
+    if(iQuotesHistory.get_candle(candle_start, timestamp, xquotes_history::WITHOUT_OPTIMIZATION) != xquotes_history::OK) return xquotes_history::DATA_NOT_AVAILABLE;
+    const double price_start = price_type == xquotes_history::PRICE_CLOSE ? candle_start.close : candle_start.open;
+    if(price_start == 0.0) return xquotes_history::DATA_NOT_AVAILABLE;
+    const double tl = contract_type == xquotes_history::BUY ? price_start + spread + take_profit : price_start - spread + stop_loss;
+    const double bl = contract_type == xquotes_history::BUY ? price_start + spread - stop_loss : price_start - spread - take_profit;
+    for(ztime::timestamp_t t = timestamp; t < timestamp_stop; t += ztime::SECONDS_IN_MINUTE) {
+        xquotes_history::Candle candle;
+        if(iQuotesHistory.get_candle(candle, t) != xquotes_history::OK || candle.high == 0.0 || candle.low == 0.0) {
+            if(is_ignore_skipping) continue;
+            return xquotes_history::DATA_NOT_AVAILABLE;
+        }
+        const bool is_stop_loss = contract_type == xquotes_history::BUY ? candle.low <= bl : candle.high >= tl;
+        const bool is_take_profit = contract_type == xquotes_history::BUY ? candle.high >= tl : candle.low <= bl;
+        if(is_stop_loss || is_take_profit) {
+            profit = is_stop_loss ? -stop_loss : take_profit;
+            timestamp_end = t;
+            return xquotes_history::OK;
+        }
+    }
+    return xquotes_history::DATA_NOT_AVAILABLE;
+}
+
+int main(int argc, char *argv[]) {
+    std::cout << "start!" << std::endl;
+    std::string path = argc > 1 ? argv[1] : "../../storage/EURGBP.qhs4"; // путь к файлу
+    const int num_orders = 3000;
+    const double spread = 0.0001;
+
+    quotes_history_t iQuotesHistory(path, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+    quotes_history_t iQuotesHistoryMinutes(path, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+    ztime::timestamp_t min_timestamp = 0, max_timestamp = 0;
+    if(iQuotesHistory.get_min_max_day_timestamp(min_timestamp, max_timestamp) != xquotes_history::OK) {
+        std::cout << "error! file: " << path << std::endl;
+        return 1;
+    }
+    const ztime::timestamp_t timestamp_stop = max_timestamp + ztime::SECONDS_IN_DAY;
+    const int num_minutes = (timestamp_stop - min_timestamp) / ztime::SECONDS_IN_MINUTE;
+
+    std::mt19937 generator(12345);
+    int num_closed = 0, num_errors = 0;
+    for(int i = 0; i < num_orders; ++i) {
+        const ztime::timestamp_t timestamp = min_timestamp + (generator() % num_minutes) * ztime::SECONDS_IN_MINUTE;
+        const int contract_type = generator() % 2 == 0 ? xquotes_history::BUY : xquotes_history::SELL;
+        const int price_type = generator() % 2 == 0 ? xquotes_history::PRICE_CLOSE : xquotes_history::PRICE_OPEN;
+        const bool is_ignore_skipping = generator() % 2 == 0;
+        const double level = 0.0005 * (1 + generator() % 40);
+        double profit = 0, profit_minutes = 0;
+        ztime::timestamp_t timestamp_end = 0, timestamp_end_minutes = 0;
+        int err = iQuotesHistory.check_oreder(
+            profit,
+            contract_type,
+            spread,
+            level,
+            level * 0.7,
+            timestamp,
+            timestamp_end,
+            price_type,
+            xquotes_history::WITHOUT_OPTIMIZATION,
+            is_ignore_skipping);
+        int err_minutes = check_order_by_minutes(
+            iQuotesHistoryMinutes,
+            profit_minutes,
+            contract_type,
+            spread,
+            level,
+            level * 0.7,
+            timestamp,
+            timestamp_end_minutes,
+            price_type,
+            is_ignore_skipping,
+            timestamp_stop);
+        if(err != err_minutes || (err == xquotes_history::OK && (profit != profit_minutes || timestamp_end != timestamp_end_minutes))) {
+            std::cout << "error! order " << i << " timestamp " << timestamp << " code " << err << " " << err_minutes <<
+                " profit " << profit << " " << profit_minutes << " end " << timestamp_end << " " << timestamp_end_minutes << std::endl;
+            ++num_errors;
+        }
+        if(err == xquotes_history::OK) ++num_closed;
+    }
+
+    std::cout << "orders: " << num_orders << ", closed: " << num_closed << std::endl;
+    if(num_errors != 0) {
+        std::cout << "error! errors: " << num_errors << std::endl;
+        return 1;
+    }
+    std::cout << "ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,79 @@
+/** \file Файл с общими функциями программ проверки
+ * \brief Данный файл содержит генератор тестовых дней котировок и функции сравнения свечей
+ * и содержимого хранилищ, которые используют программы testing_* общего проекта testing.cbp
+ */
+#ifndef XQUOTES_TESTING_COMMON_HPP_INCLUDED
+#define XQUOTES_TESTING_COMMON_HPP_INCLUDED
+
+#include "xquotes_history.hpp"
+#include "xquotes_storage.hpp"
+#include <array>
+#include <map>
+#include <vector>
+#include <algorithm>
+
+namespace xquotes_testing {
+
+    typedef std::array<xquotes_history::Candle, xquotes_history::MINUTES_IN_DAY> candles_array_t;
+
+    const xquotes_history::key_t START_DAY = 17000;    /**< Первый день тестовых котировок */
+
+    /** \brief Получить метку времени начала тестового дня
+     * \param day номер дня от START_DAY
+     * \return метка времени начала дня
+     */
+    inline ztime::timestamp_t get_test_day_timestamp(const int day) {
+        return (ztime::timestamp_t)(START_DAY + day) * ztime::SECONDS_IN_DAY;
+    }
+
+    /** \brief Получить свечи тестового дня
+     * Цены меняются небольшими шагами, как у настоящих котировок, и зависят только от номера дня
+     * \param candles массив свечей
+     * \param day номер дня от START_DAY
+     * \param gap_start первая минута пропуска котировок
+     * \param gap_stop минута после пропуска котировок (если равна gap_start, пропуска нет)
+     */
+    inline void get_test_candles(candles_array_t &candles, const int day, const int gap_start = 0, const int gap_stop = 0) {
+        const ztime::timestamp_t timestamp = get_test_day_timestamp(day);
+        double price = 0.85;
+        for(int i = 0; i < xquotes_history::MINUTES_IN_DAY; ++i) {
+            const ztime::timestamp_t candle_timestamp = timestamp + i * ztime::SECONDS_IN_MINUTE;
+            price += 0.00001 * ((i * 7 + day) % 9 - 4);
+            candles[i] = xquotes_history::Candle(price, price + 0.0002, price - 0.0001, price + 0.00003, candle_timestamp);
+            candles[i].volume = (i % 13) * 3;
+            if(i >= gap_start && i < gap_stop) candles[i] = xquotes_history::Candle(0, 0, 0, 0, candle_timestamp);
+        }
+    }
+
+    /** \brief Сравнить свечи
+     * \return вернет true, если цены, объем и метки времени свечей совпадают
+     */
+    inline bool is_equal(const xquotes_history::Candle &a, const xquotes_history::Candle &b) {
+        return a.open == b.open && a.high == b.high && a.low == b.low && a.close == b.close &&
+            a.volume == b.volume && a.timestamp == b.timestamp;
+    }
+
+    typedef std::map<xquotes_storage::key_t, std::vector<char>> subfiles_t;
+
+    /** \brief Сравнить содержимое хранилища с ожидаемым
+     * \details В режиме пакета количество подфайлов не сравнивается, так как get_num_subfiles не видит данные пакета
+     * \param iStorage хранилище
+     * \param subfiles ожидаемые подфайлы хранилища
+     * \return вернет true, если содержимое хранилища совпадает с ожидаемым
+     */
+    inline bool check_storage(xquotes_storage::Storage &iStorage, const subfiles_t &subfiles) {
+        if(!iStorage.is_batch_mode() && iStorage.get_num_subfiles() != subfiles.size()) return false;
+        for(auto it = subfiles.begin(); it != subfiles.end(); ++it) {
+            char *data = NULL;
+            unsigned long length = 0;
+            int err = iStorage.read_subfile(it->first, data, length);
+            bool is_equal = err == xquotes_storage::OK && length == it->second.size() &&
+                std::equal(data, data + length, it->second.begin());
+            delete[] data;
+            if(!is_equal) return false;
+        }
+        return true;
+    }
+}
+
+#endif // XQUOTES_TESTING_COMMON_HPP_INCLUDED
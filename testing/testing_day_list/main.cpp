@@ -0,0 +1,138 @@
+#include <iostream>
+#include "xquotes_history.hpp"
+#include <array>
+#include <set>
+#include <vector>
+#include <random>
+#include <stdio.h>
+
+/* Программа проверяет метод get_day_timestamp_list класса MultipleQuotesHistory.
+ * Создаются файлы нескольких символов с разными диапазонами дней и случайными пропусками дней,
+ * затем список дней для случайных наборов символов, меток времени начала поиска, количества дней,
+ * фильтра выходных и направления поиска сравнивается с перебором дней: в список должны попасть
+ * только дни, которые есть у всех выбранных символов
+ */
+
+typedef xquotes_history::MultipleQuotesHistory<> multiple_quotes_history_t;
+
+const xquotes_history::key_t start_day = 17000;
+
+/** \brief Получить список дней перебором дней
+ * \return вернет 0 в случае успеха, иначе см. код ошибок в xquotes_common.hpp
+ */
+int get_day_timestamp_list_by_days(
+        std::vector<ztime::timestamp_t> &list_timestamp,
+        const std::vector<std::set<xquotes_history::key_t>> &symbols_days,
+        const xquotes_history::key_t start_key,
+        const std::vector<bool> &is_symbol,
+        const int num_days,
+        const bool is_day_off_filter,
+        const bool is_go_back_in_time,
+        const xquotes_history::key_t min_key,
+        const xquotes_history::key_t max_key) {
+    list_timestamp.clear();
+    auto is_trade_day = [&](const xquotes_history::key_t key) {
+        if(is_day_off_filter && ztime::is_day_off_for_day(key)) return false;
+        for(size_t i = 0; i < symbols_days.size(); ++i) {
+            if(is_symbol[i] && symbols_days[i].count(key) == 0) return false;
+        }
+        return true;
+    };
+    if(is_go_back_in_time) {
+        for(xquotes_history::key_t key = std::min(start_key, max_key); key >= min_key && (int)list_timestamp.size() < num_days; --key) {
+            if(is_trade_day(key)) list_timestamp.insert(list_timestamp.begin(), (ztime::timestamp_t)key * ztime::SECONDS_IN_DAY);
+        }
+    } else {
+        for(xquotes_history::key_t key = std::max(start_key, min_key); key <= max_key && (int)list_timestamp.size() < num_days; ++key) {
+            if(is_trade_day(key)) list_timestamp.push_back((ztime::timestamp_t)key * ztime::SECONDS_IN_DAY);
+        }
+    }
+    return list_timestamp.size() == 0 ? xquotes_history::DATA_NOT_AVAILABLE : xquotes_history::OK;
+}
+
+int main() {
+    std::cout << "start!" << std::endl;
+    const std::vector<std::string> paths = {"test_day_list_0.qhs4", "test_day_list_1.qhs4", "test_day_list_2.qhs4"};
+    // диапазоны дней символов, у второго символа есть длинный пропуск
+    const int symbols_first_day[] = {0, 30, 70};
+    const int symbols_stop_day[] = {400, 450, 300};
+    const int gap_first_day = 150, gap_stop_day = 250;
+    const int num_lists = 20000;
+
+    std::mt19937 generator(12345);
+    std::vector<std::set<xquotes_history::key_t>> symbols_days(paths.size());
+    for(size_t i = 0; i < paths.size(); ++i) {
+        remove(paths[i].c_str());
+        xquotes_history::QuotesHistory<> iQuotesHistory(paths[i], xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+        iQuotesHistory.begin_batch();
+        std::array<xquotes_history::Candle, xquotes_history::MINUTES_IN_DAY> candles;
+        for(int d = symbols_first_day[i]; d < symbols_stop_day[i]; ++d) {
+            if(generator() % 5 == 0) continue;
+            if(i == 1 && d >= gap_first_day && d < gap_stop_day) continue;
+            const ztime::timestamp_t timestamp = (ztime::timestamp_t)(start_day + d) * ztime::SECONDS_IN_DAY;
+            for(int m = 0; m < xquotes_history::MINUTES_IN_DAY; ++m) {
+                candles[m] = xquotes_history::Candle(1.1, 1.1002, 1.0999, 1.1001, timestamp + m * ztime::SECONDS_IN_MINUTE);
+            }
+            iQuotesHistory.write_candles(candles, timestamp);
+            symbols_days[i].insert(start_day + d);
+        }
+        iQuotesHistory.commit();
+    }
+
+    int num_errors = 0, num_found = 0;
+    {
+        multiple_quotes_history_t iMultipleQuotesHistory(paths, xquotes_history::PRICE_OHLC, xquotes_history::USE_COMPRESSION);
+        for(int n = 0; n < num_lists; ++n) {
+            std::vector<bool> is_symbol(paths.size());
+            xquotes_history::key_t min_key = start_day + 1000, max_key = 0;
+            bool is_any_symbol = false;
+            for(size_t i = 0; i < paths.size(); ++i) {
+                is_symbol[i] = generator() % 2 == 0;
+                if(!is_symbol[i]) continue;
+                is_any_symbol = true;
+                min_key = std::min(min_key, *symbols_days[i].begin());
+                max_key = std::max(max_key, *symbols_days[i].rbegin());
+            }
+            if(!is_any_symbol) continue;
+            const xquotes_history::key_t start_key = start_day - 20 + generator() % 500;
+            const int num_days = 1 + generator() % 150;
+            const bool is_day_off_filter = generator() % 2 == 0;
+            const bool is_go_back_in_time = generator() % 2 == 0;
+            std::vector<ztime::timestamp_t> list_timestamp, list_timestamp_days;
+            int err = iMultipleQuotesHistory.get_day_timestamp_list(
+                list_timestamp,
+                (ztime::timestamp_t)start_key * ztime::SECONDS_IN_DAY + 3600,
+                is_symbol,
+                num_days,
+                is_day_off_filter,
+                is_go_back_in_time);
+            int err_days = get_day_timestamp_list_by_days(
+                list_timestamp_days,
+                symbols_days,
+                start_key,
+                is_symbol,
+                num_days,
+                is_day_off_filter,
+                is_go_back_in_time,
+                min_key,
+                max_key);
+            if(err != err_days || (err == xquotes_history::OK && list_timestamp != list_timestamp_days)) {
+                std::cout << "error! list " << n << " start " << start_key << " days " << num_days <<
+                    " code " << err << " " << err_days << " size " << list_timestamp.size() << " " << list_timestamp_days.size() << std::endl;
+                ++num_errors;
+            }
+            if(err == xquotes_history::OK) ++num_found;
+        }
+    }
+
+    for(size_t i = 0; i < paths.size(); ++i) {
+        remove(paths[i].c_str());
+    }
+    std::cout << "lists: " << num_lists << ", found: " << num_found << std::endl;
+    if(num_errors != 0) {
+        std::cout << "error! errors: " << num_errors << std::endl;
+        return 1;
+    }
+    std::cout << "ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <iostream>
+#include "xquotes_history.hpp"
+#include "../testing_common.hpp"
+#include <stdio.h>
+
+/* Программа проверяет кодек цен (set_price_codec, см. xquotes_codec.hpp).
+ * Одни и те же дни котировок записываются в файл с кодеком цен и в обычный файл
+ * для обоих форматов файла, всех типов цен, со сжатием и без. После повторного открытия
+ * свечи каждой минуты из обоих файлов должны совпадать
+ */
+
+typedef xquotes_history::QuotesHistory<> quotes_history_t;
+
+const int num_days = 30;
+const int gap_start = 101;     // пропуск котировок в середине дня
+const int gap_stop = 130;
+
+int main() {
+    std::cout << "start!" << std::endl;
+    const std::string path_codec = "test_codec.qhs4";
+    const std::string path_plain = "test_plain.qhs4";
+    const int file_versions[] = {xquotes_storage::FILE_VERSION_4, xquotes_storage::FILE_VERSION_5};
+    const int price_types[] = {xquotes_history::PRICE_CLOSE, xquotes_history::PRICE_OHLC, xquotes_history::PRICE_OHLCV};
+    int num_errors = 0;
+
+    for(int file_version : file_versions)
+    for(int is_compression = 0; is_compression < 2; ++is_compression)
+    for(int price_type : price_types) {
+        const int option = is_compression ? xquotes_history::USE_COMPRESSION : xquotes_history::DO_NOT_USE_COMPRESSION;
+        remove(path_codec.c_str());
+        remove(path_plain.c_str());
+        {
+            quotes_history_t iQuotesHistoryCodec(path_codec, price_type, option);
+            quotes_history_t iQuotesHistoryPlain(path_plain, price_type, option);
+            iQuotesHistoryCodec.set_file_version(file_version);
+            iQuotesHistoryPlain.set_file_version(file_version);
+            if(iQuotesHistoryCodec.set_price_codec(xquotes_codec::CODEC_DELTA_ZIGZAG_BITPACK) != xquotes_history::OK) ++num_errors;
+            for(int d = 0; d < num_days; ++d) {
+                xquotes_testing::candles_array_t candles;
+                xquotes_testing::get_test_candles(candles, d, gap_start, gap_stop);
+                if(iQuotesHistoryCodec.write_candles(candles, candles[0].timestamp) != xquotes_history::OK) ++num_errors;
+                if(iQuotesHistoryPlain.write_candles(candles, candles[0].timestamp) != xquotes_history::OK) ++num_errors;
+            }
+            // кодек нельзя изменить после записи данных
+            if(iQuotesHistoryCodec.set_price_codec(xquotes_codec::CODEC_NONE) != xquotes_history::INVALID_PARAMETER) ++num_errors;
+        }
+        // тип цены и сжатие при открытии берутся из заметки файла
+        quotes_history_t iQuotesHistoryCodec(path_codec, xquotes_history::PRICE_CLOSE, xquotes_history::DO_NOT_USE_COMPRESSION);
+        quotes_history_t iQuotesHistoryPlain(path_plain, xquotes_history::PRICE_CLOSE, xquotes_history::DO_NOT_USE_COMPRESSION);
+        if(iQuotesHistoryCodec.get_price_codec() != xquotes_codec::CODEC_DELTA_ZIGZAG_BITPACK ||
+            iQuotesHistoryPlain.get_price_codec() != xquotes_codec::CODEC_NONE) ++num_errors;
+        int num_candle_errors = 0;
+        for(int d = 0; d < num_days; ++d) {
+            const ztime::timestamp_t timestamp = xquotes_testing::get_test_day_timestamp(d);
+            for(int i = 0; i < xquotes_history::MINUTES_IN_DAY; ++i) {
+                xquotes_history::Candle candle_codec, candle_plain;
+                int err_codec = iQuotesHistoryCodec.get_candle(candle_codec, timestamp + i * ztime::SECONDS_IN_MINUTE);
+                int err_plain = iQuotesHistoryPlain.get_candle(candle_plain, timestamp + i * ztime::SECONDS_IN_MINUTE);
+                if(err_codec != err_plain || !xquotes_testing::is_equal(candle_codec, candle_plain)) ++num_candle_errors;
+            }
+        }
+        std::cout << "version " << file_version << " compression " << is_compression << " price type " << price_type <<
+            " codec " << bf::get_file_size(path_codec) << " plain " << bf::get_file_size(path_plain) <<
+            " errors " << num_candle_errors << std::endl;
+        num_errors += num_candle_errors;
+    }
+
+    remove(path_codec.c_str());
+    remove(path_plain.c_str());
+    if(num_errors != 0) {
+        std::cout << "error! errors: " << num_errors << std::endl;
+        return 1;
+    }
+    std::cout << "ok" << std::endl;
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include <iostream>
+#include "xquotes_storage.hpp"
+#include "../testing_common.hpp"
+#include <vector>
+#include <random>
+#include <stdio.h>
+
+/* Программа проверяет пакетную запись подфайлов (begin_batch и commit).
+ * В каждом раунде подфайлы записываются, переписываются и удаляются в режиме пакета
+ * с разным ограничением размера пакета. Чтение во время пакета должно видеть данные пакета,
+ * а после commit или закрытия хранилища без commit содержимое файла после повторного открытия
+ * должно совпадать с ожидаемым
+ */
+
+int main() {
+    std::cout << "start!" << std::endl;
+    const std::string path = "test_batch.dat";
+    const int num_rounds = 20;
+    const int num_operations = 300;
+    const int num_keys = 60;
+    const size_t batch_max_sizes[] = {0, 20000, 1000000};
+    remove(path.c_str());
+
+    std::mt19937 generator(12345);
+    xquotes_testing::subfiles_t subfiles;
+    int num_errors = 0;
+    for(int round = 0; round < num_rounds; ++round) {
+        xquotes_storage::Storage iStorage(path);
+        if(!xquotes_testing::check_storage(iStorage, subfiles)) ++num_errors;
+        const size_t batch_max_size = batch_max_sizes[round % 3];
+        if(iStorage.begin_batch(batch_max_size) != xquotes_storage::OK || !iStorage.is_batch_mode()) ++num_errors;
+        for(int i = 0; i < num_operations; ++i) {
+            if(i % 50 == 0 && !xquotes_testing::check_storage(iStorage, subfiles)) ++num_errors;
+            const xquotes_storage::key_t key = generator() % num_keys + 1;
+            if(generator() % 10 == 0 && subfiles.count(key) != 0) {
+                if(iStorage.delete_subfile(key) != xquotes_storage::OK) ++num_errors;
+                subfiles.erase(key);
+            } else {
+                std::vector<char> data(generator() % 3000 + 1);
+                for(size_t j = 0; j < data.size(); ++j) data[j] = generator();
+                if(iStorage.write_subfile(key, data.data(), data.size()) != xquotes_storage::OK) ++num_errors;
+                subfiles[key] = data;
+            }
+        }
+        if(!xquotes_testing::check_storage(iStorage, subfiles)) ++num_errors;
+        // в каждом втором раунде пакет записывается при закрытии хранилища
+        if(round % 2 == 0) {
+            if(iStorage.commit() != xquotes_storage::OK || iStorage.is_batch_mode()) ++num_errors;
+            if(!xquotes_testing::check_storage(iStorage, subfiles)) ++num_errors;
+        }
+        if(round == num_rounds / 2) {
+            if(iStorage.compact() != xquotes_storage::OK) ++num_errors;
+            if(!xquotes_testing::check_storage(iStorage, subfiles)) ++num_errors;
+        }
+        if(round % 5 == 0) {
+            std::cout << "round " << round << " free space " << iStorage.get_free_space() <<
+                " file size " << bf::get_file_size(path) << std::endl;
+        }
+    }
+    {
+        xquotes_storage::Storage iStorage(path);
+        if(!xquotes_testing::check_storage(iStorage, subfiles)) ++num_errors;
+        std::cout << "subfiles " << iStorage.get_num_subfiles() << " file size " << bf::get_file_size(path) << std::endl;
+    }
+
+    remove(path.c_str());
+    if(num_errors != 0) {
+        std::cout << "error! errors: " << num_errors << std::endl;
+        return 1;
+    }
+    std::cout << "ok" << std::endl;
+    return 0;
+}
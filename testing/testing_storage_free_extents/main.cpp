@@ -0,0 +1,89 @@
+#include <iostream>
+#include "xquotes_storage.hpp"
+#include "../testing_common.hpp"
+#include <vector>
+#include <random>
+#include <fstream>
+#include <stdio.h>
+
+/* Программа проверяет повторное использование места удаленных и переписанных подфайлов.
+ * В хранилище в случайном порядке записываются, переписываются и удаляются подфайлы,
+ * содержимое хранилища сравнивается с ожидаемым после каждого раунда, после повторного открытия
+ * и после сжатия файла (compact). Копия файла, сделанная без закрытия хранилища,
+ * должна открываться и содержать последнее зафиксированное состояние
+ */
+
+void copy_file(const std::string &path, const std::string &path_copy) {
+    std::ifstream file(path, std::ios::binary);
+    std::ofstream file_copy(path_copy, std::ios::binary);
+    file_copy << file.rdbuf();
+}
+
+int main() {
+    std::cout << "start!" << std::endl;
+    const std::string path = "test_free_extents.dat";
+    const std::string path_copy = "test_free_extents_copy.dat";
+    const int num_rounds = 30;
+    const int num_operations = 200;
+    const int num_keys = 60;
+    remove(path.c_str());
+
+    std::mt19937 generator(12345);
+    xquotes_testing::subfiles_t subfiles, committed_subfiles;
+    int num_errors = 0;
+    for(int round = 0; round < num_rounds; ++round) {
+        xquotes_storage::Storage iStorage(path);
+        if(!xquotes_testing::check_storage(iStorage, committed_subfiles)) ++num_errors;
+        for(int i = 0; i < num_operations; ++i) {
+            const xquotes_storage::key_t key = generator() % num_keys + 1;
+            if(generator() % 10 == 0 && subfiles.count(key) != 0) {
+                if(iStorage.delete_subfile(key) != xquotes_storage::OK) ++num_errors;
+                subfiles.erase(key);
+                // удаление сразу записывает заголовок
+                committed_subfiles = subfiles;
+            } else {
+                std::vector<char> data(generator() % 3000 + 1);
+                for(size_t j = 0; j < data.size(); ++j) data[j] = generator();
+                if(iStorage.write_subfile(key, data.data(), data.size()) != xquotes_storage::OK) ++num_errors;
+                subfiles[key] = data;
+            }
+            // копия файла без закрытия хранилища
+            if(i % 20 == 0) {
+                copy_file(path, path_copy);
+                xquotes_storage::Storage iStorageCopy(path_copy);
+                if(!xquotes_testing::check_storage(iStorageCopy, committed_subfiles)) ++num_errors;
+            }
+        }
+        if(!xquotes_testing::check_storage(iStorage, subfiles)) ++num_errors;
+        iStorage.save();
+        committed_subfiles = subfiles;
+        if(round == num_rounds / 2) {
+            if(iStorage.compact() != xquotes_storage::OK || iStorage.get_free_space() != 0) ++num_errors;
+            if(!xquotes_testing::check_storage(iStorage, subfiles)) ++num_errors;
+        }
+        if(round % 5 == 0) {
+            std::cout << "round " << round << " free space " << iStorage.get_free_space() <<
+                " file size " << bf::get_file_size(path) << std::endl;
+        }
+    }
+    {
+        xquotes_storage::Storage iStorage(path);
+        if(!xquotes_testing::check_storage(iStorage, subfiles)) ++num_errors;
+        std::cout << "free space " << iStorage.get_free_space() << " file size " << bf::get_file_size(path) << std::endl;
+        if(iStorage.compact() != xquotes_storage::OK) ++num_errors;
+    }
+    {
+        xquotes_storage::Storage iStorage(path);
+        if(!xquotes_testing::check_storage(iStorage, subfiles) || iStorage.get_free_space() != 0) ++num_errors;
+        std::cout << "after compact file size " << bf::get_file_size(path) << std::endl;
+    }
+
+    remove(path.c_str());
+    remove(path_copy.c_str());
+    if(num_errors != 0) {
+        std::cout << "error! errors: " << num_errors << std::endl;
+        return 1;
+    }
+    std::cout << "ok" << std::endl;
+    return 0;
+}
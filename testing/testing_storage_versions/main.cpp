@@ -0,0 +1,126 @@
+#include <iostream>
+#include "xquotes_history.hpp"
+#include "../testing_common.hpp"
+#include <cmath>
+#include <stdio.h>
+
+/* Программа проверяет запись и чтение котировок в форматах файла v4 и v5.
+ * Одни и те же дни котировок записываются в файлы обоих форматов для всех типов цен,
+ * со сжатием и без, после чего файлы открываются заново и свечи сравниваются
+ * между собой и с исходными данными. Затем в файле v5 переписывается и удаляется день
+ * и проверяется, что версия формата и данные сохраняются после сжатия файла (compact)
+ */
+
+typedef xquotes_history::QuotesHistory<> quotes_history_t;
+
+const int num_days = 30;
+const int gap_start = 1401;     // пропуск котировок в конце дня
+const int gap_stop = xquotes_history::MINUTES_IN_DAY;
+
+void write_test_days(quotes_history_t &iQuotesHistory) {
+    for(int d = 0; d < num_days; ++d) {
+        xquotes_testing::candles_array_t candles;
+        xquotes_testing::get_test_candles(candles, d, gap_start, gap_stop);
+        iQuotesHistory.write_candles(candles, candles[0].timestamp);
+    }
+}
+
+bool is_near(const double a, const double b) {
+    return std::abs(a - b) < 0.000005;
+}
+
+/** \brief Сравнить свечи двух файлов между собой и с исходными данными
+ * \return количество ошибок
+ */
+int check_test_days(quotes_history_t &iQuotesHistory4, quotes_history_t &iQuotesHistory5, const int price_type) {
+    int num_errors = 0;
+    for(int d = 0; d < num_days; ++d) {
+        xquotes_testing::candles_array_t candles;
+        xquotes_testing::get_test_candles(candles, d, gap_start, gap_stop);
+        for(int i = 0; i < xquotes_history::MINUTES_IN_DAY; ++i) {
+            xquotes_history::Candle candle4, candle5;
+            int err4 = iQuotesHistory4.get_candle(candle4, candles[i].timestamp);
+            int err5 = iQuotesHistory5.get_candle(candle5, candles[i].timestamp);
+            if(err4 != err5 || !xquotes_testing::is_equal(candle4, candle5)) {
+                ++num_errors;
+                continue;
+            }
+            if(candles[i].close == 0) {
+                // пропущенные минуты не читаются
+                if(err4 == xquotes_history::OK) ++num_errors;
+            } else if(err4 != xquotes_history::OK) ++num_errors;
+            else if(!is_near(candle4.close, candles[i].close)) ++num_errors;
+            else if(price_type != xquotes_history::PRICE_CLOSE &&
+                (!is_near(candle4.open, candles[i].open) ||
+                !is_near(candle4.high, candles[i].high) ||
+                !is_near(candle4.low, candles[i].low))) ++num_errors;
+            else if(price_type == xquotes_history::PRICE_OHLCV && candle4.volume != candles[i].volume) ++num_errors;
+        }
+    }
+    return num_errors;
+}
+
+int main() {
+    std::cout << "start!" << std::endl;
+    const std::string path4 = "test_v4.qhs4";
+    const std::string path5 = "test_v5.qhs4";
+    const int price_types[] = {xquotes_history::PRICE_CLOSE, xquotes_history::PRICE_OHLC, xquotes_history::PRICE_OHLCV};
+    int num_errors = 0;
+
+    for(int is_compression = 0; is_compression < 2; ++is_compression)
+    for(int price_type : price_types) {
+        const int option = is_compression ? xquotes_history::USE_COMPRESSION : xquotes_history::DO_NOT_USE_COMPRESSION;
+        remove(path4.c_str());
+        remove(path5.c_str());
+        {
+            quotes_history_t iQuotesHistory4(path4, price_type, option);
+            quotes_history_t iQuotesHistory5(path5, price_type, option);
+            if(iQuotesHistory5.set_file_version(xquotes_storage::FILE_VERSION_5) != xquotes_history::OK) ++num_errors;
+            write_test_days(iQuotesHistory4);
+            write_test_days(iQuotesHistory5);
+            // версию формата нельзя изменить после записи данных
+            if(iQuotesHistory5.set_file_version(xquotes_storage::FILE_VERSION_4) != xquotes_history::INVALID_PARAMETER) ++num_errors;
+        }
+        quotes_history_t iQuotesHistory4(path4, price_type, option);
+        quotes_history_t iQuotesHistory5(path5, price_type, option);
+        if(iQuotesHistory4.get_file_version() != xquotes_storage::FILE_VERSION_4 ||
+            iQuotesHistory5.get_file_version() != xquotes_storage::FILE_VERSION_5) ++num_errors;
+        if(iQuotesHistory4.get_file_note() != iQuotesHistory5.get_file_note()) ++num_errors;
+        int num_day_errors = check_test_days(iQuotesHistory4, iQuotesHistory5, price_type);
+        std::cout << "compression " << is_compression << " price type " << price_type << " errors " << num_day_errors << std::endl;
+        num_errors += num_day_errors;
+    }
+
+    // переписывание и удаление дня в файле v5, затем сжатие файла
+    const int price_type = xquotes_history::PRICE_OHLCV;
+    const ztime::timestamp_t rewrite_timestamp = xquotes_testing::get_test_day_timestamp(5);
+    const ztime::timestamp_t delete_timestamp = xquotes_testing::get_test_day_timestamp(7);
+    {
+        quotes_history_t iQuotesHistory5(path5, price_type, xquotes_history::USE_COMPRESSION);
+        xquotes_testing::candles_array_t candles;
+        for(int i = 0; i < xquotes_history::MINUTES_IN_DAY; ++i) {
+            candles[i] = xquotes_history::Candle(2.0, 2.0, 2.0, 2.0, rewrite_timestamp + i * ztime::SECONDS_IN_MINUTE);
+        }
+        if(iQuotesHistory5.write_candles(candles, rewrite_timestamp) != xquotes_history::OK) ++num_errors;
+        if(iQuotesHistory5.delete_subfile(ztime::get_day(delete_timestamp)) != xquotes_history::OK) ++num_errors;
+    }
+    for(int step = 0; step < 2; ++step) {
+        quotes_history_t iQuotesHistory5(path5, price_type, xquotes_history::USE_COMPRESSION);
+        if(iQuotesHistory5.get_file_version() != xquotes_storage::FILE_VERSION_5) ++num_errors;
+        xquotes_history::Candle candle;
+        if(iQuotesHistory5.get_candle(candle, rewrite_timestamp + ztime::SECONDS_IN_MINUTE) != xquotes_history::OK || candle.close != 2.0) ++num_errors;
+        if(iQuotesHistory5.get_candle(candle, delete_timestamp + ztime::SECONDS_IN_MINUTE) == xquotes_history::OK) ++num_errors;
+        if(iQuotesHistory5.get_candle(candle, delete_timestamp + ztime::SECONDS_IN_DAY) != xquotes_history::OK) ++num_errors;
+        std::cout << "step " << step << " file size " << bf::get_file_size(path5) << std::endl;
+        if(step == 0 && iQuotesHistory5.compact() != xquotes_history::OK) ++num_errors;
+    }
+
+    remove(path4.c_str());
+    remove(path5.c_str());
+    if(num_errors != 0) {
+        std::cout << "error! errors: " << num_errors << std::endl;
+        return 1;
+    }
+    std::cout << "ok" << std::endl;
+    return 0;
+}